@@ -0,0 +1,503 @@
+// Benchmarks the engine's CPU systems over synthetic scenes, so builds can be compared.
+//
+//   crab_bench [--scene piles|grid|rain|walls]... [--count N]... [--warmup W] [--reps R]
+//              [--threads T] [--json FILE] [--csv FILE] [--res DIR]
+//
+// Every repetition is one physics step, timed per stage, followed by building the culled
+// render frame; asset loads are timed separately. Assets come from ../res, as when run from
+// the build directory like the engine, unless --res names the directory. Assets that fail
+// to load are reported and left out of the results.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stb_image.h"
+
+#include "state.h"
+#include "object.h"
+#include "mesh.h"
+#include "simplify.h"
+#include "jobs.h"
+#include "platform.h"
+#include "collision.h"
+
+#define BENCH_MAX_COUNT     1000000
+#define BENCH_MAX_LISTED    8
+#define BENCH_PILE_HEIGHT   10
+#define BENCH_SPACING       2.0f    // between neighbouring cubes or piles
+#define BENCH_WALL_HEIGHT   30.0f   // taller than the camera is high
+#define BENCH_ASPECT        1.5f    // the engine's window, 1200x800
+#define BENCH_SEED          0x9e3779b9u
+
+typedef void (*SceneFunc)(State* state, const Object* cube, uint32_t count);
+
+typedef struct {
+    const char* name;
+    SceneFunc   build;
+} Scene;
+
+typedef struct {
+    const char* scene;
+    uint32_t    count;
+    const char* system;
+    int         samples;
+    double      median;     // milliseconds, like the rest
+    double      p99;
+    double      min;
+    double      mean;
+} BenchResult;
+
+typedef struct {
+    const Scene* scenes[BENCH_MAX_LISTED];
+    int          sceneCount;
+    uint32_t     counts[BENCH_MAX_LISTED];
+    int          countCount;
+    int          warmup;
+    int          reps;
+    int          threads;
+    const char*  jsonPath;
+    const char*  csvPath;
+    const char*  resDir;        // where the res/ assets are, ../res by default as when run from build/
+} BenchOptions;
+
+typedef struct {
+    BenchResult* items;
+    uint32_t     count;
+    uint32_t     capacity;
+} BenchResults;
+
+// xorshift32, so every run and every machine builds the same scenes
+static uint32_t rng_state = BENCH_SEED;
+
+static float random_range(float min, float max) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return min + (max - min) * (float)(rng_state >> 8) / (float)(1u << 24);
+}
+
+static void spawn_cube(State* state, const Object* cube, vec3 position, vec3 rotation, vec3 velocity) {
+    Object obj = *cube;
+    glm_vec3_copy(position, obj.position);
+    glm_vec3_copy(rotation, obj.rotation);
+    glm_vec3_copy(velocity, obj.velocity);
+    state_add_object(state, &obj);
+}
+
+// Side of the smallest square grid holding count cells
+static uint32_t grid_side(uint32_t count) {
+    uint32_t side = (uint32_t)ceil(sqrt((double)count));
+    return side > 0 ? side : 1;
+}
+
+// Columns of stacked cubes resting on the ground: contact heavy, most pairs persist
+static void scene_piles(State* state, const Object* cube, uint32_t count) {
+    uint32_t piles = (count + BENCH_PILE_HEIGHT - 1) / BENCH_PILE_HEIGHT;
+    uint32_t side = grid_side(piles);
+    float offset = 0.5f * (side - 1) * BENCH_SPACING;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t pile = i / BENCH_PILE_HEIGHT;
+        uint32_t level = i % BENCH_PILE_HEIGHT;
+        vec3 position = {
+            (pile % side) * BENCH_SPACING - offset,
+            COLLISION_GROUND_HEIGHT + 0.5f + level * 1.01f,
+            (pile / side) * BENCH_SPACING - offset,
+        };
+        spawn_cube(state, cube, position, GLM_VEC3_ZERO, GLM_VEC3_ZERO);
+    }
+}
+
+// A lattice of separated cubes dropped together: broadphase heavy until the layers land
+static void scene_grid(State* state, const Object* cube, uint32_t count) {
+    uint32_t side = (uint32_t)ceil(cbrt((double)count));
+    float offset = 0.5f * (side - 1) * BENCH_SPACING;
+
+    for (uint32_t i = 0; i < count; i++) {
+        vec3 position = {
+            (i % side) * BENCH_SPACING - offset,
+            COLLISION_GROUND_HEIGHT + 1.0f + (i / (side * side)) * BENCH_SPACING,
+            ((i / side) % side) * BENCH_SPACING - offset,
+        };
+        spawn_cube(state, cube, position, GLM_VEC3_ZERO, GLM_VEC3_ZERO);
+    }
+}
+
+// Tumbling cubes at random heights and speeds: exercises CCD and changing pairs
+static void scene_rain(State* state, const Object* cube, uint32_t count) {
+    float extent = 0.5f * grid_side(count) * BENCH_SPACING;
+
+    for (uint32_t i = 0; i < count; i++) {
+        vec3 position = {
+            random_range(-extent, extent),
+            COLLISION_GROUND_HEIGHT + random_range(1.0f, 2.0f * extent + 10.0f),
+            random_range(-extent, extent),
+        };
+        vec3 rotation = {random_range(0.0f, GLM_PIf), random_range(0.0f, GLM_PIf), 0.0f};
+        vec3 velocity = {random_range(-2.0f, 2.0f), random_range(-30.0f, 0.0f), random_range(-2.0f, 2.0f)};
+        spawn_cube(state, cube, position, rotation, velocity);
+    }
+}
+
+// The grid with a tall static wall in front of its left half, which the camera can't see past
+static void scene_walls(State* state, const Object* cube, uint32_t count) {
+    scene_grid(state, cube, count);
+
+    uint32_t side = (uint32_t)ceil(cbrt((double)count));
+    float offset = 0.5f * (side - 1) * BENCH_SPACING;
+    float width = offset + BENCH_SPACING;
+
+    Object wall = *cube;
+    wall.bodyType = BODY_STATIC;
+    wall.occluder = true;
+    glm_vec3_copy((vec3){-0.5f * width, COLLISION_GROUND_HEIGHT + 0.5f * BENCH_WALL_HEIGHT, offset + BENCH_SPACING}, wall.position);
+    glm_vec3_copy((vec3){width, BENCH_WALL_HEIGHT, 1.0f}, wall.scale);
+    state_add_object(state, &wall);
+}
+
+static const Scene scenes[] = {
+    {"piles", scene_piles},
+    {"grid",  scene_grid},
+    {"rain",  scene_rain},
+    {"walls", scene_walls},
+};
+
+#define SCENE_COUNT (int)(sizeof(scenes) / sizeof(scenes[0]))
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Summarises samples, given in seconds; sorts them in place
+static void add_result(BenchResults* results, const char* scene, uint32_t count, const char* system,
+                       double* samples, int sampleCount) {
+    if (sampleCount == 0) return;
+    if (results->count == results->capacity) {
+        uint32_t capacity = results->capacity ? results->capacity * 2 : 64;
+        BenchResult* items = (BenchResult*)realloc(results->items, capacity * sizeof(BenchResult));
+        if (!items) {
+            fprintf(stderr, "ERROR: Failed to allocate benchmark results\n");
+            return;
+        }
+        results->items = items;
+        results->capacity = capacity;
+    }
+
+    qsort(samples, sampleCount, sizeof(double), compare_doubles);
+
+    double sum = 0.0;
+    for (int i = 0; i < sampleCount; i++) sum += samples[i];
+
+    int half = sampleCount / 2;
+    int p99 = (int)ceil(0.99 * sampleCount) - 1;
+
+    BenchResult* result = &results->items[results->count++];
+    result->scene = scene;
+    result->count = count;
+    result->system = system;
+    result->samples = sampleCount;
+    result->median = 1000.0 * (sampleCount % 2 ? samples[half] : 0.5 * (samples[half - 1] + samples[half]));
+    result->p99 = 1000.0 * samples[p99 < 0 ? 0 : p99];
+    result->min = 1000.0 * samples[0];
+    result->mean = 1000.0 * sum / sampleCount;
+
+    printf("%-10s %8u  %-17s %10.4f %10.4f %10.4f %10.4f\n",
+           scene, count, system, result->median, result->p99, result->min, result->mean);
+}
+
+static void bench_scene(BenchResults* results, const BenchOptions* options, const Scene* scene, uint32_t count) {
+    static State state;
+    static RenderFrame frame;
+    state_init(&state);
+    rng_state = BENCH_SEED;
+
+    Object cube;
+    object_create_cube(&cube, (vec3){1.0f, 1.0f, 1.0f}, NULL);
+
+    double start = platform_time();
+    scene->build(&state, &cube, count);
+    double spawn = platform_time() - start;
+    add_result(results, scene->name, count, "spawn", &spawn, 1);
+    object_cleanup(&cube);
+
+    // Looking down on the scene from near its edge; large scenes reach past the far plane
+    state.camera.position[1] = 20.0f;
+    state.camera.position[2] = fminf(0.5f * grid_side(count) * BENCH_SPACING, 0.5f * CAMERA_FAR);
+    state.camera.pitch = -30.0f;
+    camera_update_vectors(&state.camera);
+
+    for (int i = 0; i < options->warmup; i++) {
+        physics_step(&state.physics, &state.world, STATE_FIXED_STEP);
+    }
+
+    double* samples = (double*)malloc((PHYSICS_STAGE_COUNT + 2) * options->reps * sizeof(double));
+    if (!samples) {
+        fprintf(stderr, "ERROR: Failed to allocate benchmark samples\n");
+        state_cleanup(&state);
+        return;
+    }
+    double* stageSamples[PHYSICS_STAGE_COUNT];
+    for (int s = 0; s < PHYSICS_STAGE_COUNT; s++) stageSamples[s] = samples + s * options->reps;
+    double* stepSamples = samples + PHYSICS_STAGE_COUNT * options->reps;
+    double* buildSamples = stepSamples + options->reps;
+
+    uint32_t visible = 0;
+    for (int r = 0; r < options->reps; r++) {
+        start = platform_time();
+        physics_step(&state.physics, &state.world, STATE_FIXED_STEP);
+        stepSamples[r] = platform_time() - start;
+        for (int s = 0; s < PHYSICS_STAGE_COUNT; s++) stageSamples[s][r] = state.physics.stageTimes[s];
+
+        // What the main thread hands the render thread each frame: culling plus the draw list
+        start = platform_time();
+        render_frame_reset(&frame);
+        state_build_frame(&state, &frame, BENCH_ASPECT);
+        visible = frame.itemCount;
+        buildSamples[r] = platform_time() - start;
+    }
+
+    for (int s = 0; s < PHYSICS_STAGE_COUNT; s++) {
+        add_result(results, scene->name, count, physics_stage_name((PhysicsStage)s), stageSamples[s], options->reps);
+    }
+    add_result(results, scene->name, count, "physics_step", stepSamples, options->reps);
+    add_result(results, scene->name, count, "frame_build", buildSamples, options->reps);
+    printf("%-10s %8u  %u of %u visible, %u occluded, %u manifolds, checksum %016llx\n", scene->name, count,
+           visible, count, state.occlusion.hidden, state.physics.manifolds.count, (unsigned long long)state_checksum(&state));
+
+    free(samples);
+    render_frame_free(&frame);
+    state_cleanup(&state);
+}
+
+static void res_path(const BenchOptions* options, const char* file, char* path, size_t size) {
+    snprintf(path, size, "%s/%s", options->resDir, file);
+}
+
+static void bench_obj_load(BenchResults* results, const BenchOptions* options, const char* file, const char* name) {
+    char path[1024];
+    res_path(options, file, path, sizeof(path));
+
+    int total = options->warmup + options->reps;
+    double* samples = (double*)malloc(options->reps * sizeof(double));
+    if (!samples) return;
+
+    for (int i = 0; i < total; i++) {
+        Object obj;
+        double start = platform_time();
+        bool loaded = object_load_from_obj(&obj, path, (vec3){1.0f, 1.0f, 1.0f}, NULL);
+        double elapsed = platform_time() - start;
+        if (!loaded) {
+            fprintf(stderr, "ERROR: Failed to load '%s', skipping obj_load\n", path);
+            free(samples);
+            return;
+        }
+        if (i >= options->warmup) samples[i - options->warmup] = elapsed;
+
+        // Drop the cached mesh so every load parses and builds its BVH again
+        object_cleanup(&obj);
+        mesh_cache_free();
+    }
+
+    add_result(results, name, 0, "obj_load", samples, options->reps);
+    free(samples);
+}
+
+static void bench_simplify(BenchResults* results, const BenchOptions* options, const char* file, const char* name) {
+    char path[1024];
+    res_path(options, file, path, sizeof(path));
+
+    Object obj;
+    if (!object_load_from_obj(&obj, path, (vec3){1.0f, 1.0f, 1.0f}, NULL) || !obj.mesh) {
+        fprintf(stderr, "ERROR: Failed to load '%s', skipping simplify\n", path);
+        return;
+    }
+    const Mesh* mesh = obj.mesh;
+
+    int total = options->warmup + options->reps;
+    uint32_t indexCount = mesh->triangleCount * 3;
+    double* samples = (double*)malloc(options->reps * sizeof(double));
+    uint32_t* simplified = (uint32_t*)malloc(indexCount * sizeof(uint32_t));
+    if (samples && simplified) {
+        // The first LOD step; the collision copy has positions only, which is all the cost model needs
+        for (int i = 0; i < total; i++) {
+            double start = platform_time();
+            simplify_mesh((const float*)mesh->positions, mesh->vertexCount, 3, mesh->indices, indexCount,
+                          indexCount / 6 * 3, simplified);
+            double elapsed = platform_time() - start;
+            if (i >= options->warmup) samples[i - options->warmup] = elapsed;
+        }
+        add_result(results, name, mesh->triangleCount, "simplify", samples, options->reps);
+    }
+
+    free(samples);
+    free(simplified);
+    object_cleanup(&obj);
+    mesh_cache_free();
+}
+
+static void bench_texture_decode(BenchResults* results, const BenchOptions* options, const char* file, const char* name) {
+    char path[1024];
+    res_path(options, file, path, sizeof(path));
+
+    int total = options->warmup + options->reps;
+    double* samples = (double*)malloc(options->reps * sizeof(double));
+    if (!samples) return;
+
+    for (int i = 0; i < total; i++) {
+        int width, height, channels;
+        double start = platform_time();
+        unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+        double elapsed = platform_time() - start;
+        if (!data) {
+            fprintf(stderr, "ERROR: Failed to decode texture '%s'\n", path);
+            free(samples);
+            return;
+        }
+        stbi_image_free(data);
+        if (i >= options->warmup) samples[i - options->warmup] = elapsed;
+    }
+
+    add_result(results, name, 0, "texture_decode", samples, options->reps);
+    free(samples);
+}
+
+static bool write_json(const BenchResults* results, const BenchOptions* options, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "ERROR: Failed to open '%s' for writing\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"threads\": %d,\n  \"warmup\": %d,\n  \"reps\": %d,\n  \"results\": [\n",
+            jobs_thread_count(), options->warmup, options->reps);
+    for (uint32_t i = 0; i < results->count; i++) {
+        const BenchResult* r = &results->items[i];
+        fprintf(file, "    {\"scene\": \"%s\", \"count\": %u, \"system\": \"%s\", \"samples\": %d, "
+                      "\"median_ms\": %.6f, \"p99_ms\": %.6f, \"min_ms\": %.6f, \"mean_ms\": %.6f}%s\n",
+                r->scene, r->count, r->system, r->samples, r->median, r->p99, r->min, r->mean,
+                i + 1 < results->count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    fclose(file);
+    return true;
+}
+
+static bool write_csv(const BenchResults* results, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "ERROR: Failed to open '%s' for writing\n", path);
+        return false;
+    }
+
+    fprintf(file, "scene,count,system,samples,median_ms,p99_ms,min_ms,mean_ms\n");
+    for (uint32_t i = 0; i < results->count; i++) {
+        const BenchResult* r = &results->items[i];
+        fprintf(file, "%s,%u,%s,%d,%.6f,%.6f,%.6f,%.6f\n",
+                r->scene, r->count, r->system, r->samples, r->median, r->p99, r->min, r->mean);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static const Scene* find_scene(const char* name) {
+    for (int i = 0; i < SCENE_COUNT; i++) {
+        if (strcmp(scenes[i].name, name) == 0) return &scenes[i];
+    }
+    return NULL;
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->warmup = 10;
+    options->reps = 50;
+    options->resDir = "../res";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc && options->sceneCount < BENCH_MAX_LISTED) {
+            const Scene* scene = find_scene(argv[++i]);
+            if (!scene) {
+                fprintf(stderr, "Unknown scene '%s'\n", argv[i]);
+                return false;
+            }
+            options->scenes[options->sceneCount++] = scene;
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc && options->countCount < BENCH_MAX_LISTED) {
+            long count = strtol(argv[++i], NULL, 10);
+            if (count < 1 || count > BENCH_MAX_COUNT) {
+                fprintf(stderr, "Counts must be between 1 and %d\n", BENCH_MAX_COUNT);
+                return false;
+            }
+            options->counts[options->countCount++] = (uint32_t)count;
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options->warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            options->reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options->threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            options->jsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            options->csvPath = argv[++i];
+        } else if (strcmp(argv[i], "--res") == 0 && i + 1 < argc) {
+            options->resDir = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--scene piles|grid|rain|walls]... [--count N]... [--warmup W] [--reps R]\n"
+                            "       [--threads T] [--json FILE] [--csv FILE] [--res DIR]\n", argv[0]);
+            return false;
+        }
+    }
+
+    if (options->reps < 1 || options->warmup < 0) {
+        fprintf(stderr, "Need at least one repetition and no negative warmup\n");
+        return false;
+    }
+
+    if (options->sceneCount == 0) {
+        for (int i = 0; i < SCENE_COUNT; i++) options->scenes[options->sceneCount++] = &scenes[i];
+    }
+    if (options->countCount == 0) {
+        options->counts[options->countCount++] = 100;
+        options->counts[options->countCount++] = 1000;
+        options->counts[options->countCount++] = 10000;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        return -1;
+    }
+
+    object_set_headless(true);
+    jobs_init(options.threads);
+
+    BenchResults results = {0};
+    printf("%-10s %8s  %-17s %10s %10s %10s %10s\n", "scene", "count", "system", "median ms", "p99 ms", "min ms", "mean ms");
+
+    for (int s = 0; s < options.sceneCount; s++) {
+        for (int c = 0; c < options.countCount; c++) {
+            bench_scene(&results, &options, options.scenes[s], options.counts[c]);
+        }
+    }
+
+    bench_obj_load(&results, &options, "objs/gun.obj", "gun.obj");
+    bench_obj_load(&results, &options, "objs/hut.obj", "hut.obj");
+    bench_simplify(&results, &options, "objs/gun.obj", "gun.obj");
+    bench_texture_decode(&results, &options, "textures/stone.jpg", "stone.jpg");
+    bench_texture_decode(&results, &options, "textures/grid.png", "grid.png");
+
+    bool ok = true;
+    if (options.jsonPath) ok &= write_json(&results, &options, options.jsonPath);
+    if (options.csvPath) ok &= write_csv(&results, options.csvPath);
+
+    free(results.items);
+    jobs_shutdown();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+#include "batch.h"
+#include "camera.h"
+#include "geometry.h"
+#include "memstats.h"
+#include "object.h"
+
+#define BATCH_MASK (COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BODY) | \
+                    COMPONENT_BIT(COMPONENT_RENDERABLE) | COMPONENT_BIT(COMPONENT_COLLIDER))
+
+typedef struct {
+    Renderable*      renderable;
+    const Transform* transform;
+    const Collider*  collider;
+    uint32_t         order;     // query order, so batches come out the same every run
+} BatchMember;
+
+static int compare_materials(const Renderable* a, const Renderable* b) {
+    if (a->textureID != b->textureID) return a->textureID < b->textureID ? -1 : 1;
+    if (a->textureScale != b->textureScale) return a->textureScale < b->textureScale ? -1 : 1;
+    for (int k = 0; k < 3; k++) {
+        if (a->color[k] != b->color[k]) return a->color[k] < b->color[k] ? -1 : 1;
+    }
+    return 0;
+}
+
+static int compare_members(const void* a, const void* b) {
+    const BatchMember* x = (const BatchMember*)a;
+    const BatchMember* y = (const BatchMember*)b;
+    int material = compare_materials(x->renderable, y->renderable);
+    if (material != 0) return material;
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+static bool same_range(const GeometryRange* a, const GeometryRange* b) {
+    return a->VAO == b->VAO && a->firstIndex == b->firstIndex && a->baseVertex == b->baseVertex;
+}
+
+// Positions by the model matrix and normals by its inverse transpose, as the vertex shader would
+static void transform_vertices(float* vertices, uint32_t count, const mat4 model) {
+    mat4 inverse;
+    mat3 normalMatrix;
+    glm_mat4_inv((vec4*)model, inverse);
+    glm_mat4_transpose(inverse);
+    glm_mat4_pick3(inverse, normalMatrix);
+
+    for (uint32_t i = 0; i < count; i++) {
+        float* vertex = &vertices[i * GEOMETRY_VERTEX_FLOATS];
+        vec3 position, normal;
+        glm_mat4_mulv3((vec4*)model, vertex, 1.0f, position);
+        glm_mat3_mulv(normalMatrix, &vertex[3], normal);
+        glm_vec3_copy(position, vertex);
+        glm_vec3_copy(normal, &vertex[3]);
+    }
+}
+
+// Index-less meshes were given a sequential list in the shared geometry
+static uint32_t full_index_count(const Renderable* renderable) {
+    return (uint32_t)(renderable->indexCount > 0 ? renderable->indexCount : renderable->vertexCount);
+}
+
+static bool batch_members(StaticBatches* batches, const BatchMember* members, uint32_t memberCount) {
+    // Batches draw at full detail, so each member's simplified levels are read past its full
+    // index list and then written over by the next member's
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t levelSpace = 0;
+    for (uint32_t i = 0; i < memberCount; i++) {
+        GeometryRange range = renderable_range(members[i].renderable);
+        uint32_t fullCount = full_index_count(members[i].renderable);
+        vertexCount += range.vertexCount;
+        indexCount += fullCount;
+        if (range.indexCount - fullCount > levelSpace) levelSpace = range.indexCount - fullCount;
+    }
+
+    float* vertices = (float*)mem_alloc(MEMORY_MESH, (size_t)vertexCount * GEOMETRY_VERTEX_FLOATS * sizeof(float));
+    uint32_t* indices = (uint32_t*)mem_alloc(MEMORY_MESH, ((size_t)indexCount + levelSpace) * sizeof(uint32_t));
+    BatchPart* parts = (BatchPart*)mem_alloc(MEMORY_MESH, memberCount * sizeof(BatchPart));
+    StaticBatch* grown = (StaticBatch*)mem_realloc(MEMORY_MESH, batches->batches, (batches->count + 1) * sizeof(StaticBatch));
+    if (grown) batches->batches = grown;
+
+    bool merged = vertices && indices && parts && grown;
+    uint32_t vertex = 0;
+    uint32_t index = 0;
+    for (uint32_t i = 0; merged && i < memberCount; i++) {
+        GeometryRange range = renderable_range(members[i].renderable);
+        uint32_t fullCount = full_index_count(members[i].renderable);
+        parts[i].aabb = members[i].collider->aabb;
+        parts[i].firstIndex = index;
+        parts[i].indexCount = fullCount;
+        glm_vec3_zero(parts[i].offset);
+        parts[i].moved = false;
+        parts[i].removed = false;
+
+        // Copies of one template come out next to each other, so each distinct mesh is read
+        // back once and its copies take it from the member before
+        GeometryRange previous;
+        if (i > 0) previous = renderable_range(members[i - 1].renderable);
+        if (i > 0 && same_range(&range, &previous)) {
+            memcpy(&vertices[(size_t)vertex * GEOMETRY_VERTEX_FLOATS], &vertices[(size_t)(vertex - range.vertexCount) * GEOMETRY_VERTEX_FLOATS],
+                   (size_t)range.vertexCount * GEOMETRY_VERTEX_FLOATS * sizeof(float));
+            memcpy(&indices[index], &indices[parts[i - 1].firstIndex], fullCount * sizeof(uint32_t));
+        } else if (!geometry_read(&range, &vertices[(size_t)vertex * GEOMETRY_VERTEX_FLOATS], &indices[index])) {
+            merged = false;
+        }
+        vertex += range.vertexCount;
+        index += fullCount;
+    }
+
+    // Only once every copy has its mesh do they move into world space
+    vertex = 0;
+    for (uint32_t i = 0; merged && i < memberCount; i++) {
+        uint32_t memberVertices = renderable_range(members[i].renderable).vertexCount;
+        transform_vertices(&vertices[(size_t)vertex * GEOMETRY_VERTEX_FLOATS], memberVertices, members[i].transform->model);
+        for (uint32_t k = 0; k < parts[i].indexCount; k++) {
+            indices[parts[i].firstIndex + k] += vertex;
+        }
+        vertex += memberVertices;
+    }
+
+    GeometryRange range;
+    merged = merged && geometry_add(vertices, vertexCount, indices, indexCount, &range);
+    mem_free(vertices);
+    mem_free(indices);
+    if (!merged) {
+        fprintf(stderr, "ERROR: Failed to batch %u static objects, drawing them separately\n", memberCount);
+        mem_free(parts);
+        return false;
+    }
+
+    uint32_t batchIndex = batches->count++;
+    StaticBatch* batch = &batches->batches[batchIndex];
+    batch->renderable = *members[0].renderable;
+    batch->renderable.VAO = range.VAO;
+    batch->renderable.firstIndex = range.firstIndex;
+    batch->renderable.baseVertex = range.baseVertex;
+    batch->renderable.vertexCount = (int)range.vertexCount;
+    batch->renderable.indexCount = (int)range.indexCount;
+    memset(batch->renderable.lodIndexCounts, 0, sizeof(batch->renderable.lodIndexCounts));
+    batch->renderable.lodIndexCounts[0] = range.indexCount;
+    batch->renderable.lodCount = 1;
+    batch->renderable.lod = 0;
+    batch->renderable.batched = false;
+    batch->parts = parts;
+    batch->partCount = memberCount;
+
+    batch->aabb = parts[0].aabb;
+    for (uint32_t i = 0; i < memberCount; i++) {
+        glm_vec3_minv(batch->aabb.min, parts[i].aabb.min, batch->aabb.min);
+        glm_vec3_maxv(batch->aabb.max, parts[i].aabb.max, batch->aabb.max);
+
+        // Each member drops only its own reference; copies outside the batch, like a dynamic
+        // one spawned from the same template, keep drawing from the range
+        GeometryRange own = renderable_range(members[i].renderable);
+        geometry_release(&own);
+        members[i].renderable->batched = true;
+        members[i].renderable->batch = batchIndex;
+        members[i].renderable->batchPart = i;
+    }
+    return true;
+}
+
+void static_batches_build(StaticBatches* batches, World* world) {
+    uint32_t capacity = ecs_count(world, BATCH_MASK);
+    if (capacity == 0) return;
+
+    BatchMember* members = (BatchMember*)mem_alloc(MEMORY_MESH, capacity * sizeof(BatchMember));
+    if (!members) {
+        fprintf(stderr, "ERROR: Failed to allocate %u static batch members\n", capacity);
+        return;
+    }
+
+    uint32_t count = 0;
+    EcsQuery query = ecs_query(world, BATCH_MASK);
+    while (ecs_query_next(&query)) {
+        Transform* transforms = (Transform*)ecs_query_column(&query, COMPONENT_TRANSFORM);
+        Body* bodies = (Body*)ecs_query_column(&query, COMPONENT_BODY);
+        Renderable* renderables = (Renderable*)ecs_query_column(&query, COMPONENT_RENDERABLE);
+        Collider* colliders = (Collider*)ecs_query_column(&query, COMPONENT_COLLIDER);
+
+        for (uint32_t i = 0; i < query.count; i++) {
+            if (bodies[i].type != BODY_STATIC || renderables[i].VAO == 0 || renderables[i].batched) continue;
+
+            members[count].renderable = &renderables[i];
+            members[count].transform = &transforms[i];
+            members[count].collider = &colliders[i];
+            members[count].order = count;
+            count++;
+        }
+    }
+    qsort(members, count, sizeof(BatchMember), compare_members);
+
+    uint32_t start = 0;
+    while (start < count) {
+        uint32_t end = start + 1;
+        while (end < count && compare_materials(members[start].renderable, members[end].renderable) == 0) end++;
+
+        // A batch of one would draw just as often
+        if (end - start > 1) batch_members(batches, &members[start], end - start);
+        start = end;
+    }
+    mem_free(members);
+}
+
+static BatchPart* find_part(StaticBatches* batches, const Renderable* renderable) {
+    if (!renderable->batched || renderable->batch >= batches->count ||
+        renderable->batchPart >= batches->batches[renderable->batch].partCount) {
+        fprintf(stderr, "ERROR: Renderable is not part of a static batch\n");
+        return NULL;
+    }
+    return &batches->batches[renderable->batch].parts[renderable->batchPart];
+}
+
+void static_batches_remove(StaticBatches* batches, const Renderable* renderable) {
+    BatchPart* part = find_part(batches, renderable);
+    if (part) part->removed = true;
+}
+
+void static_batches_move(StaticBatches* batches, const Renderable* renderable, const vec3 offset, const AABB* aabb) {
+    BatchPart* part = find_part(batches, renderable);
+    if (!part) return;
+
+    glm_vec3_add(part->offset, (float*)offset, part->offset);
+    part->moved = true;
+    part->aabb = *aabb;
+
+    // The batch's box only grows, so it may pass a few more batches than it has to
+    StaticBatch* batch = &batches->batches[renderable->batch];
+    glm_vec3_minv(batch->aabb.min, part->aabb.min, batch->aabb.min);
+    glm_vec3_maxv(batch->aabb.max, part->aabb.max, batch->aabb.max);
+}
+
+void static_batches_cull(const StaticBatches* batches, vec4 frustum[6], Occlusion* occlusion, RenderFrame* frame) {
+    mat4 identity = GLM_MAT4_IDENTITY_INIT;
+
+    for (uint32_t b = 0; b < batches->count; b++) {
+        const StaticBatch* batch = &batches->batches[b];
+        if (!camera_aabb_visible(frustum, &batch->aabb)) continue;
+
+        // Parts are laid out back to back, so a run of visible ones is one draw
+        Renderable run;
+        bool open = false;
+        for (uint32_t part = 0; part < batch->partCount; part++) {
+            const BatchPart* current = &batch->parts[part];
+            bool visible = !current->removed && camera_aabb_visible(frustum, &current->aabb) &&
+                           occlusion_aabb_visible(occlusion, &current->aabb);
+            if (!visible || current->moved) {
+                if (open) render_frame_push(frame, &run, identity);
+                open = false;
+            }
+            if (!visible) continue;
+
+            // Its triangles are still where it was batched, so it is drawn alone and shifted
+            if (current->moved) {
+                Renderable alone = batch->renderable;
+                alone.firstIndex += current->firstIndex;
+                alone.indexCount = (int)current->indexCount;
+                mat4 shift;
+                glm_translate_make(shift, (float*)current->offset);
+                render_frame_push(frame, &alone, shift);
+                continue;
+            }
+
+            if (!open) {
+                run = batch->renderable;
+                run.firstIndex += current->firstIndex;
+                run.indexCount = 0;
+                open = true;
+            }
+            run.indexCount += (int)current->indexCount;
+        }
+        if (open) render_frame_push(frame, &run, identity);
+    }
+}
+
+void static_batches_free(StaticBatches* batches) {
+    for (uint32_t b = 0; b < batches->count; b++) {
+        GeometryRange range = renderable_range(&batches->batches[b].renderable);
+        geometry_release(&range);
+        mem_free(batches->batches[b].parts);
+    }
+    mem_free(batches->batches);
+    batches->batches = NULL;
+    batches->count = 0;
+}
@@ -0,0 +1,48 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "common.h"
+#include "ecs.h"
+#include "occlusion.h"
+#include "renderframe.h"
+
+// One merged object's triangles inside a batch, culled on its own
+typedef struct {
+    AABB     aabb;          // world space, as its collider has it
+    uint32_t firstIndex;    // relative to the batch's first index
+    uint32_t indexCount;
+    vec3     offset;        // how far its entity moved since it was batched
+    bool     moved;         // drawn on its own, shifted by offset
+    bool     removed;       // its entity is gone, so it isn't drawn
+} BatchPart;
+
+// Static objects sharing a texture, color and texture scale, merged into one mesh that's
+// already in world space
+typedef struct {
+    Renderable renderable;
+    AABB       aabb;        // encloses every part
+    BatchPart* parts;
+    uint32_t   partCount;
+} StaticBatch;
+
+typedef struct {
+    StaticBatch* batches;
+    uint32_t     count;
+} StaticBatches;
+
+// Merges static renderables sharing a material into batches and marks them batched, so they
+// stop drawing on their own. Their geometry moves into the batch, so moving or destroying one
+// afterwards has to go through static_batches_move or static_batches_remove. Objects without
+// geometry (headless) are left alone.
+void static_batches_build(StaticBatches* batches, World* world);
+// Stops drawing a batched renderable, for when its entity is destroyed
+void static_batches_remove(StaticBatches* batches, const Renderable* renderable);
+// Shifts a batched renderable by offset, drawing it apart from the rest of its batch; aabb is
+// its collider's box after the move
+void static_batches_move(StaticBatches* batches, const Renderable* renderable, const vec3 offset, const AABB* aabb);
+// Pushes each batch's parts that are in view and not occluded, joining neighbouring parts
+// into one draw
+void static_batches_cull(const StaticBatches* batches, vec4 frustum[6], Occlusion* occlusion, RenderFrame* frame);
+void static_batches_free(StaticBatches* batches);
+
+#endif
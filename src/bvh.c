@@ -0,0 +1,311 @@
+#include "bvh.h"
+#include "memstats.h"
+#include <float.h>
+#include <math.h>
+
+#define BVH_BINS 16
+
+typedef struct {
+    const AABB* bounds;
+    vec3*       centroids;
+    Bvh*        bvh;
+} BvhBuilder;
+
+typedef struct {
+    AABB     bounds;
+    uint32_t count;
+} BvhBin;
+
+static void aabb_empty(AABB* box) {
+    glm_vec3_fill(box->min, FLT_MAX);
+    glm_vec3_fill(box->max, -FLT_MAX);
+}
+
+static void aabb_grow(AABB* box, const AABB* other) {
+    glm_vec3_minv(box->min, (float*)other->min, box->min);
+    glm_vec3_maxv(box->max, (float*)other->max, box->max);
+}
+
+static float aabb_area(const AABB* box) {
+    vec3 size;
+    glm_vec3_sub((float*)box->max, (float*)box->min, size);
+    if (size[0] < 0.0f) return 0.0f;
+    return 2.0f * (size[0] * size[1] + size[1] * size[2] + size[2] * size[0]);
+}
+
+bool aabb_overlaps(const AABB* a, const AABB* b) {
+    return a->min[0] <= b->max[0] && a->max[0] >= b->min[0] &&
+           a->min[1] <= b->max[1] && a->max[1] >= b->min[1] &&
+           a->min[2] <= b->max[2] && a->max[2] >= b->min[2];
+}
+
+bool aabb_raycast(const AABB* box, const vec3 origin, const vec3 inverseDirection, float maxDistance, float* distance) {
+    float near = 0.0f;
+    float far = maxDistance;
+
+    for (int i = 0; i < 3; i++) {
+        float t0 = (box->min[i] - origin[i]) * inverseDirection[i];
+        float t1 = (box->max[i] - origin[i]) * inverseDirection[i];
+        if (t0 > t1) {
+            float swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+
+        // NaN from 0 * inf (origin on a slab with a parallel ray) leaves the range alone
+        if (t0 > near) near = t0;
+        if (t1 < far) far = t1;
+        if (near > far) return false;
+    }
+
+    *distance = near;
+    return true;
+}
+
+static float bin_scale(const AABB* centroidBounds, int axis) {
+    float extent = centroidBounds->max[axis] - centroidBounds->min[axis];
+    return extent > 0.0f ? BVH_BINS / extent : 0.0f;
+}
+
+static int bin_index(const AABB* centroidBounds, float scale, int axis, const vec3 centroid) {
+    int bin = (int)((centroid[axis] - centroidBounds->min[axis]) * scale);
+    return bin < BVH_BINS - 1 ? bin : BVH_BINS - 1;
+}
+
+// Finds the cheapest binned split, returning false when a leaf is cheaper
+static bool find_split(BvhBuilder* builder, uint32_t start, uint32_t end, const AABB* nodeBounds,
+                       const AABB* centroidBounds, int* splitAxis, int* splitBin) {
+    uint32_t* primitives = builder->bvh->primitives;
+    float bestCost = FLT_MAX;
+
+    for (int axis = 0; axis < 3; axis++) {
+        float scale = bin_scale(centroidBounds, axis);
+        if (scale == 0.0f) continue;
+
+        BvhBin bins[BVH_BINS];
+        for (int b = 0; b < BVH_BINS; b++) {
+            aabb_empty(&bins[b].bounds);
+            bins[b].count = 0;
+        }
+
+        for (uint32_t i = start; i < end; i++) {
+            uint32_t primitive = primitives[i];
+            BvhBin* bin = &bins[bin_index(centroidBounds, scale, axis, builder->centroids[primitive])];
+            aabb_grow(&bin->bounds, &builder->bounds[primitive]);
+            bin->count++;
+        }
+
+        // Sweep from the right to get the cost of every right-hand side, then from the left
+        float rightArea[BVH_BINS];
+        uint32_t rightCount[BVH_BINS];
+        AABB box;
+        aabb_empty(&box);
+        uint32_t count = 0;
+        for (int b = BVH_BINS - 1; b > 0; b--) {
+            aabb_grow(&box, &bins[b].bounds);
+            count += bins[b].count;
+            rightArea[b] = aabb_area(&box);
+            rightCount[b] = count;
+        }
+
+        aabb_empty(&box);
+        count = 0;
+        for (int b = 0; b < BVH_BINS - 1; b++) {
+            aabb_grow(&box, &bins[b].bounds);
+            count += bins[b].count;
+            if (count == 0 || rightCount[b + 1] == 0) continue;
+
+            float cost = aabb_area(&box) * count + rightArea[b + 1] * rightCount[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                *splitAxis = axis;
+                *splitBin = b;
+            }
+        }
+    }
+
+    uint32_t count = end - start;
+    float leafCost = aabb_area(nodeBounds) * count;
+    if (bestCost == FLT_MAX) return false;
+    return count > BVH_MAX_LEAF || bestCost < leafCost;
+}
+
+// Levels a range needs when halved by count until it fits in leaves of one
+static uint32_t halving_depth(uint32_t count) {
+    uint32_t depth = 0;
+    while ((1u << depth) < count && depth < 31) depth++;
+    return depth;
+}
+
+static void build_node(BvhBuilder* builder, uint32_t nodeIndex, uint32_t start, uint32_t end, uint32_t depth) {
+    Bvh* bvh = builder->bvh;
+    uint32_t* primitives = bvh->primitives;
+    BvhNode* node = &bvh->nodes[nodeIndex];
+
+    AABB centroidBounds;
+    aabb_empty(&node->bounds);
+    aabb_empty(&centroidBounds);
+    for (uint32_t i = start; i < end; i++) {
+        aabb_grow(&node->bounds, &builder->bounds[primitives[i]]);
+        glm_vec3_minv(centroidBounds.min, builder->centroids[primitives[i]], centroidBounds.min);
+        glm_vec3_maxv(centroidBounds.max, builder->centroids[primitives[i]], centroidBounds.max);
+    }
+
+    node->first = start;
+    node->count = (uint16_t)(end - start);
+    node->axis = 0;
+
+    int axis = 0, bin = 0;
+    if (end - start <= BVH_LEAF_SIZE) return;
+
+    // SAH splits can be lopsided without limit, so once the range could only just be halved
+    // down to leaves within the traversal stack, it is halved by count from there on
+    if (depth + halving_depth(end - start) >= BVH_STACK_SIZE - 1) {
+        axis = -1;
+    } else if (!find_split(builder, start, end, &node->bounds, &centroidBounds, &axis, &bin)) {
+        if (end - start <= BVH_MAX_LEAF) return;
+
+        // Every centroid coincides, so no binned split exists; halve by count instead
+        axis = -1;
+    }
+
+    uint32_t middle = start;
+    if (axis >= 0) {
+        float scale = bin_scale(&centroidBounds, axis);
+        for (uint32_t i = start; i < end; i++) {
+            if (bin_index(&centroidBounds, scale, axis, builder->centroids[primitives[i]]) <= bin) {
+                uint32_t swap = primitives[i];
+                primitives[i] = primitives[middle];
+                primitives[middle++] = swap;
+            }
+        }
+    } else {
+        middle = start + (end - start) / 2;
+        axis = 0;
+    }
+
+    uint32_t left = bvh->nodeCount++;
+    build_node(builder, left, start, middle, depth + 1);
+
+    uint32_t right = bvh->nodeCount++;
+    build_node(builder, right, middle, end, depth + 1);
+
+    // Building the children may not move the node array, it was sized up front
+    node->first = right;
+    node->count = 0;
+    node->axis = (uint16_t)axis;
+}
+
+bool bvh_build(Bvh* bvh, const AABB* bounds, uint32_t count) {
+    bvh->nodeCount = 0;
+    bvh->primitiveCount = 0;
+    if (count == 0) return true;
+
+    if (count > bvh->capacity) {
+        BvhNode* nodes = (BvhNode*)mem_realloc(MEMORY_PHYSICS, bvh->nodes, (2 * count - 1) * sizeof(BvhNode));
+        if (nodes) bvh->nodes = nodes;
+        uint32_t* primitives = (uint32_t*)mem_realloc(MEMORY_PHYSICS, bvh->primitives, count * sizeof(uint32_t));
+        if (primitives) bvh->primitives = primitives;
+
+        if (!nodes || !primitives) {
+            fprintf(stderr, "ERROR: Failed to allocate BVH for %u primitives\n", count);
+            return false;
+        }
+        bvh->capacity = count;
+    }
+
+    vec3* centroids = (vec3*)mem_alloc(MEMORY_PHYSICS, count * sizeof(vec3));
+    if (!centroids) {
+        fprintf(stderr, "ERROR: Failed to allocate BVH for %u primitives\n", count);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        bvh->primitives[i] = i;
+        glm_vec3_add((float*)bounds[i].min, (float*)bounds[i].max, centroids[i]);
+        glm_vec3_scale(centroids[i], 0.5f, centroids[i]);
+    }
+
+    BvhBuilder builder = {bounds, centroids, bvh};
+    bvh->primitiveCount = count;
+    bvh->nodeCount = 1;
+    build_node(&builder, 0, 0, count, 0);
+
+    mem_free(centroids);
+    return true;
+}
+
+void bvh_free(Bvh* bvh) {
+    mem_free(bvh->nodes);
+    mem_free(bvh->primitives);
+    memset(bvh, 0, sizeof(*bvh));
+}
+
+void bvh_query(const Bvh* bvh, const AABB* box, BvhQueryFunc func, void* data) {
+    if (bvh->nodeCount == 0) return;
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BvhNode* node = &bvh->nodes[stack[--top]];
+        if (!aabb_overlaps(&node->bounds, box)) continue;
+
+        if (node->count > 0) {
+            for (uint32_t i = node->first; i < node->first + node->count; i++) {
+                if (!func(bvh->primitives[i], data)) return;
+            }
+        } else {
+            stack[top++] = node->first;
+            stack[top++] = (uint32_t)(node - bvh->nodes) + 1;
+        }
+    }
+}
+
+uint32_t bvh_raycast(const Bvh* bvh, const vec3 origin, const vec3 direction, float maxDistance,
+                     BvhRayFunc func, void* data, float* distance) {
+    uint32_t hit = UINT32_MAX;
+    if (bvh->nodeCount == 0) return hit;
+
+    vec3 inverse;
+    for (int i = 0; i < 3; i++) {
+        inverse[i] = 1.0f / direction[i];
+    }
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const BvhNode* node = &bvh->nodes[index];
+
+        float entry;
+        if (!aabb_raycast(&node->bounds, origin, inverse, maxDistance, &entry)) continue;
+
+        if (node->count > 0) {
+            for (uint32_t i = node->first; i < node->first + node->count; i++) {
+                float t = func(bvh->primitives[i], origin, direction, maxDistance, data);
+                if (t >= 0.0f && t < maxDistance) {
+                    maxDistance = t;
+                    hit = bvh->primitives[i];
+                }
+            }
+            if (hit != UINT32_MAX && maxDistance <= 0.0f) break;
+        } else {
+            // Push the far child first so the near one is visited first and shrinks the ray
+            uint32_t near = index + 1;
+            uint32_t far = node->first;
+            if (direction[node->axis] < 0.0f) {
+                near = node->first;
+                far = index + 1;
+            }
+            stack[top++] = far;
+            stack[top++] = near;
+        }
+    }
+
+    if (hit != UINT32_MAX) *distance = maxDistance;
+    return hit;
+}
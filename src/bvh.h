@@ -0,0 +1,49 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "common.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BVH_LEAF_SIZE 4     // ranges this small always become leaves
+#define BVH_MAX_LEAF 16     // ranges larger than this are always split
+#define BVH_STACK_SIZE 64   // traversal stack; builds keep leaves within BVH_STACK_SIZE - 1 levels
+
+// 32 bytes. Children of an inner node are the next node and the node at right.
+typedef struct {
+    AABB     bounds;
+    uint32_t first;     // leaf: first entry in primitives; inner: index of the right child
+    uint16_t count;     // primitives in a leaf, 0 for inner nodes
+    uint16_t axis;      // split axis, for front to back traversal
+} BvhNode;
+
+// Static bounding volume hierarchy over caller-owned primitives, flattened depth first
+typedef struct {
+    BvhNode*  nodes;
+    uint32_t  nodeCount;
+    uint32_t* primitives;   // primitive indices in leaf order
+    uint32_t  primitiveCount;
+    uint32_t  capacity;     // primitives the arrays can hold, so rebuilds don't reallocate
+} Bvh;
+
+// Returns true to keep visiting primitives
+typedef bool (*BvhQueryFunc)(uint32_t primitive, void* data);
+// Returns the distance along the ray to the primitive, or a negative value on a miss.
+// Returning 0 ends the traversal, which lets a caller stop at the first hit.
+typedef float (*BvhRayFunc)(uint32_t primitive, const vec3 origin, const vec3 direction, float maxDistance, void* data);
+
+// Builds with the surface area heuristic over binned centroids. bvh must be zeroed or
+// previously built; its arrays are reused when large enough.
+bool bvh_build(Bvh* bvh, const AABB* bounds, uint32_t count);
+void bvh_free(Bvh* bvh);
+
+void bvh_query(const Bvh* bvh, const AABB* box, BvhQueryFunc func, void* data);
+// Nearest hit within maxDistance, visiting children front to back. Returns the primitive
+// index or UINT32_MAX.
+uint32_t bvh_raycast(const Bvh* bvh, const vec3 origin, const vec3 direction, float maxDistance,
+                     BvhRayFunc func, void* data, float* distance);
+
+bool aabb_overlaps(const AABB* a, const AABB* b);
+bool aabb_raycast(const AABB* box, const vec3 origin, const vec3 inverseDirection, float maxDistance, float* distance);
+
+#endif
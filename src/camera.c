@@ -30,6 +30,39 @@ void camera_get_view_matrix(Camera* camera, mat4 view) {
     glm_lookat(camera->position, center, camera->up, view);
 }
 
+void camera_get_projection_matrix(Camera* camera, float aspect, mat4 projection) {
+    glm_perspective(glm_rad(camera->fov), aspect, CAMERA_NEAR, CAMERA_FAR, projection);
+}
+
+void camera_screen_ray(Camera* camera, float x, float y, float width, float height, vec3 origin, vec3 direction) {
+    mat4 view, projection, viewProjection;
+    camera_get_view_matrix(camera, view);
+    camera_get_projection_matrix(camera, width / height, projection);
+    glm_mat4_mul(projection, view, viewProjection);
+
+    // Unproject the cursor on the near and far planes
+    vec4 viewport = {0.0f, 0.0f, width, height};
+    vec3 near, far;
+    glm_unproject((vec3){x, height - y, 0.0f}, viewProjection, viewport, near);
+    glm_unproject((vec3){x, height - y, 1.0f}, viewProjection, viewport, far);
+
+    glm_vec3_copy(near, origin);
+    glm_vec3_sub(far, near, direction);
+    glm_vec3_normalize(direction);
+}
+
+void camera_get_frustum(Camera* camera, float aspect, vec4 planes[6]) {
+    mat4 view, projection, viewProjection;
+    camera_get_view_matrix(camera, view);
+    camera_get_projection_matrix(camera, aspect, projection);
+    glm_mat4_mul(projection, view, viewProjection);
+    glm_frustum_planes(viewProjection, planes);
+}
+
+bool camera_aabb_visible(vec4 planes[6], const AABB* box) {
+    return glm_aabb_frustum((vec3*)box, planes);
+}
+
 void camera_process_keyboard(Camera* camera, int direction, float deltaTime) {
     float velocity = camera->speed * deltaTime;
     if (direction == 0) // FORWARD
@@ -3,6 +3,9 @@
 
 #include "common.h"
 
+#define CAMERA_NEAR 0.1f
+#define CAMERA_FAR 100.0f
+
 typedef struct {
     vec3 position;
     vec3 front;
@@ -18,6 +21,13 @@ typedef struct {
 void camera_init(Camera* camera);
 void camera_update_vectors(Camera* camera);
 void camera_get_view_matrix(Camera* camera, mat4 view);
+void camera_get_projection_matrix(Camera* camera, float aspect, mat4 projection);
+// World-space ray through a window position, with y growing downwards as GLFW reports it
+void camera_screen_ray(Camera* camera, float x, float y, float width, float height, vec3 origin, vec3 direction);
+// View volume as six inward-facing planes, in the order cglm extracts them
+void camera_get_frustum(Camera* camera, float aspect, vec4 planes[6]);
+// Conservative: false only when the box is entirely outside one of the planes
+bool camera_aabb_visible(vec4 planes[6], const AABB* box);
 void camera_process_keyboard(Camera* camera, int direction, float deltaTime);
 void camera_process_mouse_movement(Camera* camera, float xoffset, float yoffset, GLboolean constrainPitch);
 void camera_process_mouse_scroll(Camera* camera, float yoffset);
@@ -0,0 +1,361 @@
+#include "collision.h"
+#include <math.h>
+
+void obb_from_bounds(const AABB* bounds, mat4 model, OBB* box) {
+    vec3 center;
+    glm_vec3_add((float*)bounds->min, (float*)bounds->max, center);
+    glm_vec3_scale(center, 0.5f, center);
+    glm_mat4_mulv3(model, center, 1.0f, box->center);
+
+    for (int i = 0; i < 3; i++) {
+        vec3 column = {model[i][0], model[i][1], model[i][2]};
+        float length = glm_vec3_norm(column);
+
+        if (length > 0.0f) {
+            glm_vec3_scale(column, 1.0f / length, box->axes[i]);
+        } else {
+            glm_vec3_zero(box->axes[i]);
+            box->axes[i][i] = 1.0f;
+        }
+        box->halfExtents[i] = 0.5f * (bounds->max[i] - bounds->min[i]) * length;
+    }
+}
+
+void obb_vertices(const OBB* box, vec3 vertices[8]) {
+    for (int v = 0; v < 8; v++) {
+        glm_vec3_copy((float*)box->center, vertices[v]);
+        for (int i = 0; i < 3; i++) {
+            float extent = (v & (1 << i)) ? box->halfExtents[i] : -box->halfExtents[i];
+            glm_vec3_muladds((float*)box->axes[i], extent, vertices[v]);
+        }
+    }
+}
+
+void aabb_from_obb(const OBB* box, AABB* aabb) {
+    for (int i = 0; i < 3; i++) {
+        float extent = fabsf(box->axes[0][i]) * box->halfExtents[0] +
+                       fabsf(box->axes[1][i]) * box->halfExtents[1] +
+                       fabsf(box->axes[2][i]) * box->halfExtents[2];
+        aabb->min[i] = box->center[i] - extent;
+        aabb->max[i] = box->center[i] + extent;
+    }
+}
+
+static float project_radius(const OBB* box, const vec3 axis) {
+    return fabsf(glm_vec3_dot((float*)axis, (float*)box->axes[0])) * box->halfExtents[0] +
+           fabsf(glm_vec3_dot((float*)axis, (float*)box->axes[1])) * box->halfExtents[1] +
+           fabsf(glm_vec3_dot((float*)axis, (float*)box->axes[2])) * box->halfExtents[2];
+}
+
+// Keeps the MANIFOLD_MAX_POINTS deepest candidates, earlier ones winning ties
+static void add_point(Manifold* manifold, const vec3 position, float depth, uint32_t id) {
+    int slot = manifold->pointCount;
+    if (slot == MANIFOLD_MAX_POINTS) {
+        if (depth <= manifold->points[slot - 1].depth) return;
+        slot--;
+    } else {
+        manifold->pointCount++;
+    }
+
+    while (slot > 0 && manifold->points[slot - 1].depth < depth) {
+        manifold->points[slot] = manifold->points[slot - 1];
+        slot--;
+    }
+
+    ContactPoint* point = &manifold->points[slot];
+    glm_vec3_copy((float*)position, point->position);
+    point->depth = depth;
+    point->id = id;
+}
+
+// Vertices of incident against the reference face with outward normal facing it
+static void clip_face(const OBB* reference, int face, const vec3 normal, const OBB* incident, uint32_t axis, Manifold* manifold) {
+    float plane = glm_vec3_dot((float*)normal, (float*)reference->center) + reference->halfExtents[face];
+
+    vec3 vertices[8];
+    obb_vertices(incident, vertices);
+
+    for (int v = 0; v < 8; v++) {
+        float depth = plane - glm_vec3_dot((float*)normal, vertices[v]);
+        add_point(manifold, vertices[v], depth, (axis << 3) | (uint32_t)v);
+    }
+
+    // The axis test only guarantees the deepest vertex is within the margin
+    while (manifold->pointCount > 1 && manifold->points[manifold->pointCount - 1].depth < -COLLISION_MARGIN) {
+        manifold->pointCount--;
+    }
+}
+
+// Midpoint of the closest points between the two boxes' edges along the crossed axes
+static void edge_contact(const OBB* a, int edgeA, const OBB* b, int edgeB, const vec3 normal, vec3 out) {
+    vec3 pointA, pointB;
+    glm_vec3_copy((float*)a->center, pointA);
+    glm_vec3_copy((float*)b->center, pointB);
+
+    for (int i = 0; i < 3; i++) {
+        if (i != edgeA) {
+            float sign = glm_vec3_dot((float*)a->axes[i], (float*)normal) > 0.0f ? 1.0f : -1.0f;
+            glm_vec3_muladds((float*)a->axes[i], sign * a->halfExtents[i], pointA);
+        }
+        if (i != edgeB) {
+            float sign = glm_vec3_dot((float*)b->axes[i], (float*)normal) > 0.0f ? -1.0f : 1.0f;
+            glm_vec3_muladds((float*)b->axes[i], sign * b->halfExtents[i], pointB);
+        }
+    }
+
+    const float* dirA = a->axes[edgeA];
+    const float* dirB = b->axes[edgeB];
+    vec3 offset;
+    glm_vec3_sub(pointA, pointB, offset);
+
+    float d = glm_vec3_dot((float*)dirA, (float*)dirB);
+    float e = glm_vec3_dot((float*)dirA, offset);
+    float f = glm_vec3_dot((float*)dirB, offset);
+    float denominator = 1.0f - d * d;
+
+    float s = 0.0f, t = 0.0f;
+    if (denominator > 1e-6f) {
+        s = glm_clamp((d * f - e) / denominator, -a->halfExtents[edgeA], a->halfExtents[edgeA]);
+        t = glm_clamp((f - d * e) / denominator, -b->halfExtents[edgeB], b->halfExtents[edgeB]);
+    }
+
+    glm_vec3_muladds((float*)dirA, s, pointA);
+    glm_vec3_muladds((float*)dirB, t, pointB);
+    glm_vec3_lerp(pointA, pointB, 0.5f, out);
+}
+
+// Separating axis test over both boxes' face normals and the nine edge cross products.
+// Face axes are preferred when overlaps are close, which keeps resting contacts stable.
+bool collide_obb_obb(const OBB* a, const OBB* b, Manifold* manifold) {
+    vec3 offset;
+    glm_vec3_sub((float*)b->center, (float*)a->center, offset);
+
+    float bestOverlap = FLT_MAX;
+    int bestAxis = -1;
+    vec3 bestDirection;
+
+    for (int axis = 0; axis < 15; axis++) {
+        vec3 direction;
+        if (axis < 3) {
+            glm_vec3_copy((float*)a->axes[axis], direction);
+        } else if (axis < 6) {
+            glm_vec3_copy((float*)b->axes[axis - 3], direction);
+        } else {
+            glm_vec3_cross((float*)a->axes[(axis - 6) / 3], (float*)b->axes[(axis - 6) % 3], direction);
+            float length = glm_vec3_norm(direction);
+            if (length < 1e-4f) continue; // parallel edges, already covered by a face axis
+            glm_vec3_scale(direction, 1.0f / length, direction);
+        }
+
+        float distance = glm_vec3_dot(offset, direction);
+        float overlap = project_radius(a, direction) + project_radius(b, direction) - fabsf(distance);
+        if (overlap < -COLLISION_MARGIN) return false;
+
+        float tolerance = axis < 3 ? 0.0f : COLLISION_AXIS_TOLERANCE;
+        if (overlap + tolerance < bestOverlap) {
+            bestOverlap = overlap;
+            bestAxis = axis;
+            glm_vec3_copy(direction, bestDirection);
+            if (distance < 0.0f) glm_vec3_negate(bestDirection);
+        }
+    }
+
+    glm_vec3_copy(bestDirection, manifold->normal);
+    manifold->pointCount = 0;
+
+    if (bestAxis < 3) {
+        clip_face(a, bestAxis, bestDirection, b, (uint32_t)bestAxis, manifold);
+    } else if (bestAxis < 6) {
+        vec3 reversed;
+        glm_vec3_negate_to(bestDirection, reversed);
+        clip_face(b, bestAxis - 3, reversed, a, (uint32_t)bestAxis, manifold);
+    } else {
+        vec3 position;
+        edge_contact(a, (bestAxis - 6) / 3, b, (bestAxis - 6) % 3, bestDirection, position);
+        add_point(manifold, position, bestOverlap, (uint32_t)bestAxis << 3);
+    }
+
+    return true;
+}
+
+// The ground is an infinite static plane; normal points from the box down into it
+bool collide_obb_ground(const OBB* box, float margin, Manifold* manifold) {
+    vec3 vertices[8];
+    obb_vertices(box, vertices);
+
+    glm_vec3_copy((vec3){0.0f, -1.0f, 0.0f}, manifold->normal);
+    manifold->pointCount = 0;
+
+    for (int v = 0; v < 8; v++) {
+        float depth = COLLISION_GROUND_HEIGHT - vertices[v][1];
+        if (depth >= -margin) {
+            add_point(manifold, vertices[v], depth, (uint32_t)v);
+        }
+    }
+
+    return manifold->pointCount > 0;
+}
+
+// Whether point lies within the prism swept along the triangle's normal, give or take the margin
+static bool inside_triangle(const vec3 triangle[3], const vec3 normal, const vec3 point) {
+    for (int i = 0; i < 3; i++) {
+        vec3 edge, offset, side;
+        glm_vec3_sub((float*)triangle[(i + 1) % 3], (float*)triangle[i], edge);
+        glm_vec3_sub((float*)point, (float*)triangle[i], offset);
+        glm_vec3_cross(edge, (float*)normal, side);
+        if (glm_vec3_dot(side, offset) > COLLISION_MARGIN * glm_vec3_norm(edge)) return false;
+    }
+    return true;
+}
+
+// Separating axis test of a box against a two-sided triangle: the triangle's normal, the
+// box's face normals and the nine cross products of their edges. The triangle's normal is
+// preferred so boxes resting on a flat mesh don't catch on the edges between triangles.
+bool collide_obb_triangle(const OBB* box, const vec3 triangle[3], Manifold* manifold) {
+    vec3 edges[3];
+    for (int i = 0; i < 3; i++) {
+        glm_vec3_sub((float*)triangle[(i + 1) % 3], (float*)triangle[i], edges[i]);
+    }
+
+    vec3 faceNormal;
+    glm_vec3_cross(edges[0], edges[1], faceNormal);
+    float area = glm_vec3_norm(faceNormal);
+    if (area < 1e-8f) return false;
+    glm_vec3_scale(faceNormal, 1.0f / area, faceNormal);
+
+    float bestOverlap = FLT_MAX;
+    int bestAxis = -1;
+    vec3 bestDirection;
+
+    for (int axis = 0; axis < 13; axis++) {
+        vec3 direction;
+        if (axis == 0) {
+            glm_vec3_copy(faceNormal, direction);
+        } else if (axis < 4) {
+            glm_vec3_copy((float*)box->axes[axis - 1], direction);
+        } else {
+            glm_vec3_cross((float*)box->axes[(axis - 4) / 3], edges[(axis - 4) % 3], direction);
+            float length = glm_vec3_norm(direction);
+            if (length < 1e-4f) continue;
+            glm_vec3_scale(direction, 1.0f / length, direction);
+        }
+
+        float center = glm_vec3_dot((float*)box->center, direction);
+        float radius = project_radius(box, direction);
+        float low = FLT_MAX, high = -FLT_MAX;
+        for (int v = 0; v < 3; v++) {
+            float projection = glm_vec3_dot((float*)triangle[v], direction);
+            low = fminf(low, projection);
+            high = fmaxf(high, projection);
+        }
+
+        // Whichever side of the box the triangle overlaps least is the side it's on
+        float forward = center + radius - low;
+        float backward = high - (center - radius);
+        float overlap = fminf(forward, backward);
+        if (overlap < -COLLISION_MARGIN) return false;
+
+        float tolerance = axis == 0 ? 0.0f : COLLISION_AXIS_TOLERANCE;
+        if (overlap + tolerance < bestOverlap) {
+            bestOverlap = overlap;
+            bestAxis = axis;
+            glm_vec3_copy(direction, bestDirection);
+            if (backward < forward) glm_vec3_negate(bestDirection);
+        }
+    }
+
+    glm_vec3_copy(bestDirection, manifold->normal);
+    manifold->pointCount = 0;
+
+    if (bestAxis == 0) {
+        // Box vertices through the triangle's plane, as long as they're over the triangle
+        float plane = glm_vec3_dot(bestDirection, (float*)triangle[0]);
+        vec3 vertices[8];
+        obb_vertices(box, vertices);
+
+        for (int v = 0; v < 8; v++) {
+            float depth = glm_vec3_dot(bestDirection, vertices[v]) - plane;
+            if (depth >= -COLLISION_MARGIN && inside_triangle(triangle, faceNormal, vertices[v])) {
+                add_point(manifold, vertices[v], depth, (uint32_t)v);
+            }
+        }
+    } else if (bestAxis < 4) {
+        // Triangle vertices through the box face
+        int face = bestAxis - 1;
+        float plane = glm_vec3_dot(bestDirection, (float*)box->center) + box->halfExtents[face];
+
+        for (int v = 0; v < 3; v++) {
+            float depth = plane - glm_vec3_dot(bestDirection, (float*)triangle[v]);
+            if (depth >= -COLLISION_MARGIN) {
+                add_point(manifold, triangle[v], depth, ((uint32_t)bestAxis << 3) | (uint32_t)v);
+            }
+        }
+    }
+
+    // Edge contacts, and triangles smaller than the box face, get one point on the box's
+    // vertex furthest along the normal
+    if (manifold->pointCount == 0) {
+        vec3 position;
+        glm_vec3_copy((float*)box->center, position);
+        for (int i = 0; i < 3; i++) {
+            float sign = glm_vec3_dot((float*)box->axes[i], bestDirection) > 0.0f ? 1.0f : -1.0f;
+            glm_vec3_muladds((float*)box->axes[i], sign * box->halfExtents[i], position);
+        }
+        glm_vec3_muladds(bestDirection, -0.5f * bestOverlap, position);
+        add_point(manifold, position, bestOverlap, (uint32_t)bestAxis << 3);
+    }
+
+    return true;
+}
+
+// Slab test on the Minkowski difference: the boxes touch when every axis has entered
+// its overlap interval and none has left it yet
+bool sweep_aabb_aabb(const AABB* a, const vec3 motion, const AABB* b, float* time) {
+    float enter = -FLT_MAX;
+    float exit = FLT_MAX;
+
+    for (int i = 0; i < 3; i++) {
+        if (motion[i] == 0.0f) {
+            if (a->max[i] < b->min[i] || a->min[i] > b->max[i]) return false;
+            continue;
+        }
+
+        float inverse = 1.0f / motion[i];
+        float near = (motion[i] > 0.0f ? b->min[i] - a->max[i] : b->max[i] - a->min[i]) * inverse;
+        float far = (motion[i] > 0.0f ? b->max[i] - a->min[i] : b->min[i] - a->max[i]) * inverse;
+
+        enter = fmaxf(enter, near);
+        exit = fminf(exit, far);
+        if (enter > exit) return false;
+    }
+
+    if (enter < 0.0f || enter > 1.0f) return false;
+
+    *time = enter;
+    return true;
+}
+
+// Casts the box's centre along motion through the mesh, stopping when the box's extent along
+// the motion would reach the hit. Catches boxes tunnelling through walls and floors; features
+// narrower than the box that the centre passes beside are left to the narrowphase.
+bool sweep_obb_mesh(const OBB* box, const vec3 motion, const Mesh* mesh, mat4 model, float* time) {
+    float distance = glm_vec3_norm((float*)motion);
+    if (distance == 0.0f) return false;
+
+    vec3 direction;
+    glm_vec3_scale((float*)motion, 1.0f / distance, direction);
+    float radius = project_radius(box, direction);
+
+    // Affine, so distances along the mesh-space ray stay in world units
+    mat4 inverse;
+    vec3 origin;
+    glm_mat4_inv(model, inverse);
+    glm_mat4_mulv3(inverse, (float*)box->center, 1.0f, origin);
+    glm_mat4_mulv3(inverse, direction, 0.0f, direction);
+
+    float hit;
+    if (!mesh_raycast(mesh, origin, direction, distance + radius, &hit, NULL) || hit <= radius) return false;
+
+    *time = (hit - radius) / distance;
+    return true;
+}
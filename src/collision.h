@@ -0,0 +1,26 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "physics.h"
+
+#define COLLISION_GROUND_HEIGHT 0.0f
+#define COLLISION_MARGIN 0.02f          // contacts start this far apart, so resting bodies keep them
+#define COLLISION_AXIS_TOLERANCE 0.005f // an axis must beat the preferred one by this much to be used
+
+void obb_from_bounds(const AABB* bounds, mat4 model, OBB* box);
+void obb_vertices(const OBB* box, vec3 vertices[8]);
+void aabb_from_obb(const OBB* box, AABB* aabb);
+
+// Each fills in the manifold's normal (from a towards b) and contact points, returning
+// false when the shapes are further than the margin apart (COLLISION_MARGIN for pairs).
+// Separated points get a negative depth.
+bool collide_obb_obb(const OBB* a, const OBB* b, Manifold* manifold);
+bool collide_obb_ground(const OBB* box, float margin, Manifold* manifold);
+bool collide_obb_triangle(const OBB* box, const vec3 triangle[3], Manifold* manifold);
+
+// Time of impact in [0, 1] of a moving by motion against a stationary b. Boxes that
+// already overlap don't count as an impact; the solver deals with those.
+bool sweep_aabb_aabb(const AABB* a, const vec3 motion, const AABB* b, float* time);
+bool sweep_obb_mesh(const OBB* box, const vec3 motion, const Mesh* mesh, mat4 model, float* time);
+
+#endif
@@ -13,4 +13,10 @@ typedef struct {
     vec3 max;
 } AABB;
 
+typedef struct {
+    vec3 center;
+    vec3 axes[3];       // unit length, the columns of the model's rotation
+    vec3 halfExtents;
+} OBB;
+
 #endif // !COMMON_H
@@ -0,0 +1,72 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include "common.h"
+#include "mesh.h"
+#include <stdint.h>
+
+typedef enum {
+    COMPONENT_TRANSFORM,
+    COMPONENT_BODY,
+    COMPONENT_RENDERABLE,
+    COMPONENT_COLLIDER,
+    COMPONENT_COUNT
+} ComponentId;
+
+typedef uint32_t ComponentMask;
+
+#define COMPONENT_BIT(id) ((ComponentMask)1u << (id))
+
+typedef struct {
+    mat4 model;
+    vec3 position;
+    vec3 rotation;
+    vec3 scale;
+} Transform;
+
+typedef enum {
+    BODY_STATIC,            // never moves
+    BODY_KINEMATIC,         // moves at its set velocity, pushing dynamic bodies but never pushed
+    BODY_DYNAMIC            // moved by gravity and contacts
+} BodyType;
+
+typedef struct {
+    vec3     velocity;
+    uint32_t type;          // BodyType
+    float    invMass;       // 0 unless dynamic
+    float    restitution;
+    float    friction;
+    float    restTime;      // seconds spent below the sleep velocity threshold
+    uint32_t sleepIsland;   // non-zero while asleep, shared by bodies that fell asleep together
+} Body;
+
+#define RENDERABLE_LODS 4
+
+typedef struct {
+    unsigned int VAO;       // the shared geometry VAO, 0 without a GL context
+    uint32_t firstIndex;    // where the mesh starts in the shared buffers
+    int32_t baseVertex;
+    int vertexCount;
+    int indexCount;         // full detail
+    uint32_t lodIndexCounts[RENDERABLE_LODS];  // detail levels back to back from firstIndex, full detail first
+    uint8_t lodCount;       // 1 when the mesh has no simplified levels
+    uint8_t lod;            // level drawn last frame, so switching can lag behind size changes
+    vec3 color;
+    GLuint textureID;
+    float textureScale;
+    bool batched;           // drawn as part of a static batch, not on its own
+    uint32_t batch;         // the static batch and part drawing it, while batched
+    uint32_t batchPart;
+    bool occluder;          // drawn into the occlusion buffer to hide what is behind it
+} Renderable;
+
+typedef struct {
+    AABB bounds;        // mesh space, fixed at load
+    OBB  box;           // bounds placed in the world by the transform
+    AABB aabb;          // encloses box, for the broadphase
+    const Mesh* mesh;   // collides as triangles while the body is static, NULL for a plain box
+    uint32_t category;  // layer bits this collider is in
+    uint32_t mask;      // layers it collides with; a pair needs each side in the other's mask
+} Collider;
+
+#endif
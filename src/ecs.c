@@ -0,0 +1,325 @@
+#include "ecs.h"
+#include "memstats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ECS_CHUNK_BYTES (16 * 1024)
+#define ECS_COLUMN_ALIGN 32 // covers cglm's mat4 alignment, including AVX builds
+
+typedef struct {
+    int      archetype;
+    int      chunk;
+    uint32_t row;
+} EntityRecord;
+
+static const size_t componentSizes[COMPONENT_COUNT] = {
+    [COMPONENT_TRANSFORM]  = sizeof(Transform),
+    [COMPONENT_BODY]       = sizeof(Body),
+    [COMPONENT_RENDERABLE] = sizeof(Renderable),
+    [COMPONENT_COLLIDER]   = sizeof(Collider),
+};
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void ecs_init(World* world) {
+    world->archetypes = NULL;
+    world->archetypeCount = 0;
+    world->archetypeCapacity = 0;
+    pool_init(&world->entities, sizeof(EntityRecord));
+}
+
+void ecs_free(World* world) {
+    for (int i = 0; i < world->archetypeCount; i++) {
+        Archetype* archetype = &world->archetypes[i];
+        for (int c = 0; c < archetype->chunkCount; c++) {
+            mem_free(archetype->chunks[c].memory);
+        }
+        mem_free(archetype->chunks);
+    }
+    mem_free(world->archetypes);
+    pool_free(&world->entities);
+    ecs_init(world);
+}
+
+static int ecs_find_archetype(World* world, ComponentMask mask) {
+    for (int i = 0; i < world->archetypeCount; i++) {
+        if (world->archetypes[i].mask == mask) return i;
+    }
+
+    if (world->archetypeCount == world->archetypeCapacity) {
+        int capacity = world->archetypeCapacity ? world->archetypeCapacity * 2 : 8;
+        Archetype* archetypes = (Archetype*)mem_realloc(MEMORY_ECS, world->archetypes, capacity * sizeof(Archetype));
+        if (!archetypes) {
+            fprintf(stderr, "ERROR: Failed to allocate archetype\n");
+            return -1;
+        }
+        world->archetypes = archetypes;
+        world->archetypeCapacity = capacity;
+    }
+
+    size_t rowSize = sizeof(Entity);
+    for (int c = 0; c < COMPONENT_COUNT; c++) {
+        if (mask & COMPONENT_BIT(c)) rowSize += componentSizes[c];
+    }
+
+    // Leave room for the padding inserted in front of each column
+    size_t usable = ECS_CHUNK_BYTES - (COMPONENT_COUNT + 1) * ECS_COLUMN_ALIGN;
+    uint32_t capacity = (uint32_t)(usable / rowSize);
+
+    Archetype* archetype = &world->archetypes[world->archetypeCount];
+    archetype->mask = mask;
+    archetype->chunkCapacity = capacity > 0 ? capacity : 1;
+    archetype->entityCount = 0;
+    archetype->chunks = NULL;
+    archetype->chunkCount = 0;
+    archetype->chunkSlots = 0;
+
+    return world->archetypeCount++;
+}
+
+static Chunk* archetype_push_chunk(Archetype* archetype) {
+    if (archetype->chunkCount == archetype->chunkSlots) {
+        int slots = archetype->chunkSlots ? archetype->chunkSlots * 2 : 4;
+        Chunk* chunks = (Chunk*)mem_realloc(MEMORY_ECS, archetype->chunks, slots * sizeof(Chunk));
+        if (!chunks) return NULL;
+        archetype->chunks = chunks;
+        archetype->chunkSlots = slots;
+    }
+
+    size_t size = ECS_COLUMN_ALIGN + align_up(archetype->chunkCapacity * sizeof(Entity), ECS_COLUMN_ALIGN);
+    for (int c = 0; c < COMPONENT_COUNT; c++) {
+        if (archetype->mask & COMPONENT_BIT(c)) {
+            size += align_up(archetype->chunkCapacity * componentSizes[c], ECS_COLUMN_ALIGN);
+        }
+    }
+
+    void* memory = mem_alloc(MEMORY_ECS, size);
+    if (!memory) return NULL;
+
+    Chunk* chunk = &archetype->chunks[archetype->chunkCount++];
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->memory = memory;
+
+    unsigned char* cursor = (unsigned char*)align_up((size_t)memory, ECS_COLUMN_ALIGN);
+    chunk->entities = (Entity*)cursor;
+    cursor += align_up(archetype->chunkCapacity * sizeof(Entity), ECS_COLUMN_ALIGN);
+
+    for (int c = 0; c < COMPONENT_COUNT; c++) {
+        if (archetype->mask & COMPONENT_BIT(c)) {
+            chunk->columns[c] = cursor;
+            cursor += align_up(archetype->chunkCapacity * componentSizes[c], ECS_COLUMN_ALIGN);
+        }
+    }
+
+    return chunk;
+}
+
+// Appends a zeroed row for entity to the archetype, returning false on allocation failure
+static bool archetype_push_row(Archetype* archetype, Entity entity, int* chunkIndex, uint32_t* row) {
+    Chunk* chunk = archetype->chunkCount > 0 ? &archetype->chunks[archetype->chunkCount - 1] : NULL;
+    if (!chunk || chunk->count == archetype->chunkCapacity) {
+        chunk = archetype_push_chunk(archetype);
+        if (!chunk) return false;
+    }
+
+    *chunkIndex = archetype->chunkCount - 1;
+    *row = chunk->count++;
+    chunk->entities[*row] = entity;
+
+    for (int c = 0; c < COMPONENT_COUNT; c++) {
+        if (chunk->columns[c]) {
+            memset(chunk->columns[c] + *row * componentSizes[c], 0, componentSizes[c]);
+        }
+    }
+
+    archetype->entityCount++;
+    return true;
+}
+
+// Removes a row by moving the archetype's last row into it, keeping chunks packed
+static void archetype_remove_row(World* world, Archetype* archetype, int chunkIndex, uint32_t row) {
+    Chunk* chunk = &archetype->chunks[chunkIndex];
+    Chunk* last = &archetype->chunks[archetype->chunkCount - 1];
+    uint32_t lastRow = last->count - 1;
+
+    if (chunk != last || row != lastRow) {
+        for (int c = 0; c < COMPONENT_COUNT; c++) {
+            if (chunk->columns[c]) {
+                memcpy(chunk->columns[c] + row * componentSizes[c],
+                       last->columns[c] + lastRow * componentSizes[c],
+                       componentSizes[c]);
+            }
+        }
+
+        Entity moved = last->entities[lastRow];
+        chunk->entities[row] = moved;
+
+        EntityRecord* record = (EntityRecord*)pool_get(&world->entities, moved);
+        record->chunk = chunkIndex;
+        record->row = row;
+    }
+
+    last->count--;
+    archetype->entityCount--;
+
+    if (last->count == 0) {
+        mem_free(last->memory);
+        archetype->chunkCount--;
+    }
+}
+
+Entity ecs_create(World* world, ComponentMask mask) {
+    int archetypeIndex = ecs_find_archetype(world, mask);
+    if (archetypeIndex < 0) return HANDLE_NULL;
+
+    Entity entity = pool_add(&world->entities, NULL);
+    if (entity.generation == 0) return HANDLE_NULL;
+
+    int chunk;
+    uint32_t row;
+    if (!archetype_push_row(&world->archetypes[archetypeIndex], entity, &chunk, &row)) {
+        fprintf(stderr, "ERROR: Failed to allocate entity storage\n");
+        pool_remove(&world->entities, entity);
+        return HANDLE_NULL;
+    }
+
+    EntityRecord* record = (EntityRecord*)pool_get(&world->entities, entity);
+    record->archetype = archetypeIndex;
+    record->chunk = chunk;
+    record->row = row;
+
+    return entity;
+}
+
+bool ecs_destroy(World* world, Entity entity) {
+    EntityRecord* record = (EntityRecord*)pool_get(&world->entities, entity);
+    if (!record) return false;
+
+    archetype_remove_row(world, &world->archetypes[record->archetype], record->chunk, record->row);
+    return pool_remove(&world->entities, entity);
+}
+
+bool ecs_is_alive(World* world, Entity entity) {
+    return pool_is_valid(&world->entities, entity);
+}
+
+ComponentMask ecs_mask(World* world, Entity entity) {
+    EntityRecord* record = (EntityRecord*)pool_get(&world->entities, entity);
+    return record ? world->archetypes[record->archetype].mask : 0;
+}
+
+void* ecs_get(World* world, Entity entity, ComponentId component) {
+    EntityRecord* record = (EntityRecord*)pool_get(&world->entities, entity);
+    if (!record) return NULL;
+
+    Chunk* chunk = &world->archetypes[record->archetype].chunks[record->chunk];
+    if (!chunk->columns[component]) return NULL;
+
+    return chunk->columns[component] + record->row * componentSizes[component];
+}
+
+// Moves an entity to the archetype for newMask, carrying over the components both share
+static bool ecs_move(World* world, Entity entity, ComponentMask newMask) {
+    EntityRecord* record = (EntityRecord*)pool_get(&world->entities, entity);
+
+    int target = ecs_find_archetype(world, newMask);
+    if (target < 0) return false;
+
+    int chunkIndex;
+    uint32_t row;
+    if (!archetype_push_row(&world->archetypes[target], entity, &chunkIndex, &row)) {
+        fprintf(stderr, "ERROR: Failed to allocate entity storage\n");
+        return false;
+    }
+
+    Archetype* source = &world->archetypes[record->archetype];
+    Chunk* from = &source->chunks[record->chunk];
+    Chunk* to = &world->archetypes[target].chunks[chunkIndex];
+
+    for (int c = 0; c < COMPONENT_COUNT; c++) {
+        if (from->columns[c] && to->columns[c]) {
+            memcpy(to->columns[c] + row * componentSizes[c],
+                   from->columns[c] + record->row * componentSizes[c],
+                   componentSizes[c]);
+        }
+    }
+
+    archetype_remove_row(world, source, record->chunk, record->row);
+
+    record->archetype = target;
+    record->chunk = chunkIndex;
+    record->row = row;
+    return true;
+}
+
+void* ecs_add(World* world, Entity entity, ComponentId component) {
+    ComponentMask mask = ecs_mask(world, entity);
+    if (!ecs_is_alive(world, entity)) return NULL;
+
+    if (!(mask & COMPONENT_BIT(component)) && !ecs_move(world, entity, mask | COMPONENT_BIT(component))) {
+        return NULL;
+    }
+
+    return ecs_get(world, entity, component);
+}
+
+bool ecs_remove(World* world, Entity entity, ComponentId component) {
+    ComponentMask mask = ecs_mask(world, entity);
+    if (!(mask & COMPONENT_BIT(component))) return false;
+
+    return ecs_move(world, entity, mask & ~COMPONENT_BIT(component));
+}
+
+uint32_t ecs_count(World* world, ComponentMask mask) {
+    uint32_t count = 0;
+    for (int i = 0; i < world->archetypeCount; i++) {
+        if ((world->archetypes[i].mask & mask) == mask) {
+            count += world->archetypes[i].entityCount;
+        }
+    }
+    return count;
+}
+
+EcsQuery ecs_query(World* world, ComponentMask mask) {
+    EcsQuery query;
+    query.world = world;
+    query.mask = mask;
+    query.archetype = 0;
+    query.chunk = -1;
+    query.current = NULL;
+    query.count = 0;
+    return query;
+}
+
+bool ecs_query_next(EcsQuery* query) {
+    World* world = query->world;
+
+    while (query->archetype < world->archetypeCount) {
+        Archetype* archetype = &world->archetypes[query->archetype];
+
+        if ((archetype->mask & query->mask) == query->mask && query->chunk + 1 < archetype->chunkCount) {
+            query->chunk++;
+            query->current = &archetype->chunks[query->chunk];
+            query->count = query->current->count;
+            return true;
+        }
+
+        query->archetype++;
+        query->chunk = -1;
+    }
+
+    query->current = NULL;
+    query->count = 0;
+    return false;
+}
+
+void* ecs_query_column(EcsQuery* query, ComponentId component) {
+    return query->current ? query->current->columns[component] : NULL;
+}
+
+const Entity* ecs_query_entities(EcsQuery* query) {
+    return query->current ? query->current->entities : NULL;
+}
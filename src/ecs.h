@@ -0,0 +1,63 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include "components.h"
+#include "pool.h"
+
+typedef Handle Entity;
+
+// A chunk holds up to its archetype's chunkCapacity entities, with one contiguous
+// column per component in the archetype's mask.
+typedef struct {
+    uint32_t       count;
+    Entity*        entities;
+    unsigned char* columns[COMPONENT_COUNT];
+    void*          memory;
+} Chunk;
+
+// All entities with exactly the same component mask. Chunks are kept packed:
+// every chunk but the last is full.
+typedef struct {
+    ComponentMask mask;
+    uint32_t      chunkCapacity;
+    uint32_t      entityCount;
+    Chunk*        chunks;
+    int           chunkCount;
+    int           chunkSlots;
+} Archetype;
+
+typedef struct {
+    Archetype* archetypes;
+    int        archetypeCount;
+    int        archetypeCapacity;
+    Pool       entities;    // EntityRecord per live entity
+} World;
+
+// Iterates over the chunks of every archetype containing all components in mask.
+// Entities must not be created, destroyed or change components while iterating.
+typedef struct {
+    World*        world;
+    ComponentMask mask;
+    int           archetype;
+    int           chunk;
+    Chunk*        current;
+    uint32_t      count;
+} EcsQuery;
+
+void          ecs_init(World* world);
+void          ecs_free(World* world);
+Entity        ecs_create(World* world, ComponentMask mask);
+bool          ecs_destroy(World* world, Entity entity);
+bool          ecs_is_alive(World* world, Entity entity);
+ComponentMask ecs_mask(World* world, Entity entity);
+void*         ecs_get(World* world, Entity entity, ComponentId component);
+void*         ecs_add(World* world, Entity entity, ComponentId component);
+bool          ecs_remove(World* world, Entity entity, ComponentId component);
+uint32_t      ecs_count(World* world, ComponentMask mask);
+
+EcsQuery      ecs_query(World* world, ComponentMask mask);
+bool          ecs_query_next(EcsQuery* query);
+void*         ecs_query_column(EcsQuery* query, ComponentId component);
+const Entity* ecs_query_entities(EcsQuery* query);
+
+#endif
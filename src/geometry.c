@@ -0,0 +1,443 @@
+#include "geometry.h"
+#include "memstats.h"
+#include "renderer.h"
+#include "renderstats.h"
+
+#define GEOMETRY_INITIAL_VERTICES 65536
+#define GEOMETRY_INITIAL_INDICES  (3 * GEOMETRY_INITIAL_VERTICES)
+// Pages grow by doubling up to this, then a new page opens; 32 MB of vertices, 12 MB of indices
+#define GEOMETRY_PAGE_VERTICES    (1u << 20)
+#define GEOMETRY_PAGE_INDICES     (3 * GEOMETRY_PAGE_VERTICES)
+
+#define GEOMETRY_STRIDE (GEOMETRY_VERTEX_FLOATS * sizeof(float))
+
+// Unused spans of a buffer, in elements, sorted by offset with neighbours merged
+typedef struct {
+    uint32_t offset;
+    uint32_t count;
+} FreeBlock;
+
+typedef struct {
+    FreeBlock* blocks;
+    uint32_t   count;
+    uint32_t   capacity;
+} FreeList;
+
+// A live range and how many owners share it, found by its first vertex
+typedef struct {
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    uint32_t references;
+} Allocation;
+
+typedef struct {
+    Allocation* items;      // sorted by vertexOffset
+    uint32_t    count;
+    uint32_t    capacity;
+} AllocationList;
+
+typedef struct {
+    GLuint   VAO, VBO, EBO;
+    uint32_t vertexCapacity;
+    uint32_t indexCapacity;
+    FreeList freeVertices;
+    FreeList freeIndices;
+    AllocationList allocations;
+} GeometryPage;
+
+static struct {
+    GeometryPage pages[GEOMETRY_MAX_PAGES];
+    int          pageCount;
+} geometry;
+
+// First fit; meshes are loaded far more often than they're freed, so lists stay short
+static bool free_list_take(FreeList* list, uint32_t count, uint32_t* offset) {
+    for (uint32_t i = 0; i < list->count; i++) {
+        FreeBlock* block = &list->blocks[i];
+        if (block->count < count) continue;
+
+        *offset = block->offset;
+        block->offset += count;
+        block->count -= count;
+        if (block->count == 0) {
+            memmove(block, block + 1, (list->count - i - 1) * sizeof(FreeBlock));
+            list->count--;
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool free_list_give(FreeList* list, uint32_t offset, uint32_t count) {
+    if (count == 0) return true;
+
+    uint32_t i = 0;
+    while (i < list->count && list->blocks[i].offset < offset) i++;
+
+    // Space that is already free is being freed again; merging it would hand it out twice
+    if ((i > 0 && list->blocks[i - 1].offset + list->blocks[i - 1].count > offset) ||
+        (i < list->count && offset + count > list->blocks[i].offset)) {
+        fprintf(stderr, "ERROR: Freed geometry at %u overlaps free space, ignoring it\n", offset);
+        return false;
+    }
+
+    bool joinsPrevious = i > 0 && list->blocks[i - 1].offset + list->blocks[i - 1].count == offset;
+    bool joinsNext = i < list->count && offset + count == list->blocks[i].offset;
+    if (joinsPrevious && joinsNext) {
+        list->blocks[i - 1].count += count + list->blocks[i].count;
+        memmove(&list->blocks[i], &list->blocks[i + 1], (list->count - i - 1) * sizeof(FreeBlock));
+        list->count--;
+        return true;
+    }
+    if (joinsPrevious) {
+        list->blocks[i - 1].count += count;
+        return true;
+    }
+    if (joinsNext) {
+        list->blocks[i].offset = offset;
+        list->blocks[i].count += count;
+        return true;
+    }
+
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 16;
+        FreeBlock* blocks = (FreeBlock*)mem_realloc(MEMORY_MESH, list->blocks, capacity * sizeof(FreeBlock));
+        if (!blocks) return false;
+        list->blocks = blocks;
+        list->capacity = capacity;
+    }
+    memmove(&list->blocks[i + 1], &list->blocks[i], (list->count - i) * sizeof(FreeBlock));
+    list->blocks[i].offset = offset;
+    list->blocks[i].count = count;
+    list->count++;
+    return true;
+}
+
+// Index of the first allocation at or after vertexOffset
+static uint32_t allocation_find(const AllocationList* list, uint32_t vertexOffset) {
+    uint32_t low = 0;
+    uint32_t high = list->count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (list->items[middle].vertexOffset < vertexOffset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static bool allocation_insert(AllocationList* list, const Allocation* allocation) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+        Allocation* items = (Allocation*)mem_realloc(MEMORY_MESH, list->items, capacity * sizeof(Allocation));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    uint32_t i = allocation_find(list, allocation->vertexOffset);
+    memmove(&list->items[i + 1], &list->items[i], (list->count - i) * sizeof(Allocation));
+    list->items[i] = *allocation;
+    list->count++;
+    return true;
+}
+
+// The page's record of a range, or NULL if the range isn't live there
+static Allocation* allocation_lookup(GeometryPage* page, const GeometryRange* range) {
+    AllocationList* list = &page->allocations;
+    uint32_t i = allocation_find(list, (uint32_t)range->baseVertex);
+    if (i == list->count) return NULL;
+
+    Allocation* allocation = &list->items[i];
+    if (allocation->vertexOffset != (uint32_t)range->baseVertex || allocation->indexOffset != range->firstIndex) return NULL;
+    return allocation;
+}
+
+static GeometryPage* page_of(const GeometryRange* range) {
+    for (int i = 0; i < geometry.pageCount; i++) {
+        if (geometry.pages[i].VAO == range->VAO) return &geometry.pages[i];
+    }
+    return NULL;
+}
+
+static void bind_vertex_format(GeometryPage* page) {
+    glBindBuffer(GL_ARRAY_BUFFER, page->VBO);
+
+    // position attribute (3 floats)
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, GEOMETRY_STRIDE, (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // normal attribute (3 floats)
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, GEOMETRY_STRIDE, (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // texture coordinate attribute (2 floats)
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, GEOMETRY_STRIDE, (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+}
+
+static void page_free(GeometryPage* page) {
+    if (page->VAO) glDeleteVertexArrays(1, &page->VAO);
+    if (page->VBO) glDeleteBuffers(1, &page->VBO);
+    if (page->EBO) glDeleteBuffers(1, &page->EBO);
+    mem_free(page->freeVertices.blocks);
+    mem_free(page->freeIndices.blocks);
+    mem_free(page->allocations.items);
+    memset(page, 0, sizeof(*page));
+}
+
+// A mesh bigger than a whole page gets a page of its own size
+static GeometryPage* page_open(uint32_t vertexCount, uint32_t indexCount) {
+    if (geometry.pageCount == GEOMETRY_MAX_PAGES) return NULL;
+
+    GeometryPage* page = &geometry.pages[geometry.pageCount];
+    glGenVertexArrays(1, &page->VAO);
+    glGenBuffers(1, &page->VBO);
+    glGenBuffers(1, &page->EBO);
+    if (page->VAO == 0 || page->VBO == 0 || page->EBO == 0) {
+        fprintf(stderr, "ERROR: Failed to create shared geometry buffers\n");
+        page_free(page);
+        return NULL;
+    }
+
+    page->vertexCapacity = vertexCount > GEOMETRY_INITIAL_VERTICES ? vertexCount : GEOMETRY_INITIAL_VERTICES;
+    page->indexCapacity = indexCount > GEOMETRY_INITIAL_INDICES ? indexCount : GEOMETRY_INITIAL_INDICES;
+    if (!free_list_give(&page->freeVertices, 0, page->vertexCapacity) ||
+        !free_list_give(&page->freeIndices, 0, page->indexCapacity)) {
+        page_free(page);
+        return NULL;
+    }
+
+    glBindVertexArray(page->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, page->VBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)page->vertexCapacity * GEOMETRY_STRIDE, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)page->indexCapacity * sizeof(uint32_t), NULL, GL_STATIC_DRAW);
+    bind_vertex_format(page);
+
+    geometry.pageCount++;
+    return page;
+}
+
+// Moves a buffer's contents into a bigger one, on the GPU
+static GLuint grow_buffer(GLuint buffer, size_t used, size_t capacity) {
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    if (grown == 0) return 0;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)capacity, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)used);
+    glDeleteBuffers(1, &buffer);
+    return grown;
+}
+
+// Doubles the vertex or index buffer until its free tail fits count, within the page limit
+static bool page_grow(GeometryPage* page, bool vertices, uint32_t count) {
+    FreeList* list = vertices ? &page->freeVertices : &page->freeIndices;
+    uint32_t current = vertices ? page->vertexCapacity : page->indexCapacity;
+    uint32_t limit = vertices ? GEOMETRY_PAGE_VERTICES : GEOMETRY_PAGE_INDICES;
+    if (current >= limit) return false;
+
+    // Whatever is free at the end joins the grown space
+    uint32_t tail = 0;
+    if (list->count > 0) {
+        const FreeBlock* last = &list->blocks[list->count - 1];
+        if (last->offset + last->count == current) tail = last->count;
+    }
+    if (tail >= count) return true;
+    uint32_t needed = count - tail;
+
+    uint32_t capacity = current;
+    while (capacity - current < needed && capacity < limit) capacity *= 2;
+    if (capacity > limit) capacity = limit;
+    if (capacity - current < needed) return false;
+
+    size_t elementSize = vertices ? GEOMETRY_STRIDE : sizeof(uint32_t);
+    GLuint grown = grow_buffer(vertices ? page->VBO : page->EBO, (size_t)current * elementSize, (size_t)capacity * elementSize);
+    if (!grown) return false;
+
+    glBindVertexArray(page->VAO);
+    if (vertices) {
+        page->VBO = grown;
+        page->vertexCapacity = capacity;
+        bind_vertex_format(page);
+    } else {
+        page->EBO = grown;
+        page->indexCapacity = capacity;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page->EBO);
+    }
+    return free_list_give(list, current, capacity - current);
+}
+
+static bool page_take(GeometryPage* page, bool vertices, uint32_t count, bool grow, uint32_t* offset) {
+    FreeList* list = vertices ? &page->freeVertices : &page->freeIndices;
+    if (free_list_take(list, count, offset)) return true;
+    return grow && page_grow(page, vertices, count) && free_list_take(list, count, offset);
+}
+
+static bool page_alloc(GeometryPage* page, uint32_t vertexCount, uint32_t indexCount, bool grow, GeometryRange* range) {
+    uint32_t vertexOffset, indexOffset;
+    if (!page_take(page, true, vertexCount, grow, &vertexOffset)) return false;
+    if (!page_take(page, false, indexCount, grow, &indexOffset)) {
+        free_list_give(&page->freeVertices, vertexOffset, vertexCount);
+        return false;
+    }
+
+    Allocation allocation = {vertexOffset, vertexCount, indexOffset, indexCount, 1};
+    if (!allocation_insert(&page->allocations, &allocation)) {
+        free_list_give(&page->freeVertices, vertexOffset, vertexCount);
+        free_list_give(&page->freeIndices, indexOffset, indexCount);
+        return false;
+    }
+
+    range->VAO = page->VAO;
+    range->firstIndex = indexOffset;
+    range->baseVertex = (int32_t)vertexOffset;
+    range->indexCount = indexCount;
+    range->vertexCount = vertexCount;
+    return true;
+}
+
+static GeometryPage* allocate(uint32_t vertexCount, uint32_t indexCount, GeometryRange* range) {
+    // Reuse free space anywhere before growing a page, and grow before opening another
+    for (int grow = 0; grow < 2; grow++) {
+        for (int i = 0; i < geometry.pageCount; i++) {
+            if (page_alloc(&geometry.pages[i], vertexCount, indexCount, grow, range)) return &geometry.pages[i];
+        }
+    }
+
+    GeometryPage* page = page_open(vertexCount, indexCount);
+    if (page && page_alloc(page, vertexCount, indexCount, false, range)) return page;
+    return NULL;
+}
+
+// Arguments and result of GL work handed to renderer_call
+typedef struct {
+    const float*    vertices;
+    uint32_t        vertexCount;
+    const uint32_t* indices;
+    uint32_t        indexCount;
+    GeometryRange*  range;
+    bool            added;
+} AddTask;
+
+typedef struct {
+    const GeometryRange* range;
+    float*          vertices;
+    uint32_t*       indices;
+    bool            read;
+} ReadTask;
+
+static bool add_range(const float* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, GeometryRange* range) {
+    uint32_t* sequential = NULL;
+    if (!indices || indexCount == 0) {
+        sequential = (uint32_t*)mem_alloc(MEMORY_MESH, vertexCount * sizeof(uint32_t));
+        if (!sequential) return false;
+        for (uint32_t i = 0; i < vertexCount; i++) sequential[i] = i;
+        indices = sequential;
+        indexCount = vertexCount;
+    }
+
+    GeometryPage* page = allocate(vertexCount, indexCount, range);
+    if (!page) {
+        fprintf(stderr, "ERROR: No room for %u vertices in %d geometry pages\n", vertexCount, geometry.pageCount);
+        mem_free(sequential);
+        return false;
+    }
+
+    glBindVertexArray(page->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, page->VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)range->baseVertex * GEOMETRY_STRIDE, (GLsizeiptr)vertexCount * GEOMETRY_STRIDE, vertices);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)range->firstIndex * sizeof(uint32_t), (GLsizeiptr)indexCount * sizeof(uint32_t), indices);
+    mem_free(sequential);
+    return true;
+}
+
+static void add_task(void* user) {
+    AddTask* task = (AddTask*)user;
+    task->added = add_range(task->vertices, task->vertexCount, task->indices, task->indexCount, task->range);
+}
+
+bool geometry_add(const float* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, GeometryRange* range) {
+    AddTask task = {vertices, vertexCount, indices, indexCount, range, false};
+    renderer_call(add_task, &task);
+    return task.added;
+}
+
+void geometry_retain(const GeometryRange* range) {
+    GeometryPage* page = page_of(range);
+    Allocation* allocation = page ? allocation_lookup(page, range) : NULL;
+    if (!allocation) {
+        fprintf(stderr, "ERROR: Retained geometry at vertex %d that isn't allocated\n", range->baseVertex);
+        return;
+    }
+    allocation->references++;
+}
+
+void geometry_release(const GeometryRange* range) {
+    GeometryPage* page = page_of(range);
+    Allocation* allocation = page ? allocation_lookup(page, range) : NULL;
+    if (!allocation) {
+        fprintf(stderr, "ERROR: Released geometry at vertex %d that isn't allocated\n", range->baseVertex);
+        return;
+    }
+    if (--allocation->references > 0) return;
+
+    if (!free_list_give(&page->freeVertices, allocation->vertexOffset, allocation->vertexCount) ||
+        !free_list_give(&page->freeIndices, allocation->indexOffset, allocation->indexCount)) {
+        fprintf(stderr, "ERROR: Failed to free geometry at vertex %u, leaking it\n", allocation->vertexOffset);
+    }
+
+    AllocationList* list = &page->allocations;
+    uint32_t i = (uint32_t)(allocation - list->items);
+    memmove(&list->items[i], &list->items[i + 1], (list->count - i - 1) * sizeof(Allocation));
+    list->count--;
+}
+
+static void read_task(void* user) {
+    ReadTask* task = (ReadTask*)user;
+    const GeometryRange* range = task->range;
+    for (int i = 0; i < geometry.pageCount; i++) {
+        GeometryPage* page = &geometry.pages[i];
+        if (page->VAO != range->VAO) continue;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, page->VBO);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, (GLintptr)range->baseVertex * GEOMETRY_STRIDE, (GLsizeiptr)range->vertexCount * GEOMETRY_STRIDE, task->vertices);
+        glBindBuffer(GL_COPY_READ_BUFFER, page->EBO);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, (GLintptr)range->firstIndex * sizeof(uint32_t), (GLsizeiptr)range->indexCount * sizeof(uint32_t), task->indices);
+        task->read = true;
+        return;
+    }
+}
+
+bool geometry_read(const GeometryRange* range, float* vertices, uint32_t* indices) {
+    ReadTask task = {range, vertices, indices, false};
+    renderer_call(read_task, &task);
+    return task.read;
+}
+
+int geometry_page_count(void) {
+    return geometry.pageCount;
+}
+
+GLuint geometry_page_vao(int page) {
+    return page < geometry.pageCount ? geometry.pages[page].VAO : 0;
+}
+
+static void free_task(void* user) {
+    (void)user;
+    for (int i = 0; i < geometry.pageCount; i++) {
+        page_free(&geometry.pages[i]);
+    }
+    geometry.pageCount = 0;
+}
+
+void geometry_free(void) {
+    renderer_call(free_task, NULL);
+}
@@ -0,0 +1,38 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "common.h"
+#include <stdint.h>
+
+#define GEOMETRY_VERTEX_FLOATS 8    // position, normal, texture coordinates
+#define GEOMETRY_MAX_PAGES 8
+
+// Where a mesh landed in the shared buffers; draw it with glDrawElementsBaseVertex
+typedef struct {
+    GLuint   VAO;           // the page holding the mesh
+    uint32_t firstIndex;
+    int32_t  baseVertex;
+    uint32_t indexCount;
+    uint32_t vertexCount;
+} GeometryRange;
+
+// Mesh vertices and indices are suballocated out of a few large vertex/index buffer pages,
+// each behind one VAO of the shared vertex format, so drawing rarely switches buffers and a
+// page's meshes can go out in one indirect draw. Freed ranges are reused first-fit.
+// Meshes without indices get a sequential list. The GL work goes through renderer_call, so
+// meshes can be added from the main thread at any time; retaining and releasing are CPU only.
+bool   geometry_add(const float* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, GeometryRange* range);
+// Ranges are reference counted: geometry_add hands back one reference, every further owner
+// of a copy of the range takes its own, and each owner releases once. The space returns to
+// its page when the last reference goes.
+void   geometry_retain(const GeometryRange* range);
+void   geometry_release(const GeometryRange* range);
+// Copies a range back from the GPU, with indices relative to its first vertex. Stalls, so
+// it's for load time only.
+bool   geometry_read(const GeometryRange* range, float* vertices, uint32_t* indices);
+
+int    geometry_page_count(void);
+GLuint geometry_page_vao(int page);
+void   geometry_free(void);
+
+#endif
@@ -0,0 +1,79 @@
+#include "gputimer.h"
+#include "platform.h"
+#include "profiler.h"
+
+void gpu_timer_init(GpuTimer* timer) {
+    memset(timer, 0, sizeof(*timer));
+
+    GLint bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+    timer->supported = bits > 0;
+    if (!timer->supported) {
+        fprintf(stderr, "ERROR: GL timestamps unsupported, GPU pass times will read 0\n");
+        return;
+    }
+
+    glGenQueries(GPU_TIMER_LATENCY * GPU_TIMER_MAX_PASSES * 2, &timer->queries[0][0][0]);
+}
+
+void gpu_timer_free(GpuTimer* timer) {
+    if (timer->supported) {
+        glDeleteQueries(GPU_TIMER_LATENCY * GPU_TIMER_MAX_PASSES * 2, &timer->queries[0][0][0]);
+    }
+    memset(timer, 0, sizeof(*timer));
+}
+
+int gpu_timer_add_pass(GpuTimer* timer, const char* name) {
+    if (timer->passCount == GPU_TIMER_MAX_PASSES) {
+        fprintf(stderr, "ERROR: Too many GPU timer passes, '%s' won't be timed\n", name);
+        return -1;
+    }
+
+    GpuPass* pass = &timer->passes[timer->passCount];
+    memset(pass, 0, sizeof(*pass));
+    pass->name = name;
+    return timer->passCount++;
+}
+
+void gpu_timer_begin(GpuTimer* timer, int pass) {
+    if (pass < 0) return;
+
+    PROFILE_BEGIN(timer->passes[pass].name);
+    timer->passes[pass].cpuStart = platform_time();
+    if (timer->supported) {
+        glQueryCounter(timer->queries[timer->frame][pass][0], GL_TIMESTAMP);
+    }
+}
+
+void gpu_timer_end(GpuTimer* timer, int pass) {
+    if (pass < 0) return;
+
+    if (timer->supported) {
+        glQueryCounter(timer->queries[timer->frame][pass][1], GL_TIMESTAMP);
+        timer->issued[timer->frame] |= 1u << pass;
+    }
+    timer->passes[pass].cpuMilliseconds = (float)(1000.0 * (platform_time() - timer->passes[pass].cpuStart));
+    PROFILE_END();
+}
+
+void gpu_timer_end_frame(GpuTimer* timer) {
+    // The oldest frame's queries are reused next, so read whatever of them has landed.
+    // Anything still in flight is dropped and the pass keeps its previous time.
+    timer->frame = (timer->frame + 1) % GPU_TIMER_LATENCY;
+
+    uint32_t issued = timer->issued[timer->frame];
+    for (int pass = 0; pass < timer->passCount; pass++) {
+        if (!(issued & (1u << pass))) continue;
+
+        GLuint* queries = timer->queries[timer->frame][pass];
+        GLint available = 0;
+        glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+        timer->passes[pass].gpuMilliseconds = (float)((end - begin) / 1e6);
+    }
+    timer->issued[timer->frame] = 0;
+}
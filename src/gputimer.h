@@ -0,0 +1,36 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include "common.h"
+
+#define GPU_TIMER_LATENCY 4         // frames between issuing a pass's queries and reading them back
+#define GPU_TIMER_MAX_PASSES 8
+
+typedef struct {
+    const char* name;
+    double      cpuStart;
+    float       cpuMilliseconds;    // submission time on the CPU, this frame
+    float       gpuMilliseconds;    // execution time on the GPU, GPU_TIMER_LATENCY frames old
+} GpuPass;
+
+// Times render passes on both sides with GL_TIMESTAMP queries, so passes may nest. Results
+// are read a few frames late and only once available, so reading them never stalls.
+typedef struct {
+    GLuint   queries[GPU_TIMER_LATENCY][GPU_TIMER_MAX_PASSES][2];  // at the pass's begin and end
+    uint32_t issued[GPU_TIMER_LATENCY];     // passes recorded into each frame's queries
+    GpuPass  passes[GPU_TIMER_MAX_PASSES];
+    int      passCount;
+    int      frame;                         // which set of queries this frame records into
+    bool     supported;                     // false if the driver keeps no timestamp bits
+} GpuTimer;
+
+// Needs a current GL context
+void gpu_timer_init(GpuTimer* timer);
+void gpu_timer_free(GpuTimer* timer);
+int  gpu_timer_add_pass(GpuTimer* timer, const char* name);
+void gpu_timer_begin(GpuTimer* timer, int pass);
+void gpu_timer_end(GpuTimer* timer, int pass);
+// Once per frame, after the last pass: collects the oldest frame's results
+void gpu_timer_end_frame(GpuTimer* timer);
+
+#endif
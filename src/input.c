@@ -1,79 +1,74 @@
 #include "input.h"
 
-extern float lastX;
-extern float lastY;
-extern bool firstMouse;
+static float pendingScroll = 0.0f;
 static bool middleMousePressed = false;
-static double lastMiddleX, lastMiddleY;
+static float lastMiddleX, lastMiddleY;
 
-void process_input(GLFWwindow* window, State* state, float deltaTime) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, 1);
+void input_poll(GLFWwindow* window, float deltaTime, InputFrame* frame) {
+    memset(frame, 0, sizeof(*frame));
+    frame->deltaTime = deltaTime;
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) frame->keys |= INPUT_KEY_QUIT;
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) frame->keys |= INPUT_KEY_FORWARD;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) frame->keys |= INPUT_KEY_BACKWARD;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) frame->keys |= INPUT_KEY_LEFT;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) frame->keys |= INPUT_KEY_RIGHT;
+
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) frame->buttons |= INPUT_BUTTON_LEFT;
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_MIDDLE) == GLFW_PRESS) frame->buttons |= INPUT_BUTTON_MIDDLE;
+
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    frame->cursorX = (float)xpos;
+    frame->cursorY = (float)ypos;
+
+    frame->scroll = pendingScroll;
+    pendingScroll = 0.0f;
+}
+
+bool input_apply(State* state, const InputFrame* frame) {
+    float deltaTime = frame->deltaTime;
+
+    if (frame->keys & INPUT_KEY_FORWARD)
         camera_process_keyboard(&state->camera, 0, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (frame->keys & INPUT_KEY_BACKWARD)
         camera_process_keyboard(&state->camera, 1, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (frame->keys & INPUT_KEY_LEFT)
         camera_process_keyboard(&state->camera, 2, deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (frame->keys & INPUT_KEY_RIGHT)
         camera_process_keyboard(&state->camera, 3, deltaTime);
 
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
-        double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
-        ui_handle_mouse(&state->ui, xpos, ypos, true);
-    }
-
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_MIDDLE) == GLFW_PRESS) {
-        if (!middleMousePressed) {
-            middleMousePressed = true;
-            glfwGetCursorPos(window, &lastMiddleX, &lastMiddleY);
-            lastX = lastMiddleX;
-            lastY = lastMiddleY;
+    // Dragging with the middle button looks around
+    if (frame->buttons & INPUT_BUTTON_MIDDLE) {
+        if (middleMousePressed) {
+            float xoffset = frame->cursorX - lastMiddleX;
+            float yoffset = lastMiddleY - frame->cursorY;
+            camera_process_mouse_movement(&state->camera, xoffset, yoffset, GL_TRUE);
         }
-    } else if (middleMousePressed) {
+        middleMousePressed = true;
+        lastMiddleX = frame->cursorX;
+        lastMiddleY = frame->cursorY;
+    } else {
         middleMousePressed = false;
-        glfwGetCursorPos(window, &lastX, &lastY);
     }
-}
-
-void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
-    extern State state;
 
-    if (firstMouse) {
-        lastX = xpos;
-        lastY = ypos;
-        lastMiddleX = xpos;
-        lastMiddleY = ypos;
-        firstMouse = false;
+    if (frame->scroll != 0.0f) {
+        camera_process_mouse_scroll(&state->camera, frame->scroll);
     }
 
-    if (middleMousePressed) {
-        float xoffset = xpos - lastMiddleX;
-        float yoffset = lastMiddleY - ypos;
-
-        lastMiddleX = xpos;
-        lastMiddleY = ypos;
-
-        camera_process_mouse_movement(&state.camera, xoffset, yoffset, GL_TRUE);
-    } else {
-        lastX = xpos;
-        lastY = ypos;
-    }
+    ui_handle_mouse(&state->ui, frame->cursorX, frame->cursorY, (frame->buttons & INPUT_BUTTON_LEFT) != 0);
 
-    ui_handle_mouse(&state.ui, xpos, ypos, false);
+    return !(frame->keys & INPUT_KEY_QUIT);
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
-    extern State state;
-    camera_process_mouse_scroll(&state.camera, yoffset);
+    pendingScroll += (float)yoffset;
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    
+    // View toggles only, so they stay out of recorded input
+    State* state = (State*)glfwGetWindowUserPointer(window);
+    if (state && key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        state->overlay.visible = !state->overlay.visible;
+    }
 }
-
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
-}
\ No newline at end of file
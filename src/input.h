@@ -2,12 +2,15 @@
 #define INPUT_H
 
 #include "common.h"
+#include "replay.h"
 #include "state.h"
 
-void process_input(GLFWwindow* window, State* state, float deltaTime);
-void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+// Samples the keyboard, mouse and scroll accumulated since the last poll
+void input_poll(GLFWwindow* window, float deltaTime, InputFrame* frame);
+// Drives the camera and UI from a frame, live or replayed. Returns false when it asks to quit.
+bool input_apply(State* state, const InputFrame* frame);
+
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
-#endif
\ No newline at end of file
+#endif
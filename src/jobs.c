@@ -0,0 +1,392 @@
+#include "jobs.h"
+#include "platform.h"
+#include "profiler.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define JOB_DEQUE_CAPACITY 4096 // must be a power of two
+#define JOB_DEQUE_MASK (JOB_DEQUE_CAPACITY - 1)
+#define JOB_SPIN_COUNT 64
+#define PARALLEL_FOR_MAX_BATCHES 256
+
+typedef struct {
+    JobFunc     func;
+    void*       data;
+    JobCounter* counter;
+} JobEntry;
+
+// Chase-Lev work-stealing deque. The owning thread pushes and pops at the bottom,
+// other threads steal from the top.
+typedef struct {
+    atomic_llong top;
+    char         pad0[64];
+    atomic_llong bottom;
+    char         pad1[64];
+    JobEntry     entries[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct {
+    JobCounter* dependency;
+    JobEntry    entry;
+} Continuation;
+
+static struct {
+    int           threadCount;
+    JobDeque*     deques;   // one per thread, index 0 belongs to the thread that called jobs_init
+    Thread*       threads[MAX_JOB_THREADS];
+    atomic_bool   running;
+    atomic_int    pending;  // jobs sitting in deques
+    atomic_int    sleeping;
+    Mutex*        sleepMutex;
+    CondVar*      sleepCond;
+
+    Mutex*        continuationMutex;
+    atomic_int    continuationCount;
+    Continuation* continuations;
+    int           continuationCapacity;
+} jobs;
+
+// -1 for threads that are not part of the pool; their jobs run inline
+static THREAD_LOCAL int threadIndex = -1;
+
+static bool deque_push(JobDeque* deque, JobEntry entry) {
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY) return false;
+
+    deque->entries[bottom & JOB_DEQUE_MASK] = entry;
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+static bool deque_pop(JobDeque* deque, JobEntry* entry) {
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return false;
+    }
+
+    *entry = deque->entries[bottom & JOB_DEQUE_MASK];
+    if (top == bottom) {
+        // Last entry: race any thieves for it
+        bool won = atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                           memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+static bool deque_steal(JobDeque* deque, JobEntry* entry) {
+    long long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) return false;
+
+    *entry = deque->entries[top & JOB_DEQUE_MASK];
+    return atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                   memory_order_seq_cst, memory_order_relaxed);
+}
+
+static void wake_workers(void) {
+    if (atomic_load(&jobs.sleeping) > 0) {
+        mutex_lock(jobs.sleepMutex);
+        condvar_broadcast(jobs.sleepCond);
+        mutex_unlock(jobs.sleepMutex);
+    }
+}
+
+static void finish_job(JobCounter* counter);
+
+static void execute(JobEntry entry) {
+    PROFILE_BEGIN("job");
+    entry.func(entry.data);
+    PROFILE_END();
+    finish_job(entry.counter);
+}
+
+static void submit(const JobEntry* entries, int count) {
+    JobDeque* deque = &jobs.deques[threadIndex];
+    int pushed = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (deque_push(deque, entries[i])) {
+            pushed++;
+            continue;
+        }
+
+        // Deque is full: let the workers drain what is there and do this one ourselves
+        atomic_fetch_add(&jobs.pending, pushed);
+        wake_workers();
+        pushed = 0;
+        execute(entries[i]);
+    }
+
+    if (pushed > 0) {
+        atomic_fetch_add(&jobs.pending, pushed);
+        wake_workers();
+    }
+}
+
+// Moves continuations whose dependency has reached zero into the calling thread's deque
+static void release_continuations(void) {
+    if (atomic_load(&jobs.continuationCount) == 0) return;
+
+    JobEntry ready[64];
+    int readyCount;
+
+    do {
+        readyCount = 0;
+        mutex_lock(jobs.continuationMutex);
+        int count = atomic_load(&jobs.continuationCount);
+        for (int i = 0; i < count && readyCount < 64; ) {
+            if (atomic_load(&jobs.continuations[i].dependency->value) == 0) {
+                ready[readyCount++] = jobs.continuations[i].entry;
+                jobs.continuations[i] = jobs.continuations[--count];
+            } else {
+                i++;
+            }
+        }
+        atomic_store(&jobs.continuationCount, count);
+        mutex_unlock(jobs.continuationMutex);
+
+        submit(ready, readyCount);
+    } while (readyCount == 64);
+}
+
+static void finish_job(JobCounter* counter) {
+    if (counter && atomic_fetch_sub(&counter->value, 1) == 1) {
+        release_continuations();
+    }
+}
+
+static bool try_run_one(void) {
+    JobEntry entry;
+    bool found = deque_pop(&jobs.deques[threadIndex], &entry);
+
+    for (int i = 1; !found && i < jobs.threadCount; i++) {
+        found = deque_steal(&jobs.deques[(threadIndex + i) % jobs.threadCount], &entry);
+    }
+
+    if (!found) return false;
+
+    atomic_fetch_sub(&jobs.pending, 1);
+    execute(entry);
+    return true;
+}
+
+static void worker_main(void* arg) {
+    threadIndex = (int)(intptr_t)arg;
+
+    while (atomic_load(&jobs.running)) {
+        if (try_run_one()) continue;
+
+        bool idle = true;
+        for (int spin = 0; spin < JOB_SPIN_COUNT && idle; spin++) {
+            thread_yield();
+            idle = atomic_load(&jobs.pending) == 0;
+        }
+        if (!idle) continue;
+
+        mutex_lock(jobs.sleepMutex);
+        atomic_fetch_add(&jobs.sleeping, 1);
+        while (atomic_load(&jobs.pending) == 0 && atomic_load(&jobs.running)) {
+            condvar_wait(jobs.sleepCond, jobs.sleepMutex);
+        }
+        atomic_fetch_sub(&jobs.sleeping, 1);
+        mutex_unlock(jobs.sleepMutex);
+    }
+}
+
+void jobs_init(int threadCount) {
+    if (threadCount <= 0) threadCount = platform_cpu_count();
+    if (threadCount > MAX_JOB_THREADS) threadCount = MAX_JOB_THREADS;
+
+    threadIndex = 0;
+    jobs.threadCount = 1;
+    atomic_store(&jobs.pending, 0);
+    atomic_store(&jobs.sleeping, 0);
+    atomic_store(&jobs.continuationCount, 0);
+    atomic_store(&jobs.running, true);
+
+    jobs.deques = (JobDeque*)calloc(threadCount, sizeof(JobDeque));
+    jobs.sleepMutex = mutex_create();
+    jobs.sleepCond = condvar_create();
+    jobs.continuationMutex = mutex_create();
+    if (!jobs.deques || !jobs.sleepMutex || !jobs.sleepCond || !jobs.continuationMutex) {
+        fprintf(stderr, "ERROR: Failed to allocate job system, running jobs inline\n");
+        return;
+    }
+
+    // Set before the workers start so they all agree on which deques to steal from.
+    // A worker that fails to start just leaves an empty deque behind.
+    jobs.threadCount = threadCount;
+    for (int i = 1; i < threadCount; i++) {
+        jobs.threads[i] = thread_create(worker_main, (void*)(intptr_t)i);
+        if (!jobs.threads[i]) {
+            fprintf(stderr, "ERROR: Failed to create job worker %d\n", i);
+        }
+    }
+
+    printf("INFO: Job system running on %d threads\n", jobs.threadCount);
+}
+
+void jobs_shutdown(void) {
+    atomic_store(&jobs.running, false);
+    if (jobs.sleepMutex) {
+        mutex_lock(jobs.sleepMutex);
+        condvar_broadcast(jobs.sleepCond);
+        mutex_unlock(jobs.sleepMutex);
+    }
+
+    for (int i = 1; i < jobs.threadCount; i++) {
+        if (jobs.threads[i]) {
+            thread_join(jobs.threads[i]);
+            jobs.threads[i] = NULL;
+        }
+    }
+
+    if (jobs.sleepMutex) mutex_destroy(jobs.sleepMutex);
+    if (jobs.sleepCond) condvar_destroy(jobs.sleepCond);
+    if (jobs.continuationMutex) mutex_destroy(jobs.continuationMutex);
+    free(jobs.deques);
+    free(jobs.continuations);
+
+    jobs.deques = NULL;
+    jobs.sleepMutex = NULL;
+    jobs.sleepCond = NULL;
+    jobs.continuationMutex = NULL;
+    jobs.continuations = NULL;
+    jobs.continuationCapacity = 0;
+    jobs.threadCount = 0;
+    threadIndex = -1;
+}
+
+int jobs_thread_count(void) {
+    return jobs.threadCount > 0 ? jobs.threadCount : 1;
+}
+
+int jobs_thread_index(void) {
+    return threadIndex > 0 ? threadIndex : 0;
+}
+
+static bool jobs_inline(void) {
+    return jobs.threadCount <= 1 || threadIndex < 0;
+}
+
+void jobs_run(const Job* jobList, int count, JobCounter* counter) {
+    if (jobs_inline()) {
+        for (int i = 0; i < count; i++) {
+            jobList[i].func(jobList[i].data);
+        }
+        return;
+    }
+
+    if (counter) atomic_fetch_add(&counter->value, count);
+
+    JobEntry entries[64];
+    for (int start = 0; start < count; start += 64) {
+        int batch = count - start < 64 ? count - start : 64;
+        for (int i = 0; i < batch; i++) {
+            entries[i] = (JobEntry){jobList[start + i].func, jobList[start + i].data, counter};
+        }
+        submit(entries, batch);
+    }
+}
+
+void jobs_run_after(JobCounter* dependency, const Job* jobList, int count, JobCounter* counter) {
+    if (jobs_inline() || !dependency) {
+        jobs_run(jobList, count, counter);
+        return;
+    }
+
+    if (counter) atomic_fetch_add(&counter->value, count);
+
+    mutex_lock(jobs.continuationMutex);
+
+    int start = atomic_load(&jobs.continuationCount);
+    if (start + count > jobs.continuationCapacity) {
+        int capacity = jobs.continuationCapacity ? jobs.continuationCapacity : 64;
+        while (capacity < start + count) capacity *= 2;
+        Continuation* continuations = (Continuation*)realloc(jobs.continuations, capacity * sizeof(Continuation));
+        if (!continuations) {
+            mutex_unlock(jobs.continuationMutex);
+            fprintf(stderr, "ERROR: Failed to queue dependent jobs, waiting inline\n");
+            jobs_wait(dependency);
+            if (counter) atomic_fetch_sub(&counter->value, count);
+            jobs_run(jobList, count, counter);
+            return;
+        }
+        jobs.continuations = continuations;
+        jobs.continuationCapacity = capacity;
+    }
+
+    for (int i = 0; i < count; i++) {
+        jobs.continuations[start + i] = (Continuation){dependency, {jobList[i].func, jobList[i].data, counter}};
+    }
+    // Publish the continuations before looking at the dependency, so a job finishing
+    // concurrently either sees them or we see its counter at zero
+    atomic_store(&jobs.continuationCount, start + count);
+    mutex_unlock(jobs.continuationMutex);
+
+    if (atomic_load(&dependency->value) == 0) {
+        release_continuations();
+    }
+}
+
+void jobs_wait(JobCounter* counter) {
+    while (atomic_load(&counter->value) > 0) {
+        if (jobs_inline() || !try_run_one()) {
+            thread_yield();
+        }
+    }
+
+    // The caller may free the counter once we return, so nothing may still reference it
+    if (!jobs_inline()) {
+        release_continuations();
+    }
+}
+
+typedef struct {
+    ParallelForFunc func;
+    void*           data;
+    int             start;
+    int             end;
+} ParallelForBatch;
+
+static void parallel_for_job(void* data) {
+    ParallelForBatch* batch = (ParallelForBatch*)data;
+    batch->func(batch->start, batch->end, batch->data);
+}
+
+void jobs_parallel_for(int count, int minBatch, ParallelForFunc func, void* data) {
+    if (count <= 0) return;
+    if (minBatch < 1) minBatch = 1;
+
+    int batchCount = count / minBatch;
+    int maxBatches = jobs_thread_count() * 4;
+    if (maxBatches > PARALLEL_FOR_MAX_BATCHES) maxBatches = PARALLEL_FOR_MAX_BATCHES;
+    if (batchCount > maxBatches) batchCount = maxBatches;
+
+    if (batchCount <= 1 || jobs_inline()) {
+        func(0, count, data);
+        return;
+    }
+
+    ParallelForBatch batches[PARALLEL_FOR_MAX_BATCHES];
+    Job jobList[PARALLEL_FOR_MAX_BATCHES];
+    for (int i = 0; i < batchCount; i++) {
+        batches[i] = (ParallelForBatch){func, data, (int)((long long)count * i / batchCount), (int)((long long)count * (i + 1) / batchCount)};
+        jobList[i] = (Job){parallel_for_job, &batches[i]};
+    }
+
+    JobCounter counter = {0};
+    jobs_run(jobList, batchCount, &counter);
+    jobs_wait(&counter);
+}
@@ -0,0 +1,35 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdatomic.h>
+
+#define MAX_JOB_THREADS 64
+
+typedef void (*JobFunc)(void* data);
+typedef void (*ParallelForFunc)(int start, int end, void* data);
+
+typedef struct {
+    JobFunc func;
+    void*   data;
+} Job;
+
+// Number of outstanding jobs. Zero-initialise, pass to jobs_run, then jobs_wait on it.
+typedef struct {
+    atomic_int value;
+} JobCounter;
+
+// threadCount includes the calling thread; 0 sizes the pool to the hardware concurrency.
+// Only the thread that called jobs_init and the workers may submit or wait on jobs.
+void jobs_init(int threadCount);
+void jobs_shutdown(void);
+int  jobs_thread_count(void);
+int  jobs_thread_index(void);
+
+void jobs_run(const Job* jobs, int count, JobCounter* counter);
+void jobs_run_after(JobCounter* dependency, const Job* jobs, int count, JobCounter* counter);
+void jobs_wait(JobCounter* counter);
+
+// Splits [0, count) into batches of at least minBatch indices and waits for all of them
+void jobs_parallel_for(int count, int minBatch, ParallelForFunc func, void* data);
+
+#endif
@@ -0,0 +1,71 @@
+#include "lod.h"
+#include "geometry.h"
+#include "memstats.h"
+#include "simplify.h"
+#include <math.h>
+
+#define LOD_MIN_SHRINK 0.8f     // a level must drop at least a fifth of the previous one's triangles
+
+static const float lodRatios[RENDERABLE_LODS] = {1.0f, 0.5f, 0.25f, 0.1f};
+// A level is drawn once the bounding sphere covers less than this share of the view height
+static const float lodScreenSizes[RENDERABLE_LODS] = {INFINITY, 0.25f, 0.12f, 0.05f};
+
+uint32_t* lod_build(const float* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                    uint32_t counts[RENDERABLE_LODS], uint8_t* levelCount) {
+    memset(counts, 0, RENDERABLE_LODS * sizeof(uint32_t));
+    counts[0] = indexCount;
+    *levelCount = 1;
+    if (!indices || indexCount < LOD_MIN_TRIANGLES * 3) return NULL;
+
+    // Each level is at most as long as the one before
+    uint32_t* chain = (uint32_t*)mem_alloc(MEMORY_MESH, (size_t)indexCount * RENDERABLE_LODS * sizeof(uint32_t));
+    if (!chain) {
+        fprintf(stderr, "ERROR: Failed to allocate LODs for %u indices\n", indexCount);
+        return NULL;
+    }
+    memcpy(chain, indices, indexCount * sizeof(uint32_t));
+
+    uint32_t offset = indexCount;
+    for (int level = 1; level < RENDERABLE_LODS; level++) {
+        uint32_t previous = counts[level - 1];
+        uint32_t target = (uint32_t)(indexCount / 3 * lodRatios[level]) * 3;
+        // Each level starts from the last, which keeps later levels cheap to make
+        uint32_t count = simplify_mesh(vertices, vertexCount, GEOMETRY_VERTEX_FLOATS,
+                                       &chain[offset - previous], previous, target, &chain[offset]);
+        if (count > previous * LOD_MIN_SHRINK) break;
+
+        counts[level] = count;
+        offset += count;
+        (*levelCount)++;
+    }
+    return chain;
+}
+
+uint8_t lod_select(const Renderable* renderable, const AABB* bounds, const vec3 eye, float fov) {
+    if (renderable->lodCount <= 1) return 0;
+
+    vec3 center, extent;
+    glm_vec3_center((float*)bounds->min, (float*)bounds->max, center);
+    glm_vec3_sub((float*)bounds->max, center, extent);
+    float radius = glm_vec3_norm(extent);
+    float distance = glm_vec3_distance(center, (float*)eye);
+    if (distance <= radius) return 0;
+
+    float size = radius / (distance * tanf(glm_rad(fov) * 0.5f));
+
+    int lod = renderable->lod < renderable->lodCount ? renderable->lod : renderable->lodCount - 1;
+    while (lod + 1 < renderable->lodCount && size < lodScreenSizes[lod + 1] * (1.0f - LOD_HYSTERESIS)) lod++;
+    while (lod > 0 && size > lodScreenSizes[lod] * (1.0f + LOD_HYSTERESIS)) lod--;
+    return (uint8_t)lod;
+}
+
+Renderable lod_level(const Renderable* renderable, uint8_t lod) {
+    Renderable level = *renderable;
+    if (lod == 0 || lod >= renderable->lodCount) return level;
+
+    for (uint8_t l = 0; l < lod; l++) {
+        level.firstIndex += renderable->lodIndexCounts[l];
+    }
+    level.indexCount = (int)renderable->lodIndexCounts[lod];
+    return level;
+}
@@ -0,0 +1,23 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include "common.h"
+#include "components.h"
+
+#define LOD_MIN_TRIANGLES 256   // meshes smaller than this are drawn at full detail only
+#define LOD_HYSTERESIS 0.15f    // a level switch waits until the size is this far past its threshold
+
+// Simplifies an indexed mesh (GEOMETRY_VERTEX_FLOATS per vertex) to about 50, 25 and 10% of
+// its triangles and returns the full and simplified index lists back to back, to be freed
+// with mem_free. Levels that barely shrink are dropped. NULL, with a single level counted,
+// for meshes without indices or too small to bother.
+uint32_t* lod_build(const float* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                    uint32_t counts[RENDERABLE_LODS], uint8_t* levelCount);
+
+// Level for a mesh whose world bounds cover the given share of a vertical fov (degrees),
+// starting from the level it was drawn at last
+uint8_t lod_select(const Renderable* renderable, const AABB* bounds, const vec3 eye, float fov);
+// A copy of renderable that draws only the given level
+Renderable lod_level(const Renderable* renderable, uint8_t lod);
+
+#endif
@@ -2,8 +2,11 @@
 #include <GLFW/glfw3.h>
 #include <cglm/cglm.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 #include "nanovg.h"
+#include "renderstats.h"    // ahead of the GL backend, so NanoVG's calls are counted too
 #define NANOVG_GL3_IMPLEMENTATION
 #include "nanovg_gl.h"
 
@@ -13,22 +16,35 @@
 #include "camera.h"
 #include "shader.h"
 #include "input.h"
+#include "jobs.h"
+#include "collision.h"
+#include "platform.h"
+#include "profiler.h"
+#include "gputimer.h"
+#include "memstats.h"
+#include "renderer.h"
+#include "geometry.h"
+#include "multidraw.h"
 
 #define WINDOW_WIDTH    1200
 #define WINDOW_HEIGHT   800
+#define HEADLESS_FRAMES 600 // default length of a headless run, ten simulated seconds
 
 State state;
 NVGcontext* vg;
 GLuint fontNormal;
 GLuint fontMono;
-float lastX = WINDOW_WIDTH / 2.0f;
-float lastY = WINDOW_HEIGHT / 2.0f;
-bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 float fps = 0.0f;
 float lastTime = 0.0f;
 int frameCount = 0;
+Entity hovered = {0, 0};
+
+GpuTimer gpuTimer;
+int renderPass, scenePass, uiPass;
+Renderer renderer;
+MultiDraw multiDraw;
 
 vec3 lightPos = {4.5f, 3.0f, 4.5f};
 vec3 lightColor = {1.0f, 1.0f, 1.0f};
@@ -73,28 +89,25 @@ void cleanupVG() {
     }
 }
 
-void drawVG() {
+void drawVG(RenderFrame* frame) {
     nvgBeginFrame(vg, WINDOW_WIDTH, WINDOW_HEIGHT, 1.0f);
 
-    char debugText[256];
-    snprintf(debugText, sizeof(debugText), 
-             "fps: %.2f - "
-             "camera pos: (%.2f, %.2f, %.2f) - "
-             "camera yaw: %.2f - "
-             "camera pitch: %.2f - "
-             "dt: %.4f",
-             fps,
-             state.camera.position[0], state.camera.position[1], state.camera.position[2],
-             state.camera.yaw,
-             state.camera.pitch,
-             deltaTime);
-
     nvgFontSize(vg, 16.0f);
     nvgFontFace(vg, "mono");
     nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
 
     nvgFillColor(vg, nvgRGB(255, 255, 255));
-    nvgText(vg, 15, 15, debugText, NULL);
+    nvgText(vg, 15, 15, frame->debugText, NULL);
+
+    // CPU submission against GPU execution per pass, to tell which side bounds the frame
+    char passText[256];
+    int length = snprintf(passText, sizeof(passText), "cpu/gpu ms");
+    for (int i = 0; i < gpuTimer.passCount && length < (int)sizeof(passText); i++) {
+        const GpuPass* pass = &gpuTimer.passes[i];
+        length += snprintf(passText + length, sizeof(passText) - length, " - %s: %.2f / %.2f",
+                           pass->name, pass->cpuMilliseconds, pass->gpuMilliseconds);
+    }
+    nvgText(vg, 15, 35, passText, NULL);
     
     nvgBeginPath(vg);
     nvgRoundedRect(vg, 10, 70, 220, 190, 8);
@@ -105,11 +118,94 @@ void drawVG() {
     nvgFontSize(vg, 18.0f);
     nvgText(vg, 20, 80, "Debug Menu", NULL);
 
-    ui_draw(&state.ui);
+    ui_draw(&frame->ui);
+
+    OverlayStats stats = {
+        .physicsStages = frame->physicsStages,
+        .gpu = &gpuTimer,
+        .render = render_stats_last(),
+        .memoryBytes = frame->memoryBytes,
+    };
+    overlay_draw(&frame->overlay, vg, WINDOW_WIDTH - OVERLAY_WIDTH - 10, 10, &stats);
 
     nvgEndFrame(vg);
 }
 
+// Main thread: everything the render thread will need for this frame, from the simulation's state
+static void build_frame(RenderFrame* frame) {
+    state_build_frame(&state, frame, (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT);
+    glfwGetFramebufferSize(state.window, &frame->framebufferWidth, &frame->framebufferHeight);
+    glm_vec3_copy(lightPos, frame->lightPos);
+    glm_vec3_copy(lightColor, frame->lightColor);
+    frame->time = glfwGetTime();
+    frame->memoryBytes = state.overlay.visible ? platform_memory_usage() : 0;
+
+    snprintf(frame->debugText, sizeof(frame->debugText),
+             "fps: %.2f - "
+             "camera pos: (%.2f, %.2f, %.2f) - "
+             "camera yaw: %.2f - "
+             "camera pitch: %.2f - "
+             "dt: %.4f - "
+             "hover: %d - "
+             "occluded: %u",
+             fps,
+             state.camera.position[0], state.camera.position[1], state.camera.position[2],
+             state.camera.yaw,
+             state.camera.pitch,
+             deltaTime,
+             hovered.generation ? (int)hovered.index : -1,
+             state.occlusion.hidden);
+}
+
+static void set_frame_uniforms(Shader* shader, RenderFrame* frame) {
+    s_use(shader);
+
+    s_setMat4(shader, "view", (float*)frame->view);
+    s_setMat4(shader, "projection", (float*)frame->projection);
+    s_setFloat(shader, "time", frame->time);
+
+    s_setVec3(shader, "lightPos", frame->lightPos);
+    s_setVec3(shader, "lightColor", frame->lightColor);
+    s_setVec3(shader, "viewPos", frame->viewPos);
+}
+
+// Render thread: submits a built frame. Only this side touches GL once the loop is running.
+static void render_frame(RenderFrame* frame, void* user) {
+    Shader* shader = (Shader*)user;
+
+    gpu_timer_begin(&gpuTimer, renderPass);
+
+    // The main thread has no context to resize the viewport from, so it comes with the frame
+    glViewport(0, 0, frame->framebufferWidth, frame->framebufferHeight);
+    glClearColor(0.15f, 0.151f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    gpu_timer_begin(&gpuTimer, scenePass);
+    if (multiDraw.supported) {
+        set_frame_uniforms(&multiDraw.shader, frame);
+        multidraw_submit(&multiDraw, frame);
+    } else {
+        set_frame_uniforms(shader, frame);
+        for (uint32_t i = 0; i < frame->itemCount; i++) {
+            renderable_draw(&frame->items[i].renderable, frame->items[i].model, shader->id);
+        }
+    }
+    gpu_timer_end(&gpuTimer, scenePass);
+
+    gpu_timer_begin(&gpuTimer, uiPass);
+    drawVG(frame);
+    gpu_timer_end(&gpuTimer, uiPass);
+
+    gpu_timer_end(&gpuTimer, renderPass);
+    gpu_timer_end_frame(&gpuTimer);
+    render_stats_end_frame();
+}
+
 void setup_debug_menu(State* state) {
     ui_add_slider(&state->ui, 20, 120, 200, 20, "Camera Speed", 0.0f, 10.0f, &state->camera.speed);
     ui_add_slider(&state->ui, 20, 170, 200, 20, "Camera Yaw", -180.0f, 180.0f, &state->camera.yaw);
@@ -122,20 +218,217 @@ void test() {
 }
 
 bool dest(void) {
-    glfwSetWindowShouldClose(state.window, 1);
+    if (state.window) glfwSetWindowShouldClose(state.window, 1);
+    return true;
+}
+
+typedef struct {
+    bool        deterministic;
+    bool        headless;
+    uint32_t    frames;         // headless run length, 0 for the default (or the whole replay)
+    const char* recordPath;
+    const char* replayPath;
+    const char* tracePath;      // Chrome trace of the last few thousand scopes, written at exit
+    bool        memoryReport;   // per-subsystem memory printed before shutdown
+    bool        noMultiDraw;    // draw object by object even where indirect draws work
+    bool        noOcclusion;    // draw everything in view, hidden or not
+} Options;
+
+static bool parse_options(int argc, char** argv, Options* options) {
+    memset(options, 0, sizeof(*options));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--deterministic") == 0) {
+            options->deterministic = true;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            options->headless = true;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            options->frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            // Simulated seconds, so the run is the same length however fast the machine is
+            options->frames = (uint32_t)ceil(atof(argv[++i]) / STATE_FIXED_STEP);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            options->recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            options->replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            options->tracePath = argv[++i];
+        } else if (strcmp(argv[i], "--memory-report") == 0) {
+            options->memoryReport = true;
+        } else if (strcmp(argv[i], "--no-multidraw") == 0) {
+            options->noMultiDraw = true;
+        } else if (strcmp(argv[i], "--no-occlusion") == 0) {
+            options->noOcclusion = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--deterministic] [--record FILE | --replay FILE] "
+                            "[--headless [--frames N | --seconds S]] [--trace FILE] [--memory-report] [--no-multidraw] "
+                            "[--no-occlusion]\n", argv[0]);
+            return false;
+        }
+    }
+
+    if (options->recordPath && options->replayPath) {
+        fprintf(stderr, "Can't record and replay at the same time\n");
+        return false;
+    }
+    if (options->recordPath && options->headless) {
+        fprintf(stderr, "Can't record without a window\n");
+        return false;
+    }
+    return true;
+}
+
+static void setup_scene(State* state) {
+    Object cube, baseplate, mesh, wedge, place, light, hut, gun;
+    object_create_cube(&cube, (vec3){0.35f, 0.35f, 0.35f}, "../res/textures/sky-blue.png");
+    object_create_plane(&baseplate, (vec3){0.15f, 0.15f, 0.15f}, "../res/textures/grid.png");
+    object_load_from_obj(&mesh, "../res/objs/test.obj", (vec3){0.5f, 0.5f, 0.2f}, "../res/textures/sky-blue.png");
+    object_load_from_obj(&wedge, "../res/objs/wedge.obj", (vec3){0.7, 0.2f, 1.0f}, "../res/textures/sky-blue.png");
+    object_load_from_obj(&place, "../res/objs/place.obj", (vec3){0.1, 0.1f, 0.1f}, "../res/textures/sky-blue.png");
+    object_load_from_obj(&hut, "../res/objs/hut.obj", (vec3){0.1, 0.1f, 0.1f}, "../res/textures/wood.png");
+    object_load_from_obj(&gun, "../res/objs/gun.obj", (vec3){0.1, 0.1f, 0.1f}, NULL);
+    object_create_cube(&light, lightColor, NULL);
+
+    baseplate.textureScale = 10.0f;
+
+    // Scenery doesn't fall; static meshes collide against their triangles rather than their box.
+    // The baseplate only marks the ground plane and the light marker is just for show.
+    // The hut is big and plain enough to hide what's behind it from the renderer.
+    hut.bodyType = BODY_STATIC;
+    hut.occluder = true;
+    baseplate.bodyType = BODY_STATIC;
+    baseplate.mask = PHYSICS_LAYER_NONE;
+    light.bodyType = BODY_STATIC;
+    light.category = PHYSICS_LAYER_NONE;
+    light.mask = PHYSICS_LAYER_NONE;
+
+    glm_vec3_copy(lightPos, light.position);
+    glm_vec3_copy((vec3){0.2f, 0.2f, 0.2f}, light.scale);
+    glm_vec3_copy((vec3){0.0f, 5.0f, 0.0f}, gun.position);
+    glm_vec3_copy((vec3){0.2f, 0.2f, 0.2f}, gun.scale);
+    glm_vec3_copy((vec3){0.3f, 0.3f, 0.3f}, hut.scale);
+    glm_vec3_copy((vec3){5.0f, 0.0f, 5.0f}, hut.position);
+    glm_vec3_copy((vec3){0.0f, COLLISION_GROUND_HEIGHT, 0.0f}, baseplate.position);
+    glm_vec3_copy((vec3){0.0f, 5.0f, 0.0f}, cube.position);
+    glm_vec3_copy((vec3){1.0f, 7.0f, 0.0f}, mesh.position);
+    glm_vec3_copy((vec3){-1.0f, 9.0f, 0.0f}, wedge.position);
+    glm_vec3_copy((vec3){0.0f, 20.0f, 6.0f}, place.position);
+    glm_vec3_copy((vec3){1.0f, 0.1f, 1.0f}, baseplate.scale);
+
+    state_add_object(state, &cube);
+    state_add_object(state, &baseplate);
+    state_add_object(state, &mesh);
+    state_add_object(state, &wedge);
+    state_add_object(state, &place);
+    state_add_object(state, &light);
+    state_add_object(state, &hut);
+    state_add_object(state, &gun);
+
+    // The entities hold their own references to the geometry now
+    Object* templates[] = {&cube, &baseplate, &mesh, &wedge, &place, &light, &hut, &gun};
+    for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) {
+        object_cleanup(templates[i]);
+    }
+    state_finalize(state);
+}
+
+static void start_profiler(const Options* options) {
+    profiler_init();
+    if (options->tracePath) profiler_set_enabled(true);
+}
+
+static void stop_profiler(const Options* options) {
+    if (options->tracePath && profiler_write_trace(options->tracePath)) {
+        printf("Wrote trace to %s\n", options->tracePath);
+    }
+    profiler_shutdown();
 }
 
-int main() {
+// Steps the simulation with no window, GL context or NanoVG, for profiling and CI.
+// Frames are fixed steps with no input, or the frames of a replay when one is given.
+static int run_headless(const Options* options) {
+    object_set_headless(true);
+
+    jobs_init(0);
+    start_profiler(options);
+    state_init(&state);
+    ui_init(&state.ui, NULL);
+    setup_scene(&state);
+
+    Replay replay = {0};
+    uint32_t limit = options->frames;
+    if (options->replayPath) {
+        if (!replay_open(&replay, options->replayPath)) return -1;
+        state_set_deterministic(&state, replay.fixedStep);
+    } else {
+        state_set_deterministic(&state, STATE_FIXED_STEP);
+        if (limit == 0) limit = HEADLESS_FRAMES;
+    }
+
+    uint32_t frames = 0;
+    double start = platform_time();
+
+    while (limit == 0 || frames < limit) {
+        InputFrame input;
+        if (options->replayPath) {
+            if (!replay_read(&replay, &input)) break;
+        } else {
+            memset(&input, 0, sizeof(input));
+            input.deltaTime = STATE_FIXED_STEP;
+        }
+
+        if (!input_apply(&state, &input)) break;
+
+        PROFILE_BEGIN("frame");
+        PROFILE_BEGIN("pick");
+        RaycastHit hit;
+        hovered = state_pick(&state, input.cursorX, input.cursorY, WINDOW_WIDTH, WINDOW_HEIGHT, &hit) ? hit.entity : HANDLE_NULL;
+        PROFILE_END();
+
+        PROFILE_BEGIN("update");
+        state_update(&state, input.deltaTime);
+        PROFILE_END();
+        PROFILE_END();
+        frames++;
+    }
+
+    double elapsed = platform_time() - start;
+    printf("Ran %u headless frames in %.3f s (%.3f ms/frame), checksum %016llx\n",
+           frames, elapsed, frames ? 1000.0 * elapsed / frames : 0.0,
+           (unsigned long long)state_checksum(&state));
+
+    replay_close(&replay);
+    if (options->memoryReport) mem_dump(stdout);
+    state_cleanup(&state);
+    stop_profiler(options);
+    jobs_shutdown();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, &options)) {
+        return -1;
+    }
+
+    if (options.headless) {
+        return run_headless(&options);
+    }
+
     if (!glfwInit()) {
         fprintf(stderr, "Failed to initialize GLFW\n");
         return -1;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-    GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "crab", NULL, NULL);
+    // 4.3 for indirect draws where the driver has it; everything else runs on 3.3
+    static const int contextVersions[][2] = {{4, 6}, {4, 3}, {3, 3}};
+    GLFWwindow* window = NULL;
+    for (size_t i = 0; i < sizeof(contextVersions) / sizeof(contextVersions[0]) && window == NULL; i++) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, contextVersions[i][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, contextVersions[i][1]);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "crab", NULL, NULL);
+    }
     if (window == NULL) {
         fprintf(stderr, "Failed to create GLFW window\n");
         glfwTerminate();
@@ -145,10 +438,9 @@ int main() {
     state.window = window;
 
     glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window, key_callback);
+    glfwSetWindowUserPointer(window, &state);
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
@@ -157,7 +449,15 @@ int main() {
         return -1;
     }
 
+    jobs_init(0);
+    start_profiler(&options);
     state_init(&state);
+    if (options.noOcclusion) state.occlusion.enabled = false;
+
+    gpu_timer_init(&gpuTimer);
+    renderPass = gpu_timer_add_pass(&gpuTimer, "render");
+    scenePass = gpu_timer_add_pass(&gpuTimer, "scene");
+    uiPass = gpu_timer_add_pass(&gpuTimer, "ui");
 
     Shader shaderProgram;
     s_load(&shaderProgram, "../src/shaders/vert_default.glsl", "../src/shaders/frag_default.glsl");
@@ -165,39 +465,9 @@ int main() {
     Shader aabbProgram;
     s_load(&aabbProgram, "../src/shaders/vert_aabb.glsl", "../src/shaders/frag_aabb.glsl");
 
-    Object cube, baseplate, mesh, wedge, place, light, hut, gun;
-    object_create_cube(&cube, (vec3){0.35f, 0.35f, 0.35f}, "../res/textures/sky-blue.png");
-    object_create_plane(&baseplate, (vec3){0.15f, 0.15f, 0.15f}, "../res/textures/grid.png");
-    object_load_from_obj(&mesh, "../res/objs/test.obj", (vec3){0.5f, 0.5f, 0.2f}, "../res/textures/sky-blue.png");
-    object_load_from_obj(&wedge, "../res/objs/wedge.obj", (vec3){0.7, 0.2f, 1.0f}, "../res/textures/sky-blue.png");
-    object_load_from_obj(&place, "../res/objs/place.obj", (vec3){0.1, 0.1f, 0.1f}, "../res/textures/sky-blue.png");
-    object_load_from_obj(&hut, "../res/objs/hut.obj", (vec3){0.1, 0.1f, 0.1f}, "../res/textures/wood.png");
-    object_load_from_obj(&gun, "../res/objs/gun.obj", (vec3){0.1, 0.1f, 0.1f}, NULL);
-    object_create_cube(&light, lightColor, NULL);
-
-    baseplate.textureScale = 10.0f;
+    if (!options.noMultiDraw) multidraw_init(&multiDraw);
 
-    glm_vec3_copy(lightPos, light.position);
-    glm_vec3_copy((vec3){0.2f, 0.2f, 0.2f}, light.scale);
-    glm_vec3_copy((vec3){0.0f, 5.0f, 0.0f}, gun.position);
-    glm_vec3_copy((vec3){0.2f, 0.2f, 0.2f}, gun.scale);
-    glm_vec3_copy((vec3){0.3f, 0.3f, 0.3f}, hut.scale);
-    glm_vec3_copy((vec3){5.0f, 0.0f, 5.0f}, hut.position);
-    glm_vec3_copy((vec3){0.0f, -1.0f, 0.0f}, baseplate.position);
-    glm_vec3_copy((vec3){0.0f, 5.0f, 0.0f}, cube.position);
-    glm_vec3_copy((vec3){1.0f, 7.0f, 0.0f}, mesh.position);
-    glm_vec3_copy((vec3){-1.0f, 9.0f, 0.0f}, wedge.position);
-    glm_vec3_copy((vec3){0.0f, 20.0f, 6.0f}, place.position);
-    glm_vec3_copy((vec3){1.0f, 0.1f, 1.0f}, baseplate.scale);
-
-    state_add_object(&state, &cube);
-    state_add_object(&state, &baseplate);
-    state_add_object(&state, &mesh);
-    state_add_object(&state, &wedge);
-    state_add_object(&state, &place);
-    state_add_object(&state, &light);
-    state_add_object(&state, &hut);
-    state_add_object(&state, &gun);
+    setup_scene(&state);
 
     initVG();
     setup_debug_menu(&state);
@@ -215,11 +485,48 @@ int main() {
     ui_add_menu_item(&state.ui, "Options", test);
     ui_add_menu_item(&state.ui, "Quit", test);
 
+    // Recording implies deterministic mode, so the replay steps physics exactly as the session did
+    Replay replay = {0};
+    if (options.replayPath) {
+        if (!replay_open(&replay, options.replayPath)) return -1;
+        state_set_deterministic(&state, replay.fixedStep);
+        glfwSwapInterval(0);
+    } else if (options.recordPath) {
+        if (!replay_create(&replay, options.recordPath, STATE_FIXED_STEP)) return -1;
+        state_set_deterministic(&state, STATE_FIXED_STEP);
+    } else if (options.deterministic) {
+        state_set_deterministic(&state, STATE_FIXED_STEP);
+    }
+
+    // From here the render thread owns the context, and later loads hand it their GL work
+    if (!renderer_start(&renderer, window, render_frame, &shaderProgram)) return -1;
+
+    double replayStart = glfwGetTime();
+
     while (!glfwWindowShouldClose(window)) {
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        PROFILE_BEGIN("frame");
+
+        // Replays run as fast as they can, taking frame times from the log instead of the clock
+        PROFILE_BEGIN("input");
+        InputFrame input;
+        if (options.replayPath) {
+            if (!replay_read(&replay, &input)) {
+                PROFILE_END();
+                PROFILE_END();
+                break;
+            }
+            deltaTime = input.deltaTime;
+        } else {
+            input_poll(window, deltaTime, &input);
+            if (options.recordPath) replay_write(&replay, &input);
+        }
+
+        overlay_push_frame(&state.overlay, 1000.0f * deltaTime);
+
         frameCount++;
         if (currentFrame - lastTime >= 1.0) {
             fps = frameCount / (currentFrame - lastTime);
@@ -227,49 +534,55 @@ int main() {
             frameCount = 0;
         }
 
-        process_input(window, &state, deltaTime);
-
-        double xpos, ypos;
-        glfwGetCursorPos(window, &xpos, &ypos);
-        ui_handle_mouse(&state.ui, xpos, ypos, glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS);
-
-        glClearColor(0.15f, 0.151f, 0.15f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        s_use(&shaderProgram);
-
-        mat4 view, projection;
-        camera_get_view_matrix(&state.camera, view);
-        glm_perspective(glm_rad(state.camera.fov), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f, projection);
-
-        s_setMat4(&shaderProgram, "view", (float*)view);
-        s_setMat4(&shaderProgram, "projection", (float*)projection);
-        s_setFloat(&shaderProgram, "time", glfwGetTime());
+        if (!input_apply(&state, &input)) {
+            glfwSetWindowShouldClose(window, 1);
+        }
+        PROFILE_END();
 
-        s_setVec3(&shaderProgram, "lightPos", lightPos);
-        s_setVec3(&shaderProgram, "lightColor", lightColor);
-        s_setVec3(&shaderProgram, "viewPos", state.camera.position);
+        PROFILE_BEGIN("pick");
+        RaycastHit hit;
+        hovered = state_pick(&state, input.cursorX, input.cursorY, WINDOW_WIDTH, WINDOW_HEIGHT, &hit) ? hit.entity : HANDLE_NULL;
+        PROFILE_END();
 
+        PROFILE_BEGIN("update");
         state_update(&state, deltaTime);
+        PROFILE_END();
 
-        for (int i = 0; i < state.objectCount; i++) {
-            object_draw(&state.objects[i], shaderProgram.id);
-        }
+        // Waits only if the render thread is still two frames behind
+        PROFILE_BEGIN("build");
+        RenderFrame* frame = renderer_begin_frame(&renderer);
+        build_frame(frame);
+        renderer_submit(&renderer);
+        PROFILE_END();
 
-        drawVG();
-
-        glfwSwapBuffers(window);
+        PROFILE_BEGIN("events");
         glfwPollEvents();
+        PROFILE_END();
+
+        PROFILE_END();
+    }
+
+    if (options.replayPath) {
+        double elapsed = glfwGetTime() - replayStart;
+        printf("Replayed %u frames in %.3f s (%.3f ms/frame), checksum %016llx\n",
+               replay.frameCount, elapsed, replay.frameCount ? 1000.0 * elapsed / replay.frameCount : 0.0,
+               (unsigned long long)state_checksum(&state));
+    } else if (options.recordPath) {
+        printf("Recorded %u frames to %s, checksum %016llx\n",
+               replay.frameCount, options.recordPath, (unsigned long long)state_checksum(&state));
     }
+    replay_close(&replay);
+    renderer_stop(&renderer);
+    if (options.memoryReport) mem_dump(stdout);
 
     s_destroy(&shaderProgram);
-    object_cleanup(&mesh);
+    multidraw_free(&multiDraw);
+    gpu_timer_free(&gpuTimer);
+    state_cleanup(&state);
+    geometry_free();
     cleanupVG();
+    stop_profiler(&options);
+    jobs_shutdown();
 
     glfwTerminate();
     return 0;
@@ -0,0 +1,147 @@
+#include "memstats.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEMORY_MAGIC 0x4d454d53u
+
+// Sits in front of every tracked block, padded so the block keeps malloc's alignment
+typedef union {
+    struct {
+        size_t   size;
+        uint32_t tag;
+        uint32_t magic;
+    } info;
+    max_align_t align;
+} MemoryHeader;
+
+typedef struct {
+    atomic_size_t current;
+    atomic_size_t peak;
+    atomic_size_t allocations;
+} MemoryCounters;
+
+// Allocations come from job threads too (physics buffers grow mid-step)
+static MemoryCounters counters[MEMORY_TAG_COUNT];
+
+static const char* tagNames[MEMORY_TAG_COUNT] = {
+    "general", "mesh", "texture", "shader", "ui", "font", "physics", "ecs", "render", "gpu buffer", "gpu texture"
+};
+
+static void mem_charge(MemoryTag tag, ptrdiff_t delta) {
+    MemoryCounters* counter = &counters[tag];
+    size_t current = atomic_fetch_add_explicit(&counter->current, (size_t)delta, memory_order_relaxed) + (size_t)delta;
+    if (delta <= 0) return;
+
+    size_t peak = atomic_load_explicit(&counter->peak, memory_order_relaxed);
+    while (current > peak &&
+           !atomic_compare_exchange_weak_explicit(&counter->peak, &peak, current, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static MemoryHeader* mem_header(void* ptr) {
+    MemoryHeader* header = (MemoryHeader*)ptr - 1;
+    if (header->info.magic != MEMORY_MAGIC || header->info.tag >= MEMORY_TAG_COUNT) {
+        // Most likely plain malloc memory handed to mem_free; leaking beats corrupting the heap
+        fprintf(stderr, "ERROR: %p was not allocated by mem_alloc, leaking it\n", ptr);
+        return NULL;
+    }
+    return header;
+}
+
+void* mem_alloc(MemoryTag tag, size_t size) {
+    if (size > SIZE_MAX - sizeof(MemoryHeader)) return NULL;
+
+    MemoryHeader* header = (MemoryHeader*)malloc(sizeof(MemoryHeader) + size);
+    if (!header) return NULL;
+
+    header->info.size = size;
+    header->info.tag = tag;
+    header->info.magic = MEMORY_MAGIC;
+    mem_charge(tag, (ptrdiff_t)size);
+    atomic_fetch_add_explicit(&counters[tag].allocations, 1, memory_order_relaxed);
+    return header + 1;
+}
+
+void* mem_calloc(MemoryTag tag, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) return NULL;
+
+    void* ptr = mem_alloc(tag, count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void* mem_realloc(MemoryTag tag, void* ptr, size_t size) {
+    if (!ptr) return mem_alloc(tag, size);
+    if (size == 0) {
+        mem_free(ptr);
+        return NULL;
+    }
+    if (size > SIZE_MAX - sizeof(MemoryHeader)) return NULL;
+
+    MemoryHeader* header = mem_header(ptr);
+    if (!header) return NULL;
+
+    size_t oldSize = header->info.size;
+    MemoryTag owner = (MemoryTag)header->info.tag;
+    MemoryHeader* grown = (MemoryHeader*)realloc(header, sizeof(MemoryHeader) + size);
+    if (!grown) return NULL;
+
+    grown->info.size = size;
+    mem_charge(owner, (ptrdiff_t)size - (ptrdiff_t)oldSize);
+    return grown + 1;
+}
+
+void mem_free(void* ptr) {
+    if (!ptr) return;
+
+    MemoryHeader* header = mem_header(ptr);
+    if (!header) return;
+
+    MemoryTag tag = (MemoryTag)header->info.tag;
+    mem_charge(tag, -(ptrdiff_t)header->info.size);
+    atomic_fetch_sub_explicit(&counters[tag].allocations, 1, memory_order_relaxed);
+    header->info.magic = 0;
+    free(header);
+}
+
+void mem_track(MemoryTag tag, ptrdiff_t delta) {
+    mem_charge(tag, delta);
+}
+
+MemoryUsage mem_usage(MemoryTag tag) {
+    MemoryUsage usage;
+    usage.current = atomic_load_explicit(&counters[tag].current, memory_order_relaxed);
+    usage.peak = atomic_load_explicit(&counters[tag].peak, memory_order_relaxed);
+    usage.allocations = atomic_load_explicit(&counters[tag].allocations, memory_order_relaxed);
+    return usage;
+}
+
+size_t mem_total(MemoryTag first, MemoryTag last) {
+    size_t total = 0;
+    for (int tag = first; tag < (int)last; tag++) {
+        total += atomic_load_explicit(&counters[tag].current, memory_order_relaxed);
+    }
+    return total;
+}
+
+const char* mem_tag_name(MemoryTag tag) {
+    return tag < MEMORY_TAG_COUNT ? tagNames[tag] : "unknown";
+}
+
+void mem_dump(FILE* file) {
+    fprintf(file, "%-12s %12s %12s %10s\n", "tag", "current KB", "peak KB", "blocks");
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        MemoryUsage usage = mem_usage((MemoryTag)tag);
+        if (tag == MEMORY_GPU_FIRST) {
+            fprintf(file, "%-12s %12.1f\n", "cpu total", mem_total(MEMORY_GENERAL, MEMORY_GPU_FIRST) / 1024.0);
+        }
+        if (tag < MEMORY_GPU_FIRST) {
+            fprintf(file, "%-12s %12.1f %12.1f %10zu\n", tagNames[tag], usage.current / 1024.0, usage.peak / 1024.0, usage.allocations);
+        } else {
+            fprintf(file, "%-12s %12.1f %12.1f %10s\n", tagNames[tag], usage.current / 1024.0, usage.peak / 1024.0, "-");
+        }
+    }
+    fprintf(file, "%-12s %12.1f\n", "gpu total", mem_total(MEMORY_GPU_FIRST, MEMORY_TAG_COUNT) / 1024.0);
+}
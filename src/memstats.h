@@ -0,0 +1,47 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef enum {
+    MEMORY_GENERAL,
+    MEMORY_MESH,            // vertex data, collision meshes and OBJ parsing
+    MEMORY_TEXTURE,         // decoded images before upload
+    MEMORY_SHADER,
+    MEMORY_UI,              // NanoVG paths and commands
+    MEMORY_FONT,            // fontstash atlas and glyphs
+    MEMORY_PHYSICS,
+    MEMORY_ECS,
+    MEMORY_RENDER,          // per-frame command lists
+    MEMORY_GPU_BUFFER,      // estimated from glBufferData
+    MEMORY_GPU_TEXTURE,     // estimated from glTexImage2D
+    MEMORY_TAG_COUNT
+} MemoryTag;
+
+#define MEMORY_GPU_FIRST MEMORY_GPU_BUFFER
+
+typedef struct {
+    size_t current;
+    size_t peak;
+    size_t allocations;     // live blocks, CPU tags only
+} MemoryUsage;
+
+// Drop-in malloc/calloc/realloc/free that charge each block to a tag. Blocks carry a small
+// header, so memory from these must only be released with mem_free and vice versa.
+void* mem_alloc(MemoryTag tag, size_t size);
+void* mem_calloc(MemoryTag tag, size_t count, size_t size);
+// A block keeps the tag it was first allocated with
+void* mem_realloc(MemoryTag tag, void* ptr, size_t size);
+void  mem_free(void* ptr);
+
+// Charges memory the allocator doesn't see, such as GPU objects
+void mem_track(MemoryTag tag, ptrdiff_t delta);
+
+MemoryUsage mem_usage(MemoryTag tag);
+// Current bytes over the tags in [first, last)
+size_t mem_total(MemoryTag first, MemoryTag last);
+const char* mem_tag_name(MemoryTag tag);
+void mem_dump(FILE* file);
+
+#endif
@@ -0,0 +1,131 @@
+#include "mesh.h"
+#include "memstats.h"
+#include <float.h>
+#include <math.h>
+
+static Mesh* meshes = NULL;
+
+const Mesh* mesh_find(const char* path) {
+    Mesh* mesh = NULL;
+    HASH_FIND_STR(meshes, path, mesh);
+    return mesh;
+}
+
+static void mesh_destroy(Mesh* mesh) {
+    bvh_free(&mesh->bvh);
+    mem_free(mesh->path);
+    mem_free(mesh->positions);
+    mem_free(mesh->indices);
+    mem_free(mesh);
+}
+
+const Mesh* mesh_create(const char* path, const float* vertices, uint32_t stride, uint32_t vertexCount,
+                        const uint32_t* indices, uint32_t indexCount) {
+    Mesh* mesh = (Mesh*)mem_calloc(MEMORY_MESH, 1, sizeof(Mesh));
+    if (!mesh) {
+        fprintf(stderr, "ERROR: Failed to allocate mesh for %s\n", path);
+        return NULL;
+    }
+
+    uint32_t triangleCount = indexCount / 3;
+    mesh->path = (char*)mem_alloc(MEMORY_MESH, strlen(path) + 1);
+    mesh->positions = (vec3*)mem_alloc(MEMORY_MESH, vertexCount * sizeof(vec3));
+    mesh->indices = (uint32_t*)mem_alloc(MEMORY_MESH, triangleCount * 3 * sizeof(uint32_t));
+    AABB* triangleBounds = (AABB*)mem_alloc(MEMORY_MESH, triangleCount * sizeof(AABB));
+    if (!mesh->path || !mesh->positions || !mesh->indices || !triangleBounds) {
+        fprintf(stderr, "ERROR: Failed to allocate mesh data for %s\n", path);
+        mem_free(triangleBounds);
+        mesh_destroy(mesh);
+        return NULL;
+    }
+
+    strcpy(mesh->path, path);
+    mesh->vertexCount = vertexCount;
+    mesh->triangleCount = triangleCount;
+    memcpy(mesh->indices, indices, triangleCount * 3 * sizeof(uint32_t));
+
+    glm_vec3_fill(mesh->bounds.min, FLT_MAX);
+    glm_vec3_fill(mesh->bounds.max, -FLT_MAX);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        glm_vec3_copy((float*)&vertices[i * stride], mesh->positions[i]);
+        glm_vec3_minv(mesh->bounds.min, mesh->positions[i], mesh->bounds.min);
+        glm_vec3_maxv(mesh->bounds.max, mesh->positions[i], mesh->bounds.max);
+    }
+
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        vec3 corners[3];
+        mesh_triangle(mesh, t, corners);
+        glm_vec3_minv(corners[0], corners[1], triangleBounds[t].min);
+        glm_vec3_minv(triangleBounds[t].min, corners[2], triangleBounds[t].min);
+        glm_vec3_maxv(corners[0], corners[1], triangleBounds[t].max);
+        glm_vec3_maxv(triangleBounds[t].max, corners[2], triangleBounds[t].max);
+    }
+
+    bool built = bvh_build(&mesh->bvh, triangleBounds, triangleCount);
+    mem_free(triangleBounds);
+    if (!built) {
+        mesh_destroy(mesh);
+        return NULL;
+    }
+
+    HASH_ADD_KEYPTR(hh, meshes, mesh->path, strlen(mesh->path), mesh);
+    return mesh;
+}
+
+void mesh_cache_free(void) {
+    Mesh* mesh;
+    Mesh* next;
+    HASH_ITER(hh, meshes, mesh, next) {
+        HASH_DEL(meshes, mesh);
+        mesh_destroy(mesh);
+    }
+}
+
+void mesh_triangle(const Mesh* mesh, uint32_t triangle, vec3 out[3]) {
+    const uint32_t* index = &mesh->indices[triangle * 3];
+    glm_vec3_copy(mesh->positions[index[0]], out[0]);
+    glm_vec3_copy(mesh->positions[index[1]], out[1]);
+    glm_vec3_copy(mesh->positions[index[2]], out[2]);
+}
+
+// Möller-Trumbore, hitting either side
+static float raycast_triangle(uint32_t triangle, const vec3 origin, const vec3 direction, float maxDistance, void* data) {
+    const Mesh* mesh = (const Mesh*)data;
+    vec3 corners[3];
+    mesh_triangle(mesh, triangle, corners);
+
+    vec3 edge1, edge2, p, s, q;
+    glm_vec3_sub(corners[1], corners[0], edge1);
+    glm_vec3_sub(corners[2], corners[0], edge2);
+    glm_vec3_cross((float*)direction, edge2, p);
+
+    float determinant = glm_vec3_dot(edge1, p);
+    if (fabsf(determinant) < 1e-8f) return -1.0f;
+    float inverse = 1.0f / determinant;
+
+    glm_vec3_sub((float*)origin, corners[0], s);
+    float u = glm_vec3_dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f) return -1.0f;
+
+    glm_vec3_cross(s, edge1, q);
+    float v = glm_vec3_dot((float*)direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f) return -1.0f;
+
+    float t = glm_vec3_dot(edge2, q) * inverse;
+    return t <= maxDistance ? t : -1.0f;
+}
+
+bool mesh_raycast(const Mesh* mesh, const vec3 origin, const vec3 direction, float maxDistance,
+                  float* distance, vec3 normal) {
+    uint32_t triangle = bvh_raycast(&mesh->bvh, origin, direction, maxDistance, raycast_triangle, (void*)mesh, distance);
+    if (triangle == UINT32_MAX) return false;
+
+    if (normal) {
+        vec3 corners[3], edge1, edge2;
+        mesh_triangle(mesh, triangle, corners);
+        glm_vec3_sub(corners[1], corners[0], edge1);
+        glm_vec3_sub(corners[2], corners[0], edge2);
+        glm_vec3_crossn(edge1, edge2, normal);
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "common.h"
+#include "bvh.h"
+#include <uthash.h>
+
+// Triangle soup kept on the CPU for collision and picking, shared by every object loaded
+// from the same file
+typedef struct {
+    char*          path;
+    vec3*          positions;
+    uint32_t       vertexCount;
+    uint32_t*      indices;        // three per triangle
+    uint32_t       triangleCount;
+    AABB           bounds;
+    Bvh            bvh;            // over triangles
+    UT_hash_handle hh;
+} Mesh;
+
+const Mesh* mesh_find(const char* path);
+// Copies positions out of interleaved vertices (stride in floats) and builds the BVH
+const Mesh* mesh_create(const char* path, const float* vertices, uint32_t stride, uint32_t vertexCount,
+                        const uint32_t* indices, uint32_t indexCount);
+void mesh_cache_free(void);
+
+void mesh_triangle(const Mesh* mesh, uint32_t triangle, vec3 out[3]);
+// Nearest hit in mesh space. direction needn't be unit length; distance is in multiples of it.
+bool mesh_raycast(const Mesh* mesh, const vec3 origin, const vec3 direction, float maxDistance,
+                  float* distance, vec3 normal);
+
+#endif
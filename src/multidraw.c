@@ -0,0 +1,153 @@
+#include "multidraw.h"
+#include "geometry.h"
+#include "memstats.h"
+#include "renderstats.h"
+
+void multidraw_init(MultiDraw* multidraw) {
+    memset(multidraw, 0, sizeof(*multidraw));
+
+    // Indirect draws, base instance and shader storage all arrived in 4.3
+    if (!GLAD_GL_VERSION_4_3) {
+        printf("INFO: GL 4.3 unavailable, drawing objects one at a time\n");
+        return;
+    }
+
+    s_load(&multidraw->shader, "../src/shaders/vert_indirect.glsl", "../src/shaders/frag_indirect.glsl");
+    GLint linked = GL_FALSE;
+    glGetProgramiv(multidraw->shader.id, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        fprintf(stderr, "ERROR: Indirect shader failed, drawing objects one at a time\n");
+        s_destroy(&multidraw->shader);
+        return;
+    }
+
+    glGenBuffers(1, &multidraw->commandBuffer);
+    glGenBuffers(1, &multidraw->drawBuffer);
+    glGenBuffers(1, &multidraw->idBuffer);
+
+    s_use(&multidraw->shader);
+    s_setInt(&multidraw->shader, "texture1", 0);
+    multidraw->supported = true;
+}
+
+static bool reserve(MultiDraw* multidraw, uint32_t count) {
+    if (count <= multidraw->capacity) return true;
+
+    uint32_t capacity = multidraw->capacity ? multidraw->capacity : 256;
+    while (capacity < count) capacity *= 2;
+
+    DrawElementsIndirectCommand* commands = (DrawElementsIndirectCommand*)mem_realloc(MEMORY_RENDER, multidraw->commands, capacity * sizeof(DrawElementsIndirectCommand));
+    if (commands) multidraw->commands = commands;
+    IndirectDrawData* draws = (IndirectDrawData*)mem_realloc(MEMORY_RENDER, multidraw->draws, capacity * sizeof(IndirectDrawData));
+    if (draws) multidraw->draws = draws;
+    uint64_t* keys = (uint64_t*)mem_realloc(MEMORY_RENDER, multidraw->keys, capacity * sizeof(uint64_t));
+    if (keys) multidraw->keys = keys;
+    if (!commands || !draws || !keys) {
+        fprintf(stderr, "ERROR: Failed to grow indirect draws to %u\n", capacity);
+        return false;
+    }
+
+    uint32_t* ids = (uint32_t*)mem_alloc(MEMORY_RENDER, capacity * sizeof(uint32_t));
+    if (!ids) return false;
+    for (uint32_t i = 0; i < capacity; i++) ids[i] = i;
+    glBindBuffer(GL_ARRAY_BUFFER, multidraw->idBuffer);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(uint32_t), ids, GL_STATIC_DRAW);
+    mem_free(ids);
+
+    multidraw->capacity = capacity;
+    return true;
+}
+
+// The draw id rides along as an instanced attribute of each page's VAO
+static void bind_draw_ids(MultiDraw* multidraw, GLuint vao) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, multidraw->idBuffer);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(3);
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+void multidraw_submit(MultiDraw* multidraw, const RenderFrame* frame) {
+    int pageCount = geometry_page_count();
+    if (!multidraw->supported || pageCount == 0 || frame->itemCount == 0) return;
+    if (!reserve(multidraw, frame->itemCount)) return;
+
+    // Draws are grouped by geometry page, then by texture, since those are the state left
+    // between multi-draws; pageStart[page] is where a page's run of keys begins
+    uint32_t pageStart[GEOMETRY_MAX_PAGES + 1];
+    uint32_t count = 0;
+    for (int page = 0; page < pageCount; page++) {
+        GLuint vao = geometry_page_vao(page);
+        pageStart[page] = count;
+        for (uint32_t i = 0; i < frame->itemCount; i++) {
+            if (frame->items[i].renderable.VAO != vao) continue;
+            multidraw->keys[count++] = (uint64_t)frame->items[i].renderable.textureID << 32 | i;
+        }
+        qsort(&multidraw->keys[pageStart[page]], count - pageStart[page], sizeof(uint64_t), compare_keys);
+    }
+    pageStart[pageCount] = count;
+
+    uint32_t triangles = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const DrawItem* item = &frame->items[(uint32_t)multidraw->keys[i]];
+        const Renderable* renderable = &item->renderable;
+
+        DrawElementsIndirectCommand* command = &multidraw->commands[i];
+        command->count = renderable->indexCount > 0 ? renderable->indexCount : renderable->vertexCount;
+        command->instanceCount = 1;
+        command->firstIndex = renderable->firstIndex;
+        command->baseVertex = renderable->baseVertex;
+        command->baseInstance = i;
+        triangles += command->count / 3;
+
+        IndirectDrawData* draw = &multidraw->draws[i];
+        glm_mat4_copy((vec4*)item->model, draw->model);
+        glm_vec4((float*)renderable->color, renderable->textureScale, draw->colorScale);
+        draw->hasTexture = renderable->textureID != 0;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, multidraw->commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, count * sizeof(DrawElementsIndirectCommand), multidraw->commands, GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, multidraw->drawBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(IndirectDrawData), multidraw->draws, GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, multidraw->drawBuffer);
+
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int page = 0; page < pageCount; page++) {
+        uint32_t start = pageStart[page];
+        if (start == pageStart[page + 1]) continue;
+        bind_draw_ids(multidraw, geometry_page_vao(page));
+
+        while (start < pageStart[page + 1]) {
+            uint32_t texture = (uint32_t)(multidraw->keys[start] >> 32);
+            uint32_t end = start + 1;
+            while (end < pageStart[page + 1] && (uint32_t)(multidraw->keys[end] >> 32) == texture) end++;
+
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (const void*)(start * sizeof(DrawElementsIndirectCommand)), end - start, 0);
+            start = end;
+        }
+    }
+    render_stats_indirect(triangles);
+}
+
+void multidraw_free(MultiDraw* multidraw) {
+    if (multidraw->supported) {
+        s_destroy(&multidraw->shader);
+        glDeleteBuffers(1, &multidraw->commandBuffer);
+        glDeleteBuffers(1, &multidraw->drawBuffer);
+        glDeleteBuffers(1, &multidraw->idBuffer);
+    }
+    mem_free(multidraw->commands);
+    mem_free(multidraw->draws);
+    mem_free(multidraw->keys);
+    memset(multidraw, 0, sizeof(*multidraw));
+}
@@ -0,0 +1,45 @@
+#ifndef MULTIDRAW_H
+#define MULTIDRAW_H
+
+#include "common.h"
+#include "renderframe.h"
+#include "shader.h"
+
+// The record glMultiDrawElementsIndirect reads per draw
+typedef struct {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;    // the draw's slot in the draw data
+} DrawElementsIndirectCommand;
+
+// std430 layout of DrawData in vert_indirect.glsl
+typedef struct {
+    mat4    model;
+    vec4    colorScale;     // rgb color, texture scale in w
+    int32_t hasTexture;
+    int32_t padding[3];
+} IndirectDrawData;
+
+// Submits a whole frame's draws as one glMultiDrawElementsIndirect per geometry page and
+// texture. Needs GL 4.3; without it callers keep drawing object by object.
+typedef struct {
+    bool     supported;
+    Shader   shader;
+    GLuint   commandBuffer;
+    GLuint   drawBuffer;        // IndirectDrawData, shader storage binding 0
+    GLuint   idBuffer;          // 0, 1, 2, ... read per instance, so baseInstance picks the draw
+    uint32_t capacity;
+    DrawElementsIndirectCommand* commands;
+    IndirectDrawData*            draws;
+    uint64_t*                    keys;      // texture << 32 | item, sorted per page to group draws
+} MultiDraw;
+
+// Loads the indirect shader when the context is new enough
+void multidraw_init(MultiDraw* multidraw);
+// With multidraw->shader in use and its view, projection and light uniforms set
+void multidraw_submit(MultiDraw* multidraw, const RenderFrame* frame);
+void multidraw_free(MultiDraw* multidraw);
+
+#endif
@@ -20,10 +20,23 @@
 #include <stdio.h>
 #include <math.h>
 #include <memory.h>
+#include <string.h>
+#include <assert.h>
 
 #include "nanovg.h"
+#include "memstats.h"
+
+// Every system header the font and vector code pulls in is above, so the allocator can be
+// swapped under them: fontstash's atlas and glyph tables first, then NanoVG's own buffers
+#define malloc(size) mem_alloc(MEMORY_FONT, size)
+#define realloc(ptr, size) mem_realloc(MEMORY_FONT, ptr, size)
+#define free(ptr) mem_free(ptr)
 #define FONTSTASH_IMPLEMENTATION
 #include "fontstash.h"
+#undef malloc
+#undef realloc
+#define malloc(size) mem_alloc(MEMORY_UI, size)
+#define realloc(ptr, size) mem_realloc(MEMORY_UI, ptr, size)
 #include "stb_image.h"
 
 #ifdef _MSC_VER
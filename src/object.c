@@ -1,11 +1,18 @@
 #include "object.h"
 #include "physics.h"
 #include "primitives.h"
+#include "geometry.h"
+#include "lod.h"
+#include "memstats.h"
+#include "renderer.h"
+#include "renderstats.h"
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#define FAST_OBJ_REALLOC(ptr, size) mem_realloc(MEMORY_MESH, ptr, size)
+#define FAST_OBJ_FREE mem_free
 #define FAST_OBJ_IMPLEMENTATION
 #include <fast_obj.h>
 
@@ -14,16 +21,18 @@
 #define LOG_ERROR(format, ...) fprintf(stderr, "ERROR: " format "\n", ##__VA_ARGS__)
 #define LOG_INFO(format, ...) printf("INFO: " format "\n", ##__VA_ARGS__)
 
-GLuint load_texture(const char* path) {
-    GLuint textureID = 0;
-    glGenTextures(1, &textureID);
+typedef struct {
+    const unsigned char* data;
+    int    width, height, channels;
+    GLuint id;
+} TextureUpload;
 
-    if (textureID == 0) {
-        LOG_ERROR("Failed to generate texture ID for '%s'", path);
-        return 0;
-    }
+static void upload_texture(void* user) {
+    TextureUpload* upload = (TextureUpload*)user;
+    glGenTextures(1, &upload->id);
+    if (upload->id == 0) return;
 
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    glBindTexture(GL_TEXTURE_2D, upload->id);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -31,69 +40,132 @@ GLuint load_texture(const char* path) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    GLenum format = GL_RGB;
+    GLenum internalFormat = GL_RGB;
+    
+    if (upload->channels == 1) {
+        format = GL_RED;
+        internalFormat = GL_RED;
+    } else if (upload->channels == 4) {
+        format = GL_RGBA;
+        internalFormat = GL_RGBA;
+    }
+
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, upload->width, upload->height, 0, format, GL_UNSIGNED_BYTE, upload->data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+// Decodes on the calling thread; only the upload goes to wherever the GL context is
+GLuint load_texture(const char* path) {
     int width, height, nrChannels;
     stbi_set_flip_vertically_on_load(true);  // Add this line to flip textures vertically
     unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (data) {
-        GLenum format = GL_RGB;
-        GLenum internalFormat = GL_RGB;
-        
-        if (nrChannels == 1) {
-            format = GL_RED;
-            internalFormat = GL_RED;
-        } else if (nrChannels == 4) {
-            format = GL_RGBA;
-            internalFormat = GL_RGBA;
-        }
-
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        LOG_INFO("Texture loaded successfully: %s (%dx%d, %d channels)", path, width, height, nrChannels);
-    } else {
+    if (!data) {
         LOG_ERROR("Failed to load texture at '%s': %s", path, stbi_failure_reason());
-        glDeleteTextures(1, &textureID);
         return 0;
     }
 
+    TextureUpload upload = {data, width, height, nrChannels, 0};
+    renderer_call(upload_texture, &upload);
     stbi_image_free(data);
-    return textureID;
+
+    if (upload.id == 0) {
+        LOG_ERROR("Failed to generate texture ID for '%s'", path);
+        return 0;
+    }
+    LOG_INFO("Texture loaded successfully: %s (%dx%d, %d channels)", path, width, height, nrChannels);
+    return upload.id;
 }
 
-void object_init(Object* obj, float* vertices, int vertexCount, unsigned int* indices, int indexCount, vec3 color, const char* texturePath) {
-    glGenVertexArrays(1, &obj->VAO);
-    glGenBuffers(1, &obj->VBO);
+// Objects loading the same image share its texture, which is what lets static batching
+// merge them; textures live until texture_cache_free, like collision meshes
+typedef struct {
+    char*          path;
+    GLuint         id;
+    UT_hash_handle hh;
+} CachedTexture;
+
+static CachedTexture* textures = NULL;
+
+static GLuint texture_acquire(const char* path) {
+    CachedTexture* cached = NULL;
+    HASH_FIND_STR(textures, path, cached);
+    if (cached) return cached->id;
+
+    GLuint id = load_texture(path);
+    if (id == 0) return 0;
+
+    cached = (CachedTexture*)mem_alloc(MEMORY_TEXTURE, sizeof(CachedTexture));
+    size_t length = strlen(path);
+    char* key = (char*)mem_alloc(MEMORY_TEXTURE, length + 1);
+    if (!cached || !key) {
+        // Still usable, just not shared
+        mem_free(cached);
+        mem_free(key);
+        return id;
+    }
+    memcpy(key, path, length + 1);
+    cached->path = key;
+    cached->id = id;
+    HASH_ADD_KEYPTR(hh, textures, cached->path, length, cached);
+    return id;
+}
 
-    if (obj->VAO == 0 || obj->VBO == 0) {
-        LOG_ERROR("Failed to generate VAO or VBO");
-        return;
+static void free_textures(void* user) {
+    (void)user;
+    CachedTexture* cached;
+    CachedTexture* next;
+    HASH_ITER(hh, textures, cached, next) {
+        HASH_DEL(textures, cached);
+        glDeleteTextures(1, &cached->id);
+        mem_free(cached->path);
+        mem_free(cached);
     }
+}
 
-    glBindVertexArray(obj->VAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, obj->VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * 8 * sizeof(float), vertices, GL_STATIC_DRAW);
-
-    if (indices != NULL && indexCount > 0) {
-        glGenBuffers(1, &obj->EBO);
-        if (obj->EBO == 0) {
-            LOG_ERROR("Failed to generate EBO");
-            return;
-        }
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj->EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+void texture_cache_free(void) {
+    renderer_call(free_textures, NULL);
+}
+
+static bool headless = false;
+
+void object_set_headless(bool enabled) {
+    headless = enabled;
+}
+
+// Simplified levels follow the full index list in the same range, sharing its vertices
+static bool upload_geometry(Object* obj, float* vertices, int vertexCount, unsigned int* indices, int indexCount) {
+    uint32_t* chain = lod_build(vertices, vertexCount, indices, indexCount, obj->lodIndexCounts, &obj->lodCount);
+    uint32_t chainCount = 0;
+    for (uint8_t level = 0; level < obj->lodCount; level++) {
+        chainCount += obj->lodIndexCounts[level];
     }
 
-    // position attribute (3 floats)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    GeometryRange range;
+    bool added = chain ? geometry_add(vertices, vertexCount, chain, chainCount, &range)
+                       : geometry_add(vertices, vertexCount, indices, indexCount, &range);
+    mem_free(chain);
+    if (!added) {
+        LOG_ERROR("Failed to upload %d vertices to the shared geometry", vertexCount);
+        return false;
+    }
 
-    // normal attribute (3 floats)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    obj->VAO = range.VAO;
+    obj->firstIndex = range.firstIndex;
+    obj->baseVertex = range.baseVertex;
+    return true;
+}
 
-    // texture coordinate attribute (2 floats)
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+void object_init(Object* obj, float* vertices, int vertexCount, unsigned int* indices, int indexCount, vec3 color, const char* texturePath) {
+    obj->VAO = 0;
+    obj->firstIndex = 0;
+    obj->baseVertex = 0;
+    memset(obj->lodIndexCounts, 0, sizeof(obj->lodIndexCounts));
+    obj->lodIndexCounts[0] = indexCount;
+    obj->lodCount = 1;
+    if (!headless && !upload_geometry(obj, vertices, vertexCount, indices, indexCount)) {
+        return;
+    }
 
     obj->vertexCount = vertexCount;
     obj->indexCount = indexCount;
@@ -106,8 +178,8 @@ void object_init(Object* obj, float* vertices, int vertexCount, unsigned int* in
     glm_vec3_copy(color, obj->color);
     glm_mat4_identity(obj->model);
 
-    if (texturePath != NULL) {
-        obj->textureID = load_texture(texturePath);
+    if (texturePath != NULL && !headless) {
+        obj->textureID = texture_acquire(texturePath);
         if (obj->textureID == 0) {
             LOG_ERROR("Failed to load texture '%s'", texturePath);
         }
@@ -116,7 +188,19 @@ void object_init(Object* obj, float* vertices, int vertexCount, unsigned int* in
     }
 
     glm_vec3_zero(obj->velocity);
-    update_aabb(obj, &obj->scale, &obj->aabb);
+
+    glm_vec3_fill(obj->bounds.min, FLT_MAX);
+    glm_vec3_fill(obj->bounds.max, -FLT_MAX);
+    for (int i = 0; i < vertexCount; i++) {
+        glm_vec3_minv(obj->bounds.min, &vertices[i * 8], obj->bounds.min);
+        glm_vec3_maxv(obj->bounds.max, &vertices[i * 8], obj->bounds.max);
+    }
+    obj->aabb = obj->bounds;
+    obj->mesh = NULL;
+    obj->bodyType = BODY_DYNAMIC;
+    obj->category = PHYSICS_LAYER_DEFAULT;
+    obj->mask = PHYSICS_LAYER_ALL;
+    obj->occluder = false;
 }
 
 void object_create_cube(Object* obj, vec3 color, const char* texturePath) {
@@ -124,7 +208,7 @@ void object_create_cube(Object* obj, vec3 color, const char* texturePath) {
     float* vertices = generate_cube(&vertexCount);
     
     // Convert the 5-component vertices to 8-component vertices (add normals)
-    float* newVertices = (float*)malloc(vertexCount * 8 * sizeof(float));
+    float* newVertices = (float*)mem_alloc(MEMORY_MESH, vertexCount * 8 * sizeof(float));
     for (int i = 0; i < vertexCount; i++) {
         // Position
         newVertices[i * 8 + 0] = vertices[i * 5 + 0];
@@ -142,8 +226,8 @@ void object_create_cube(Object* obj, vec3 color, const char* texturePath) {
     }
     
     object_init(obj, newVertices, vertexCount, NULL, 0, color, texturePath);
-    free(vertices);
-    free(newVertices);
+    mem_free(vertices);
+    mem_free(newVertices);
 }
 
 void object_create_plane(Object* obj, vec3 color, const char* texturePath) {
@@ -151,7 +235,7 @@ void object_create_plane(Object* obj, vec3 color, const char* texturePath) {
     float* vertices = generate_plane(&vertexCount);
     
     // Convert the 5-component vertices to 8-component vertices (add normals)
-    float* newVertices = (float*)malloc(vertexCount * 8 * sizeof(float));
+    float* newVertices = (float*)mem_alloc(MEMORY_MESH, vertexCount * 8 * sizeof(float));
     for (int i = 0; i < vertexCount; i++) {
         // Position
         newVertices[i * 8 + 0] = vertices[i * 5 + 0];
@@ -169,17 +253,25 @@ void object_create_plane(Object* obj, vec3 color, const char* texturePath) {
     }
     
     object_init(obj, newVertices, vertexCount, NULL, 0, color, texturePath);
-    free(vertices);
-    free(newVertices);
+    mem_free(vertices);
+    mem_free(newVertices);
+}
+
+static void compose_model(vec3 position, vec3 rotation, vec3 scale, mat4 model) {
+    glm_mat4_identity(model);
+    glm_translate(model, position);
+    glm_rotate(model, rotation[0], (vec3){1.0f, 0.0f, 0.0f});
+    glm_rotate(model, rotation[1], (vec3){0.0f, 1.0f, 0.0f});
+    glm_rotate(model, rotation[2], (vec3){0.0f, 1.0f, 1.0f});
+    glm_scale(model, scale);
 }
 
 void object_update(Object* obj) {
-    glm_mat4_identity(obj->model);
-    glm_translate(obj->model, obj->position);
-    glm_rotate(obj->model, obj->rotation[0], (vec3){1.0f, 0.0f, 0.0f});
-    glm_rotate(obj->model, obj->rotation[1], (vec3){0.0f, 1.0f, 0.0f});
-    glm_rotate(obj->model, obj->rotation[2], (vec3){0.0f, 1.0f, 1.0f});
-    glm_scale(obj->model, obj->scale);
+    compose_model(obj->position, obj->rotation, obj->scale, obj->model);
+}
+
+void transform_update(Transform* transform) {
+    compose_model(transform->position, transform->rotation, transform->scale, transform->model);
 }
 
 void object_draw_aabb(Object* obj, GLuint shader) {
@@ -192,15 +284,16 @@ void object_draw_aabb(Object* obj, GLuint shader) {
     glBindVertexArray(VAO);
     
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    // Mesh-space bounds drawn with the model matrix, i.e. the oriented box physics uses
     vec3 vertices[8] = {
-        {obj->aabb.min[0], obj->aabb.min[1], obj->aabb.min[2]},
-        {obj->aabb.max[0], obj->aabb.min[1], obj->aabb.min[2]},
-        {obj->aabb.max[0], obj->aabb.max[1], obj->aabb.min[2]},
-        {obj->aabb.min[0], obj->aabb.max[1], obj->aabb.min[2]},
-        {obj->aabb.min[0], obj->aabb.min[1], obj->aabb.max[2]},
-        {obj->aabb.max[0], obj->aabb.min[1], obj->aabb.max[2]},
-        {obj->aabb.max[0], obj->aabb.max[1], obj->aabb.max[2]},
-        {obj->aabb.min[0], obj->aabb.max[1], obj->aabb.max[2]}
+        {obj->bounds.min[0], obj->bounds.min[1], obj->bounds.min[2]},
+        {obj->bounds.max[0], obj->bounds.min[1], obj->bounds.min[2]},
+        {obj->bounds.max[0], obj->bounds.max[1], obj->bounds.min[2]},
+        {obj->bounds.min[0], obj->bounds.max[1], obj->bounds.min[2]},
+        {obj->bounds.min[0], obj->bounds.min[1], obj->bounds.max[2]},
+        {obj->bounds.max[0], obj->bounds.min[1], obj->bounds.max[2]},
+        {obj->bounds.max[0], obj->bounds.max[1], obj->bounds.max[2]},
+        {obj->bounds.min[0], obj->bounds.max[1], obj->bounds.max[2]}
     };
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
     
@@ -228,11 +321,11 @@ void object_draw_aabb(Object* obj, GLuint shader) {
     glDeleteBuffers(1, &EBO);
 }
 
-void object_load_from_obj(Object* obj, const char* objFilePath, vec3 color, const char* texturePath) {
+bool object_load_from_obj(Object* obj, const char* objFilePath, vec3 color, const char* texturePath) {
     fastObjMesh* mesh = fast_obj_read(objFilePath);
     if (!mesh) {
         LOG_ERROR("Failed to load OBJ file: %s", objFilePath);
-        return;
+        return false;
     }
 
     vec3 minBounds = {FLT_MAX, FLT_MAX, FLT_MAX};
@@ -248,15 +341,15 @@ void object_load_from_obj(Object* obj, const char* objFilePath, vec3 color, cons
     }
 
     // Allocate memory for vertices and indices
-    float* vertices = (float*)malloc(vertexCount * 8 * sizeof(float));
-    unsigned int* indices = (unsigned int*)malloc(indexCount * sizeof(unsigned int));
+    float* vertices = (float*)mem_alloc(MEMORY_MESH, vertexCount * 8 * sizeof(float));
+    unsigned int* indices = (unsigned int*)mem_alloc(MEMORY_MESH, indexCount * sizeof(unsigned int));
 
     if (!vertices || !indices) {
         LOG_ERROR("Failed to allocate memory for mesh data");
         fast_obj_destroy(mesh);
-        free(vertices);
-        free(indices);
-        return;
+        mem_free(vertices);
+        mem_free(indices);
+        return false;
     }
 
     // Fill the vertices and indices arrays
@@ -333,20 +426,51 @@ void object_load_from_obj(Object* obj, const char* objFilePath, vec3 color, cons
 
     object_init(obj, vertices, vertexCount, indices, indexCount, color, texturePath);
 
-    free(vertices);
-    free(indices);
+    obj->mesh = mesh_find(objFilePath);
+    if (!obj->mesh) {
+        obj->mesh = mesh_create(objFilePath, vertices, 8, vertexCount, indices, indexCount);
+    }
+
+    mem_free(vertices);
+    mem_free(indices);
     fast_obj_destroy(mesh);
 
     LOG_INFO("Successfully loaded OBJ file: %s (Vertices: %d, Indices: %d)", objFilePath, vertexCount, indexCount);
+    return true;
+}
+
+static Renderable object_renderable(const Object* obj) {
+    Renderable renderable;
+    renderable.VAO = obj->VAO;
+    renderable.firstIndex = obj->firstIndex;
+    renderable.baseVertex = obj->baseVertex;
+    renderable.vertexCount = obj->vertexCount;
+    renderable.indexCount = obj->indexCount;
+    memcpy(renderable.lodIndexCounts, obj->lodIndexCounts, sizeof(renderable.lodIndexCounts));
+    renderable.lodCount = obj->lodCount;
+    renderable.lod = 0;
+    glm_vec3_copy((float*)obj->color, renderable.color);
+    renderable.textureID = obj->textureID;
+    renderable.textureScale = obj->textureScale;
+    renderable.batched = false;
+    renderable.batch = 0;
+    renderable.batchPart = 0;
+    renderable.occluder = obj->occluder;
+    return renderable;
 }
 
 void object_draw(Object* obj, GLuint shader) {
+    Renderable renderable = object_renderable(obj);
+    renderable_draw(&renderable, obj->model, shader);
+}
+
+void renderable_draw(const Renderable* renderable, mat4 model, GLuint shader) {
     glUseProgram(shader);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, obj->textureID);
+    glBindTexture(GL_TEXTURE_2D, renderable->textureID);
 
-    glUniform1f(glGetUniformLocation(shader, "textureScale"), obj->textureScale);
+    glUniform1f(glGetUniformLocation(shader, "textureScale"), renderable->textureScale);
 
     GLint texLoc = glGetUniformLocation(shader, "texture1");
     if (texLoc == -1) {
@@ -359,34 +483,150 @@ void object_draw(Object* obj, GLuint shader) {
     if (hasTextureLoc == -1) {
         LOG_ERROR("Failed to find uniform 'hasTexture'");
     } else {
-        glUniform1i(hasTextureLoc, obj->textureID != 0);
+        glUniform1i(hasTextureLoc, renderable->textureID != 0);
     }
 
     GLint modelLoc = glGetUniformLocation(shader, "model");
     if (modelLoc == -1) {
         LOG_ERROR("Failed to find uniform 'model'");
     } else {
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float*)obj->model);
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, (float*)model);
     }
 
     GLint colorLoc = glGetUniformLocation(shader, "color");
     if (colorLoc == -1) {
         LOG_ERROR("Failed to find uniform 'color'");
     } else {
-        glUniform3fv(colorLoc, 1, obj->color);
+        glUniform3fv(colorLoc, 1, renderable->color);
     }
 
-    glBindVertexArray(obj->VAO);
-    if (obj->indexCount > 0) {
-        glDrawElements(GL_TRIANGLES, obj->indexCount, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(renderable->VAO);
+    if (renderable->indexCount > 0) {
+        glDrawElementsBaseVertex(GL_TRIANGLES, renderable->indexCount, GL_UNSIGNED_INT,
+                                 (void*)(renderable->firstIndex * sizeof(uint32_t)), renderable->baseVertex);
     } else {
-        glDrawArrays(GL_TRIANGLES, 0, obj->vertexCount);
+        glDrawArrays(GL_TRIANGLES, renderable->baseVertex, renderable->vertexCount);
     }
 }
 
 void object_cleanup(Object* obj) {
-    glDeleteVertexArrays(1, &obj->VAO);
-    glDeleteBuffers(1, &obj->VBO);
-    glDeleteBuffers(1, &obj->EBO);
-    glDeleteTextures(1, &obj->textureID);
-}
\ No newline at end of file
+    Renderable renderable = object_renderable(obj);
+    renderable_cleanup(&renderable);
+}
+
+// Textures are shared through the cache, so only this owner's reference to the geometry goes
+void renderable_cleanup(Renderable* renderable) {
+    // Batched renderables gave their geometry to the batch when it was built
+    if (renderable->VAO == 0 || renderable->batched) return;
+
+    GeometryRange range = renderable_range(renderable);
+    geometry_release(&range);
+    renderable->VAO = 0;
+}
+
+GeometryRange renderable_range(const Renderable* renderable) {
+    GeometryRange range;
+    range.VAO = renderable->VAO;
+    range.firstIndex = renderable->firstIndex;
+    range.baseVertex = renderable->baseVertex;
+    range.vertexCount = (uint32_t)renderable->vertexCount;
+    // Index-less meshes were given a sequential list of the same length
+    range.indexCount = (uint32_t)(renderable->indexCount > 0 ? renderable->indexCount : renderable->vertexCount);
+    for (uint8_t level = 1; level < renderable->lodCount; level++) {
+        range.indexCount += renderable->lodIndexCounts[level];
+    }
+    return range;
+}
+
+Entity object_spawn(World* world, const Object* obj) {
+    ComponentMask mask = COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BODY) | COMPONENT_BIT(COMPONENT_COLLIDER);
+    // Headless objects keep their Renderable, so entities land in the same archetypes and
+    // simulate identically with or without a window
+    if (obj->vertexCount > 0) {
+        mask |= COMPONENT_BIT(COMPONENT_RENDERABLE);
+    }
+
+    Entity entity = ecs_create(world, mask);
+    if (entity.generation == 0) {
+        return entity;
+    }
+
+    Transform* transform = (Transform*)ecs_get(world, entity, COMPONENT_TRANSFORM);
+    glm_vec3_copy((float*)obj->position, transform->position);
+    glm_vec3_copy((float*)obj->rotation, transform->rotation);
+    glm_vec3_copy((float*)obj->scale, transform->scale);
+    transform_update(transform);
+
+    Body* body = (Body*)ecs_get(world, entity, COMPONENT_BODY);
+    body_init(body, obj->bodyType, 1.0f);
+    glm_vec3_copy((float*)obj->velocity, body->velocity);
+
+    Collider* collider = (Collider*)ecs_get(world, entity, COMPONENT_COLLIDER);
+    collider->bounds = obj->bounds;
+    collider->mesh = obj->mesh;
+    collider->category = obj->category;
+    collider->mask = obj->mask;
+    collider_update(collider, transform->model);
+
+    Renderable* renderable = (Renderable*)ecs_get(world, entity, COMPONENT_RENDERABLE);
+    if (renderable) {
+        *renderable = object_renderable(obj);
+        // Every entity spawned from a template shares its geometry and releases it on its own
+        if (renderable->VAO != 0) {
+            GeometryRange range = renderable_range(renderable);
+            geometry_retain(&range);
+        }
+    }
+
+    return entity;
+}
+
+bool object_from_entity(World* world, Entity entity, Object* obj) {
+    if (!ecs_is_alive(world, entity)) {
+        return false;
+    }
+
+    memset(obj, 0, sizeof(*obj));
+    glm_vec3_one(obj->scale);
+    glm_mat4_identity(obj->model);
+
+    Transform* transform = (Transform*)ecs_get(world, entity, COMPONENT_TRANSFORM);
+    if (transform) {
+        glm_vec3_copy(transform->position, obj->position);
+        glm_vec3_copy(transform->rotation, obj->rotation);
+        glm_vec3_copy(transform->scale, obj->scale);
+        glm_mat4_copy(transform->model, obj->model);
+    }
+
+    Body* body = (Body*)ecs_get(world, entity, COMPONENT_BODY);
+    if (body) {
+        glm_vec3_copy(body->velocity, obj->velocity);
+        obj->bodyType = (BodyType)body->type;
+    }
+
+    Collider* collider = (Collider*)ecs_get(world, entity, COMPONENT_COLLIDER);
+    if (collider) {
+        obj->bounds = collider->bounds;
+        obj->aabb = collider->aabb;
+        obj->mesh = collider->mesh;
+        obj->category = collider->category;
+        obj->mask = collider->mask;
+    }
+
+    Renderable* renderable = (Renderable*)ecs_get(world, entity, COMPONENT_RENDERABLE);
+    if (renderable) {
+        obj->VAO = renderable->VAO;
+        obj->firstIndex = renderable->firstIndex;
+        obj->baseVertex = renderable->baseVertex;
+        obj->vertexCount = renderable->vertexCount;
+        obj->indexCount = renderable->indexCount;
+        memcpy(obj->lodIndexCounts, renderable->lodIndexCounts, sizeof(obj->lodIndexCounts));
+        obj->lodCount = renderable->lodCount;
+        glm_vec3_copy(renderable->color, obj->color);
+        obj->textureID = renderable->textureID;
+        obj->textureScale = renderable->textureScale;
+        obj->occluder = renderable->occluder;
+    }
+
+    return true;
+}
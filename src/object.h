@@ -2,30 +2,61 @@
 #define OBJECT_H
 
 #include "common.h"
+#include "ecs.h"
+#include "geometry.h"
+#include "mesh.h"
 
 typedef struct {
-    unsigned int VAO, VBO, EBO;
+    unsigned int VAO;
+    uint32_t firstIndex;
+    int32_t baseVertex;
     int vertexCount;
     int indexCount;
+    uint32_t lodIndexCounts[RENDERABLE_LODS];
+    uint8_t lodCount;
     vec3 position;
     vec3 rotation;
     vec3 scale;
     vec3 color;
     vec3 velocity;
     mat4 model;
+    AABB bounds;    // mesh space
     AABB aabb;
+    const Mesh* mesh; // loaded models only
+    BodyType bodyType;
+    uint32_t category;
+    uint32_t mask;
     
     GLuint textureID;
     float textureScale;
+    bool occluder;  // hides objects behind it from the renderer; best for big, simple shapes
 } Object;
 
+// Without a GL context (headless runs) objects keep only their CPU-side data
+void object_set_headless(bool enabled);
 void object_init(Object* obj, float* vertices, int vertexCount, unsigned int* indices, int indexCount, vec3 color, const char* texture);
 void object_create_cube(Object* obj, vec3 color, const char* texturePath);
 void object_create_plane(Object* obj, vec3 color, const char* texturePath);
-void object_load_from_obj(Object* obj, const char* filePath, vec3 color, const char* texturePath);
+// Leaves obj untouched and returns false when the file can't be read
+bool object_load_from_obj(Object* obj, const char* filePath, vec3 color, const char* texturePath);
 void object_update(Object* obj);
 void object_draw(Object* obj, GLuint shader);
 void object_draw_aabb(Object* obj, GLuint shader);
+// Drops the object's reference to its geometry; entities spawned from it keep their own
 void object_cleanup(Object* obj);
+// Deletes the textures objects have loaded
+void texture_cache_free(void);
+
+// Compatibility layer between Object and the component storage in World. Spawned entities
+// take their own reference to the object's geometry; objects read back from an entity don't,
+// so they mustn't be cleaned up.
+Entity object_spawn(World* world, const Object* obj);
+bool object_from_entity(World* world, Entity entity, Object* obj);
+
+void transform_update(Transform* transform);
+void renderable_draw(const Renderable* renderable, mat4 model, GLuint shader);
+void renderable_cleanup(Renderable* renderable);
+// Where the renderable's mesh sits in the shared geometry
+GeometryRange renderable_range(const Renderable* renderable);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "occlusion.h"
+#include "collision.h"
+#include "jobs.h"
+#include "memstats.h"
+#include "profiler.h"
+#include <float.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_SSE2
+#endif
+
+#define OCCLUSION_BANDS (OCCLUSION_HEIGHT / OCCLUSION_BAND_ROWS)
+
+// Two triangles per face of a box whose corner i is offset along axis k when bit k is set
+static const uint8_t boxTriangles[36] = {
+    0, 2, 6, 0, 6, 4,   1, 3, 7, 1, 7, 5,
+    0, 1, 5, 0, 5, 4,   2, 3, 7, 2, 7, 6,
+    0, 1, 3, 0, 3, 2,   4, 5, 7, 4, 7, 6,
+};
+
+// Unlike fminf and fmaxf these compile to single instructions, for the hot loops
+static inline float min_float(float a, float b) { return a < b ? a : b; }
+static inline float max_float(float a, float b) { return a > b ? a : b; }
+
+void occlusion_init(Occlusion* occlusion) {
+    memset(occlusion, 0, sizeof(*occlusion));
+
+    size_t total = 0;
+    for (int level = 0; level < OCCLUSION_LEVELS; level++) {
+        total += (size_t)(OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level);
+    }
+    float* depth = (float*)mem_alloc(MEMORY_RENDER, total * sizeof(float));
+    if (!depth) {
+        fprintf(stderr, "ERROR: Failed to allocate the occlusion buffer, occlusion culling is off\n");
+        return;
+    }
+
+    for (int level = 0; level < OCCLUSION_LEVELS; level++) {
+        occlusion->levels[level] = depth;
+        depth += (OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level);
+    }
+    occlusion->enabled = true;
+}
+
+void occlusion_free(Occlusion* occlusion) {
+    mem_free(occlusion->levels[0]);
+    mem_free(occlusion->triangles);
+    mem_free(occlusion->clip);
+    memset(occlusion, 0, sizeof(*occlusion));
+}
+
+void occlusion_begin(Occlusion* occlusion, mat4 viewProjection) {
+    glm_mat4_copy(viewProjection, occlusion->viewProjection);
+    occlusion->triangleCount = 0;
+    occlusion->hidden = 0;
+    occlusion->active = false;
+}
+
+// Takes a screen space triangle, in either winding
+static void push_triangle(Occlusion* occlusion, const float* a, const float* b, const float* c) {
+    float area = (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+    if (fabsf(area) < 1e-8f) return;
+
+    // Counter-clockwise, so the inside is left of every edge
+    const float* v[3] = {a, b, c};
+    if (area < 0.0f) {
+        v[1] = c;
+        v[2] = b;
+        area = -area;
+    }
+
+    // Pixels whose centres fall inside the triangle's bounds
+    float minX = fminf(v[0][0], fminf(v[1][0], v[2][0]));
+    float maxX = fmaxf(v[0][0], fmaxf(v[1][0], v[2][0]));
+    float minY = fminf(v[0][1], fminf(v[1][1], v[2][1]));
+    float maxY = fmaxf(v[0][1], fmaxf(v[1][1], v[2][1]));
+    int x0 = (int)fmaxf(ceilf(minX - 0.5f), 0.0f);
+    int y0 = (int)fmaxf(ceilf(minY - 0.5f), 0.0f);
+    int x1 = (int)fminf(floorf(maxX - 0.5f), OCCLUSION_WIDTH - 1);
+    int y1 = (int)fminf(floorf(maxY - 0.5f), OCCLUSION_HEIGHT - 1);
+    if (x0 > x1 || y0 > y1) return;
+
+    if (occlusion->triangleCount == occlusion->triangleCapacity) {
+        uint32_t capacity = occlusion->triangleCapacity ? occlusion->triangleCapacity * 2 : 256;
+        OcclusionTriangle* grown = (OcclusionTriangle*)mem_realloc(MEMORY_RENDER, occlusion->triangles, capacity * sizeof(OcclusionTriangle));
+        if (!grown) {
+            fprintf(stderr, "ERROR: Failed to grow the occluder triangles to %u\n", capacity);
+            return;
+        }
+        occlusion->triangles = grown;
+        occlusion->triangleCapacity = capacity;
+    }
+
+    OcclusionTriangle* triangle = &occlusion->triangles[occlusion->triangleCount++];
+    for (int e = 0; e < 3; e++) {
+        const float* from = v[e];
+        const float* to = v[(e + 1) % 3];
+        triangle->edges[e][0] = from[1] - to[1];
+        triangle->edges[e][1] = to[0] - from[0];
+        triangle->edges[e][2] = -(triangle->edges[e][0] * from[0] + triangle->edges[e][1] * from[1]);
+    }
+
+    float dx1 = v[1][0] - v[0][0], dy1 = v[1][1] - v[0][1], dz1 = v[1][2] - v[0][2];
+    float dx2 = v[2][0] - v[0][0], dy2 = v[2][1] - v[0][1], dz2 = v[2][2] - v[0][2];
+    triangle->depth[0] = (dz1 * dy2 - dz2 * dy1) / area;
+    triangle->depth[1] = (dx1 * dz2 - dx2 * dz1) / area;
+    triangle->depth[2] = v[0][2] - triangle->depth[0] * v[0][0] - triangle->depth[1] * v[0][1];
+
+    triangle->minX = x0;
+    triangle->minY = y0;
+    triangle->maxX = x1;
+    triangle->maxY = y1;
+}
+
+// Clips a clip space triangle to the near plane and queues what is left, as one or two triangles
+static void add_clip_triangle(Occlusion* occlusion, const float* a, const float* b, const float* c) {
+    const float* corners[3] = {a, b, c};
+
+    for (int axis = 0; axis < 2; axis++) {
+        if (a[axis] > a[3] && b[axis] > b[3] && c[axis] > c[3]) return;
+        if (a[axis] < -a[3] && b[axis] < -b[3] && c[axis] < -c[3]) return;
+    }
+
+    vec4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        const float* from = corners[i];
+        const float* to = corners[(i + 1) % 3];
+        float fromDistance = from[2] + from[3];
+        float toDistance = to[2] + to[3];
+        if (fromDistance >= 0.0f) glm_vec4_copy((float*)from, polygon[count++]);
+        if ((fromDistance >= 0.0f) != (toDistance >= 0.0f)) {
+            glm_vec4_lerp((float*)from, (float*)to, fromDistance / (fromDistance - toDistance), polygon[count++]);
+        }
+    }
+    if (count < 3) return;
+
+    vec3 screen[4];
+    for (int i = 0; i < count; i++) {
+        float invW = 1.0f / polygon[i][3];
+        screen[i][0] = (polygon[i][0] * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        screen[i][1] = (polygon[i][1] * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+        screen[i][2] = polygon[i][2] * invW * 0.5f + 0.5f;
+    }
+    for (int i = 1; i + 1 < count; i++) {
+        push_triangle(occlusion, screen[0], screen[i], screen[i + 1]);
+    }
+}
+
+static bool reserve_clip(Occlusion* occlusion, uint32_t count) {
+    if (count <= occlusion->clipCapacity) return true;
+
+    vec4* grown = (vec4*)mem_realloc(MEMORY_RENDER, occlusion->clip, count * sizeof(vec4));
+    if (!grown) {
+        fprintf(stderr, "ERROR: Failed to allocate %u occluder vertices\n", count);
+        return false;
+    }
+    occlusion->clip = grown;
+    occlusion->clipCapacity = count;
+    return true;
+}
+
+void occlusion_add_mesh(Occlusion* occlusion, const Mesh* mesh, mat4 model) {
+    if (!reserve_clip(occlusion, mesh->vertexCount)) return;
+
+    mat4 transform;
+    glm_mat4_mul(occlusion->viewProjection, model, transform);
+    for (uint32_t i = 0; i < mesh->vertexCount; i++) {
+        glm_mat4_mulv(transform, (vec4){mesh->positions[i][0], mesh->positions[i][1], mesh->positions[i][2], 1.0f}, occlusion->clip[i]);
+    }
+
+    for (uint32_t t = 0; t < mesh->triangleCount; t++) {
+        const uint32_t* index = &mesh->indices[t * 3];
+        add_clip_triangle(occlusion, occlusion->clip[index[0]], occlusion->clip[index[1]], occlusion->clip[index[2]]);
+    }
+}
+
+void occlusion_add_box(Occlusion* occlusion, const OBB* box) {
+    vec3 corners[8];
+    vec4 clip[8];
+    obb_vertices(box, corners);
+    for (int i = 0; i < 8; i++) {
+        glm_mat4_mulv(occlusion->viewProjection, (vec4){corners[i][0], corners[i][1], corners[i][2], 1.0f}, clip[i]);
+    }
+
+    for (int t = 0; t < 36; t += 3) {
+        add_clip_triangle(occlusion, clip[boxTriangles[t]], clip[boxTriangles[t + 1]], clip[boxTriangles[t + 2]]);
+    }
+}
+
+// Keeps the nearest depth over the triangle's pixels in rows y0 to y1
+static void rasterize_rows(float* depth, const OcclusionTriangle* triangle, int y0, int y1) {
+    const float (*edges)[3] = triangle->edges;
+    const float* plane = triangle->depth;
+
+#ifdef OCCLUSION_SSE2
+    // Four pixels at a time from a multiple of four, which the buffer width also is
+    int x0 = triangle->minX & ~3;
+    __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 px = _mm_add_ps(_mm_set1_ps((float)x0), offsets);
+    __m128 zero = _mm_setzero_ps();
+
+    for (int y = y0; y <= y1; y++) {
+        float* row = &depth[y * OCCLUSION_WIDTH];
+        float py = y + 0.5f;
+
+        __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[0][0]), px), _mm_set1_ps(edges[0][1] * py + edges[0][2]));
+        __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[1][0]), px), _mm_set1_ps(edges[1][1] * py + edges[1][2]));
+        __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges[2][0]), px), _mm_set1_ps(edges[2][1] * py + edges[2][2]));
+        __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), px), _mm_set1_ps(plane[1] * py + plane[2]));
+        __m128 step0 = _mm_set1_ps(4.0f * edges[0][0]);
+        __m128 step1 = _mm_set1_ps(4.0f * edges[1][0]);
+        __m128 step2 = _mm_set1_ps(4.0f * edges[2][0]);
+        __m128 stepZ = _mm_set1_ps(4.0f * plane[0]);
+
+        for (int x = x0; x <= triangle->maxX; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if (_mm_movemask_ps(inside)) {
+                __m128 old = _mm_loadu_ps(&row[x]);
+                __m128 nearest = _mm_min_ps(old, z);
+                _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+            }
+            e0 = _mm_add_ps(e0, step0);
+            e1 = _mm_add_ps(e1, step1);
+            e2 = _mm_add_ps(e2, step2);
+            z = _mm_add_ps(z, stepZ);
+        }
+    }
+#else
+    for (int y = y0; y <= y1; y++) {
+        float* row = &depth[y * OCCLUSION_WIDTH];
+        float py = y + 0.5f;
+
+        for (int x = triangle->minX; x <= triangle->maxX; x++) {
+            float px = x + 0.5f;
+            if (edges[0][0] * px + edges[0][1] * py + edges[0][2] < 0.0f) continue;
+            if (edges[1][0] * px + edges[1][1] * py + edges[1][2] < 0.0f) continue;
+            if (edges[2][0] * px + edges[2][1] * py + edges[2][2] < 0.0f) continue;
+
+            float z = plane[0] * px + plane[1] * py + plane[2];
+            if (z < row[x]) row[x] = z;
+        }
+    }
+#endif
+}
+
+// Each band owns its rows of the buffer, so bands need no locking
+static void rasterize_bands(int start, int end, void* data) {
+    Occlusion* occlusion = (Occlusion*)data;
+    float* depth = occlusion->levels[0];
+
+    for (int band = start; band < end; band++) {
+        int y0 = band * OCCLUSION_BAND_ROWS;
+        int y1 = y0 + OCCLUSION_BAND_ROWS - 1;
+        for (int i = y0 * OCCLUSION_WIDTH; i < (y1 + 1) * OCCLUSION_WIDTH; i++) depth[i] = 1.0f;
+
+        for (uint32_t t = 0; t < occlusion->triangleCount; t++) {
+            const OcclusionTriangle* triangle = &occlusion->triangles[t];
+            if (triangle->maxY < y0 || triangle->minY > y1) continue;
+            rasterize_rows(depth, triangle, triangle->minY > y0 ? triangle->minY : y0, triangle->maxY < y1 ? triangle->maxY : y1);
+        }
+    }
+}
+
+// Each texel of a level holds the farthest of the four below it
+static void build_levels(Occlusion* occlusion) {
+    for (int level = 1; level < OCCLUSION_LEVELS; level++) {
+        const float* source = occlusion->levels[level - 1];
+        float* target = occlusion->levels[level];
+        int sourceWidth = OCCLUSION_WIDTH >> (level - 1);
+        int width = OCCLUSION_WIDTH >> level;
+        int height = OCCLUSION_HEIGHT >> level;
+
+        for (int y = 0; y < height; y++) {
+            const float* below = &source[2 * y * sourceWidth];
+            const float* above = below + sourceWidth;
+            int x = 0;
+#ifdef OCCLUSION_SSE2
+            // Eight texels across two rows down to four
+            for (; x + 4 <= width; x += 4) {
+                __m128 left = _mm_max_ps(_mm_loadu_ps(&below[2 * x]), _mm_loadu_ps(&above[2 * x]));
+                __m128 right = _mm_max_ps(_mm_loadu_ps(&below[2 * x + 4]), _mm_loadu_ps(&above[2 * x + 4]));
+                __m128 even = _mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 odd = _mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(&target[y * width + x], _mm_max_ps(even, odd));
+            }
+#endif
+            for (; x < width; x++) {
+                target[y * width + x] = max_float(max_float(below[2 * x], below[2 * x + 1]), max_float(above[2 * x], above[2 * x + 1]));
+            }
+        }
+    }
+}
+
+void occlusion_finish(Occlusion* occlusion) {
+    if (!occlusion->enabled || occlusion->triangleCount == 0) return;
+
+    PROFILE_BEGIN("occlusion");
+    jobs_parallel_for(OCCLUSION_BANDS, 1, rasterize_bands, occlusion);
+    build_levels(occlusion);
+    occlusion->active = true;
+    PROFILE_END();
+}
+
+bool occlusion_aabb_visible(Occlusion* occlusion, const AABB* box) {
+    if (!occlusion->active) return true;
+
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    float nearest = FLT_MAX;
+
+    // Corners as the projected min corner plus projected edges, rather than eight products
+    vec4 origin, edges[3];
+    glm_mat4_mulv(occlusion->viewProjection, (vec4){box->min[0], box->min[1], box->min[2], 1.0f}, origin);
+    for (int k = 0; k < 3; k++) {
+        glm_vec4_scale(occlusion->viewProjection[k], box->max[k] - box->min[k], edges[k]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        vec4 clip;
+        glm_vec4_copy(origin, clip);
+        for (int k = 0; k < 3; k++) {
+            if (i & (1 << k)) glm_vec4_add(clip, edges[k], clip);
+        }
+        // Reaching past the near plane, so close that it can't be judged
+        if (clip[2] < -clip[3]) return true;
+
+        float invW = 1.0f / clip[3];
+        float x = (clip[0] * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        float y = (clip[1] * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+        minX = min_float(minX, x);
+        maxX = max_float(maxX, x);
+        minY = min_float(minY, y);
+        maxY = max_float(maxY, y);
+        nearest = min_float(nearest, clip[2] * invW * 0.5f + 0.5f);
+    }
+    if (maxX < 0.0f || maxY < 0.0f || minX >= OCCLUSION_WIDTH || minY >= OCCLUSION_HEIGHT) return true;
+
+    // Every pixel the box's screen rectangle touches
+    int x0 = (int)max_float(floorf(minX), 0.0f);
+    int y0 = (int)max_float(floorf(minY), 0.0f);
+    int x1 = (int)min_float(floorf(maxX), OCCLUSION_WIDTH - 1);
+    int y1 = (int)min_float(floorf(maxY), OCCLUSION_HEIGHT - 1);
+
+    // The finest level where that is at most 2x2 texels
+    int level = 0;
+    while (level < OCCLUSION_LEVELS - 1 && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        level++;
+    }
+
+    const float* depth = occlusion->levels[level];
+    int width = OCCLUSION_WIDTH >> level;
+    float farthest = 0.0f;
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            farthest = max_float(farthest, depth[y * width + x]);
+        }
+    }
+
+    if (nearest <= farthest) return true;
+    occlusion->hidden++;
+    return false;
+}
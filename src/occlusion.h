@@ -0,0 +1,50 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "common.h"
+#include "mesh.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define OCCLUSION_WIDTH 256     // a multiple of 4, rasterized four pixels at a time
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_LEVELS 8      // down to 2x1
+#define OCCLUSION_BAND_ROWS 8   // rows cleared and rasterized per job
+
+// Screen space triangle set up for rasterizing: edge functions are positive inside and depth
+// is a plane over the screen
+typedef struct {
+    float edges[3][3];          // a*x + b*y + c per edge
+    float depth[3];             // z = a*x + b*y + c
+    int   minX, minY, maxX, maxY;
+} OcclusionTriangle;
+
+// Software depth buffer of the designated occluders, redrawn every frame on the job threads
+// and reduced into a chain of farthest depths that bounding boxes are tested against before
+// they are submitted. Pixels are sampled at their centres, so an occluder's silhouette may
+// hide up to half a pixel of this small buffer more than it should.
+typedef struct {
+    bool      enabled;
+    bool      active;           // occluders were drawn this frame
+    mat4      viewProjection;
+    float*    levels[OCCLUSION_LEVELS];     // level 0 is the depth buffer, bottom row first
+    OcclusionTriangle* triangles;
+    uint32_t  triangleCount;
+    uint32_t  triangleCapacity;
+    vec4*     clip;             // the current occluder's vertices in clip space
+    uint32_t  clipCapacity;
+    uint32_t  hidden;           // boxes found occluded since occlusion_begin
+} Occlusion;
+
+void occlusion_init(Occlusion* occlusion);
+void occlusion_free(Occlusion* occlusion);
+// Starts a frame: forgets the occluders and the count of hidden boxes
+void occlusion_begin(Occlusion* occlusion, mat4 viewProjection);
+void occlusion_add_mesh(Occlusion* occlusion, const Mesh* mesh, mat4 model);
+void occlusion_add_box(Occlusion* occlusion, const OBB* box);
+// Rasterizes the occluders and builds the depth chain
+void occlusion_finish(Occlusion* occlusion);
+// False only when the box is certainly behind what has been drawn
+bool occlusion_aabb_visible(Occlusion* occlusion, const AABB* box);
+
+#endif
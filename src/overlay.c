@@ -0,0 +1,122 @@
+#include "overlay.h"
+#include "memstats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OVERLAY_GRAPH_HEIGHT 60.0f
+#define OVERLAY_LINE 14.0f
+#define OVERLAY_PADDING 8.0f
+#define OVERLAY_BUDGET_MS 33.3f     // the graph's scale never shrinks below two 60 Hz frames
+
+void overlay_init(Overlay* overlay) {
+    memset(overlay, 0, sizeof(*overlay));
+}
+
+void overlay_push_frame(Overlay* overlay, float milliseconds) {
+    overlay->frameTimes[overlay->head] = milliseconds;
+    overlay->head = (overlay->head + 1) % OVERLAY_HISTORY;
+    if (overlay->count < OVERLAY_HISTORY) overlay->count++;
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static float overlay_frame(const Overlay* overlay, int age) {
+    return overlay->frameTimes[(overlay->head - 1 - age + OVERLAY_HISTORY) % OVERLAY_HISTORY];
+}
+
+static void overlay_text(NVGcontext* vg, float x, float* y, const char* text) {
+    nvgText(vg, x, *y, text, NULL);
+    *y += OVERLAY_LINE;
+}
+
+void overlay_draw(Overlay* overlay, NVGcontext* vg, float x, float y, const OverlayStats* stats) {
+    if (!overlay->visible || overlay->count == 0) return;
+
+    float sorted[OVERLAY_HISTORY];
+    float sum = 0.0f;
+    for (int i = 0; i < overlay->count; i++) {
+        sorted[i] = overlay_frame(overlay, i);
+        sum += sorted[i];
+    }
+    qsort(sorted, overlay->count, sizeof(float), compare_floats);
+    float minimum = sorted[0];
+    float maximum = sorted[overlay->count - 1];
+    float average = sum / overlay->count;
+    float p99 = sorted[(int)(0.99f * (overlay->count - 1))];
+
+    int gpuPasses = stats->gpu ? stats->gpu->passCount : 0;
+    int lines = 6 + PHYSICS_STAGE_COUNT + (gpuPasses > 0 ? gpuPasses + 1 : 0);
+    float height = 2.0f * OVERLAY_PADDING + OVERLAY_GRAPH_HEIGHT + lines * OVERLAY_LINE + OVERLAY_PADDING;
+
+    nvgBeginPath(vg);
+    nvgRect(vg, x, y, OVERLAY_WIDTH, height);
+    nvgFillColor(vg, nvgRGBA(20, 20, 20, 200));
+    nvgFill(vg);
+
+    // Newest frame on the right, the whole history as one stroked path
+    float graphX = x + OVERLAY_PADDING;
+    float graphY = y + OVERLAY_PADDING;
+    float graphWidth = OVERLAY_WIDTH - 2.0f * OVERLAY_PADDING;
+    float scale = OVERLAY_GRAPH_HEIGHT / (maximum > OVERLAY_BUDGET_MS ? maximum : OVERLAY_BUDGET_MS);
+    float step = graphWidth / (OVERLAY_HISTORY - 1);
+
+    nvgBeginPath(vg);
+    for (int i = 0; i < overlay->count; i++) {
+        float px = graphX + graphWidth - i * step;
+        float py = graphY + OVERLAY_GRAPH_HEIGHT - overlay_frame(overlay, i) * scale;
+        if (i == 0) nvgMoveTo(vg, px, py);
+        else nvgLineTo(vg, px, py);
+    }
+    nvgStrokeColor(vg, nvgRGB(120, 220, 120));
+    nvgStrokeWidth(vg, 1.0f);
+    nvgStroke(vg);
+
+    nvgFontSize(vg, 14.0f);
+    nvgFontFace(vg, "mono");
+    nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    nvgFillColor(vg, nvgRGB(255, 255, 255));
+
+    char text[128];
+    float textX = x + OVERLAY_PADDING;
+    float textY = graphY + OVERLAY_GRAPH_HEIGHT + OVERLAY_PADDING;
+
+    snprintf(text, sizeof(text), "frame %.2f ms  min %.2f avg %.2f p99 %.2f",
+             overlay_frame(overlay, 0), minimum, average, p99);
+    overlay_text(vg, textX, &textY, text);
+
+    if (gpuPasses > 0) {
+        snprintf(text, sizeof(text), "%-18s %8s %8s", "pass", "cpu ms", "gpu ms");
+        overlay_text(vg, textX, &textY, text);
+        for (int i = 0; i < gpuPasses; i++) {
+            const GpuPass* pass = &stats->gpu->passes[i];
+            snprintf(text, sizeof(text), "  %-16s %8.2f %8.2f", pass->name, pass->cpuMilliseconds, pass->gpuMilliseconds);
+            overlay_text(vg, textX, &textY, text);
+        }
+    }
+
+    double physicsTotal = 0.0;
+    for (int i = 0; i < PHYSICS_STAGE_COUNT; i++) physicsTotal += stats->physicsStages[i];
+    snprintf(text, sizeof(text), "%-18s %8.2f", "physics ms", 1000.0 * physicsTotal);
+    overlay_text(vg, textX, &textY, text);
+    for (int i = 0; i < PHYSICS_STAGE_COUNT; i++) {
+        snprintf(text, sizeof(text), "  %-16s %8.2f", physics_stage_name((PhysicsStage)i), 1000.0 * stats->physicsStages[i]);
+        overlay_text(vg, textX, &textY, text);
+    }
+
+    const RenderStats* render = stats->render;
+    snprintf(text, sizeof(text), "draws %u  triangles %u  states %u", render->drawCalls, render->triangles, render->stateChanges);
+    overlay_text(vg, textX, &textY, text);
+    snprintf(text, sizeof(text), "uniforms %u  uploaded %.1f KB", render->uniformUploads, render->uploadBytes / 1024.0);
+    overlay_text(vg, textX, &textY, text);
+    snprintf(text, sizeof(text), "memory %.1f MB", stats->memoryBytes / (1024.0 * 1024.0));
+    overlay_text(vg, textX, &textY, text);
+    snprintf(text, sizeof(text), "tracked cpu %.1f MB  gpu %.1f MB",
+             mem_total(MEMORY_GENERAL, MEMORY_GPU_FIRST) / (1024.0 * 1024.0),
+             mem_total(MEMORY_GPU_FIRST, MEMORY_TAG_COUNT) / (1024.0 * 1024.0));
+    overlay_text(vg, textX, &textY, text);
+}
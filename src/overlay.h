@@ -0,0 +1,32 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include "nanovg.h"
+#include "gputimer.h"
+#include "physics.h"
+#include "renderstats.h"
+#include <stdbool.h>
+
+#define OVERLAY_HISTORY 300         // frames shown in the graph
+#define OVERLAY_WIDTH 320.0f
+
+// Everything the overlay shows besides its own frame times, gathered by the caller each frame
+typedef struct {
+    const double*      physicsStages;   // PHYSICS_STAGE_COUNT seconds, as in Physics.stageTimes
+    const GpuTimer*    gpu;         // may be NULL
+    const RenderStats* render;      // the last complete frame's GL work
+    size_t             memoryBytes;
+} OverlayStats;
+
+typedef struct {
+    float frameTimes[OVERLAY_HISTORY];  // milliseconds, a ring ending at head - 1
+    int   head;
+    int   count;
+    bool  visible;
+} Overlay;
+
+void overlay_init(Overlay* overlay);
+void overlay_push_frame(Overlay* overlay, float milliseconds);
+void overlay_draw(Overlay* overlay, NVGcontext* vg, float x, float y, const OverlayStats* stats);
+
+#endif
@@ -1,10 +1,25 @@
 #include "physics.h"
+#include "collision.h"
+#include "object.h"
+#include "solver.h"
+#include "memstats.h"
+#include "platform.h"
+#include "profiler.h"
+#include <math.h>
 
 #define GRAVITY -9.81f
+#define PHYSICS_ITERATIONS 8
+#define BODY_RESTITUTION 0.0f
+#define BODY_FRICTION 0.6f
 
-void update_aabb(vec3 position, vec3 scale, AABB* aabb) {
-    glm_vec3_add(position, scale, aabb->max);
-    glm_vec3_sub(position, scale, aabb->min);
+#define INTEGRATE_BATCH 1     // chunks
+#define NARROWPHASE_BATCH 256 // pairs or proxies
+#define FINALIZE_BATCH 256    // proxies
+
+// Places the mesh-space bounds with the transform's model matrix
+void collider_update(Collider* collider, mat4 model) {
+    obb_from_bounds(&collider->bounds, model, &collider->box);
+    aabb_from_obb(&collider->box, &collider->aabb);
 }
 
 bool check_collision_aabb(const AABB* a, const AABB* b) {
@@ -17,22 +32,754 @@ void apply_gravity(vec3 velocity, float deltaTime) {
     velocity[1] += GRAVITY * deltaTime;
 }
 
-void resolve_collision(vec3 pos1, vec3 vel1, vec3 pos2, vec3 vel2, vec3 scale1, vec3 scale2) {
-    vec3 midpoint, direction;
-    glm_vec3_add(pos1, pos2, midpoint);
-    glm_vec3_scale(midpoint, 0.5f, midpoint);
+void body_init(Body* body, BodyType type, float mass) {
+    memset(body, 0, sizeof(*body));
+    body->type = type;
+    body->invMass = type == BODY_DYNAMIC && mass > 0.0f ? 1.0f / mass : 0.0f;
+    body->restitution = BODY_RESTITUTION;
+    body->friction = BODY_FRICTION;
+}
+
+// Grows *items to hold at least needed elements
+bool physics_reserve(void** items, uint32_t* capacity, uint32_t needed, size_t itemSize) {
+    if (needed <= *capacity) return true;
+
+    uint32_t newCapacity = *capacity ? *capacity : 64;
+    while (newCapacity < needed) newCapacity *= 2;
+
+    void* grown = mem_realloc(MEMORY_PHYSICS, *items, newCapacity * itemSize);
+    if (!grown) {
+        fprintf(stderr, "ERROR: Failed to grow physics buffer to %u items\n", needed);
+        return false;
+    }
+
+    *items = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+void physics_init(Physics* physics) {
+    memset(physics, 0, sizeof(*physics));
+    physics->iterations = PHYSICS_ITERATIONS;
+}
+
+void physics_free(Physics* physics) {
+    mem_free(physics->chunks);
+    mem_free(physics->proxies);
+    mem_free(physics->sweepOrder);
+    mem_free(physics->sweepReach);
+    mem_free(physics->impactTimes);
+    mem_free(physics->bodyColors);
+    mem_free(physics->pairs);
+    for (int i = 0; i < MAX_JOB_THREADS; i++) {
+        mem_free(physics->threadManifolds[i].items);
+    }
+    mem_free(physics->manifolds.items);
+    mem_free(physics->previous.items);
+    mem_free(physics->manifoldColors);
+    mem_free(physics->colored);
+    mem_free(physics->islandParents);
+    mem_free(physics->islandRest);
+    mem_free(physics->islandIds);
+    mem_free(physics->wakeIslands);
+    mem_free(physics->queryProxies);
+    mem_free(physics->queryBounds);
+    bvh_free(&physics->queryTree);
+    physics_init(physics);
+}
+
+static bool reserve_proxies(Physics* physics, uint32_t needed) {
+    if (needed <= physics->proxyCapacity) return true;
+
+    uint32_t capacity = physics->proxyCapacity;
+    uint32_t sweepCapacity = physics->proxyCapacity;
+    uint32_t reachCapacity = physics->proxyCapacity;
+    uint32_t impactCapacity = physics->proxyCapacity;
+    uint32_t colorCapacity = physics->proxyCapacity;
+    uint32_t parentCapacity = physics->proxyCapacity;
+    uint32_t restCapacity = physics->proxyCapacity;
+    uint32_t idCapacity = physics->proxyCapacity;
+
+    if (!physics_reserve((void**)&physics->proxies, &capacity, needed, sizeof(PhysicsProxy)) ||
+        !physics_reserve((void**)&physics->sweepOrder, &sweepCapacity, capacity, sizeof(uint32_t)) ||
+        !physics_reserve((void**)&physics->sweepReach, &reachCapacity, capacity, sizeof(float)) ||
+        !physics_reserve((void**)&physics->impactTimes, &impactCapacity, capacity, sizeof(float)) ||
+        !physics_reserve((void**)&physics->bodyColors, &colorCapacity, capacity, sizeof(uint64_t)) ||
+        !physics_reserve((void**)&physics->islandParents, &parentCapacity, capacity, sizeof(uint32_t)) ||
+        !physics_reserve((void**)&physics->islandRest, &restCapacity, capacity, sizeof(float)) ||
+        !physics_reserve((void**)&physics->islandIds, &idCapacity, capacity, sizeof(uint32_t))) {
+        return false;
+    }
+
+    physics->proxyCapacity = capacity;
+    return true;
+}
+
+void physics_gather(Physics* physics, World* world) {
+    physics->chunkCount = 0;
+    physics->proxyCount = 0;
+
+    uint32_t proxyCount = 0;
+    EcsQuery query = ecs_query(world, PHYSICS_MASK);
+    while (ecs_query_next(&query)) {
+        if (!physics_reserve((void**)&physics->chunks, &physics->chunkCapacity, physics->chunkCount + 1, sizeof(PhysicsChunk))) {
+            physics->chunkCount = 0;
+            return;
+        }
+
+        physics->chunks[physics->chunkCount++] = (PhysicsChunk){
+            (Transform*)ecs_query_column(&query, COMPONENT_TRANSFORM),
+            (Body*)ecs_query_column(&query, COMPONENT_BODY),
+            (Collider*)ecs_query_column(&query, COMPONENT_COLLIDER),
+            ecs_query_entities(&query),
+            query.count,
+            proxyCount
+        };
+        proxyCount += query.count;
+    }
+
+    if (!reserve_proxies(physics, proxyCount)) {
+        physics->chunkCount = 0;
+        return;
+    }
+
+    // Proxies are laid out in chunk order, so every stage sees the same stable indices
+    for (uint32_t c = 0; c < physics->chunkCount; c++) {
+        PhysicsChunk* chunk = &physics->chunks[c];
+        for (uint32_t i = 0; i < chunk->count; i++) {
+            physics->proxies[chunk->firstProxy + i] = (PhysicsProxy){
+                chunk->entities[i], &chunk->transforms[i], &chunk->bodies[i], &chunk->colliders[i]
+            };
+        }
+    }
+    physics->proxyCount = proxyCount;
+}
+
+typedef struct {
+    Physics* physics;
+    float    deltaTime;
+} IntegrateTask;
+
+static void integrate_velocities(int start, int end, void* data) {
+    IntegrateTask* task = (IntegrateTask*)data;
+
+    for (int c = start; c < end; c++) {
+        PhysicsChunk* chunk = &task->physics->chunks[c];
+
+        for (uint32_t i = 0; i < chunk->count; i++) {
+            Body* body = &chunk->bodies[i];
+            if (body_is_simulated(body)) apply_gravity(body->velocity, task->deltaTime);
+        }
+    }
+}
+
+void physics_integrate_velocities(Physics* physics, float deltaTime) {
+    IntegrateTask task = {physics, deltaTime};
+    jobs_parallel_for((int)physics->chunkCount, INTEGRATE_BATCH, integrate_velocities, &task);
+}
+
+static const PhysicsProxy* sortProxies;
+
+static int compare_sweep(const void* lhs, const void* rhs) {
+    uint32_t a = *(const uint32_t*)lhs;
+    uint32_t b = *(const uint32_t*)rhs;
+    float minA = sortProxies[a].collider->aabb.min[0];
+    float minB = sortProxies[b].collider->aabb.min[0];
+
+    if (minA < minB) return -1;
+    if (minA > minB) return 1;
+    return (a > b) - (a < b);
+}
+
+static int compare_pairs(const void* lhs, const void* rhs) {
+    const PhysicsPair* a = (const PhysicsPair*)lhs;
+    const PhysicsPair* b = (const PhysicsPair*)rhs;
+    if (a->a != b->a) return (a->a > b->a) - (a->a < b->a);
+    return (a->b > b->b) - (a->b < b->b);
+}
+
+// Only pairs something can respond to: one side dynamic, one side moving, and each side
+// in a layer the other collides with
+static bool should_collide(const PhysicsProxy* a, const PhysicsProxy* b) {
+    if (!body_is_dynamic(a->body) && !body_is_dynamic(b->body)) return false;
+    if (!body_is_awake(a->body) && !body_is_awake(b->body)) return false;
+    return (a->collider->category & b->collider->mask) && (b->collider->category & a->collider->mask);
+}
+
+static bool overlaps_with_margin(const AABB* a, const AABB* b) {
+    for (int axis = 0; axis < 3; axis++) {
+        if (a->min[axis] > b->max[axis] + COLLISION_MARGIN || b->min[axis] > a->max[axis] + COLLISION_MARGIN) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sweep and prune along x, then sort the pairs so their order doesn't depend on the sweep
+void physics_broadphase(Physics* physics) {
+    physics->pairCount = 0;
+    uint32_t count = physics->proxyCount;
+    uint32_t* order = physics->sweepOrder;
+
+    for (uint32_t i = 0; i < count; i++) {
+        order[i] = i;
+    }
+
+    sortProxies = physics->proxies;
+    qsort(order, count, sizeof(uint32_t), compare_sweep);
+
+    // Never decreases, so the sweep can binary search for where a box's reach begins
+    float reach = -FLT_MAX;
+    for (uint32_t i = 0; i < count; i++) {
+        reach = fmaxf(reach, physics->proxies[order[i]].collider->aabb.max[0]);
+        physics->sweepReach[i] = reach;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const PhysicsProxy* proxyA = &physics->proxies[order[i]];
+        const AABB* a = &proxyA->collider->aabb;
+
+        for (uint32_t j = i + 1; j < count; j++) {
+            const PhysicsProxy* proxyB = &physics->proxies[order[j]];
+            const AABB* b = &proxyB->collider->aabb;
+            if (b->min[0] > a->max[0] + COLLISION_MARGIN) break;
+            if (!should_collide(proxyA, proxyB)) continue;
+            if (!overlaps_with_margin(a, b)) continue;
+
+            if (!physics_reserve((void**)&physics->pairs, &physics->pairCapacity, physics->pairCount + 1, sizeof(PhysicsPair))) {
+                return;
+            }
+
+            uint32_t first = order[i] < order[j] ? order[i] : order[j];
+            uint32_t second = order[i] < order[j] ? order[j] : order[i];
+            physics->pairs[physics->pairCount++] = (PhysicsPair){first, second};
+        }
+    }
+
+    qsort(physics->pairs, physics->pairCount, sizeof(PhysicsPair), compare_pairs);
+}
+
+void physics_wake(Physics* physics, Body* body) {
+    if (!body_is_sleeping(body)) return;
+
+    if (physics_reserve((void**)&physics->wakeIslands, &physics->wakeCapacity, physics->wakeCount + 1, sizeof(uint32_t))) {
+        physics->wakeIslands[physics->wakeCount++] = body->sleepIsland;
+    }
+    body->sleepIsland = 0;
+    body->restTime = 0.0f;
+}
+
+static int compare_islands(const void* lhs, const void* rhs) {
+    uint32_t a = *(const uint32_t*)lhs;
+    uint32_t b = *(const uint32_t*)rhs;
+    return (a > b) - (a < b);
+}
+
+// Wakes every body sharing an island with one passed to physics_wake
+static void wake_islands(Physics* physics) {
+    if (physics->wakeCount == 0) return;
+
+    qsort(physics->wakeIslands, physics->wakeCount, sizeof(uint32_t), compare_islands);
+
+    for (uint32_t i = 0; i < physics->proxyCount; i++) {
+        Body* body = physics->proxies[i].body;
+        if (body_is_sleeping(body) &&
+            bsearch(&body->sleepIsland, physics->wakeIslands, physics->wakeCount, sizeof(uint32_t), compare_islands)) {
+            body->sleepIsland = 0;
+            body->restTime = 0.0f;
+        }
+    }
+
+    physics->wakeCount = 0;
+}
+
+static bool push_manifold(ManifoldBuffer* buffer, const Manifold* manifold) {
+    if (!physics_reserve((void**)&buffer->items, &buffer->capacity, buffer->count + 1, sizeof(Manifold))) {
+        return false;
+    }
+    buffer->items[buffer->count++] = *manifold;
+    return true;
+}
+
+// Meshes collide as triangles unless dynamic, in which case they fall back to their box
+static const Mesh* triangle_mesh(const PhysicsProxy* proxy) {
+    return body_is_dynamic(proxy->body) ? NULL : proxy->collider->mesh;
+}
+
+typedef struct {
+    ManifoldBuffer*       buffer;
+    const ManifoldBuffer* previous;
+    const Mesh*           mesh;
+    mat4                  model;
+    const OBB*            box;
+    Manifold              manifold; // fields shared by every triangle's manifold
+    bool                  failed;
+} MeshContacts;
+
+static bool collide_mesh_triangle(uint32_t triangle, void* data) {
+    MeshContacts* contacts = (MeshContacts*)data;
+
+    vec3 corners[3];
+    mesh_triangle(contacts->mesh, triangle, corners);
+    for (int v = 0; v < 3; v++) {
+        glm_mat4_mulv3(contacts->model, corners[v], 1.0f, corners[v]);
+    }
+
+    Manifold manifold = contacts->manifold;
+    if (!collide_obb_triangle(contacts->box, corners, &manifold)) return true;
+
+    manifold.feature = triangle;
+    solver_match(contacts->previous, &manifold);
+    if (!push_manifold(contacts->buffer, &manifold)) {
+        contacts->failed = true;
+        return false;
+    }
+    return true;
+}
+
+// One manifold per triangle near the box, found through the mesh's BVH in mesh space
+static bool narrowphase_mesh(Physics* physics, ManifoldBuffer* buffer, const Manifold* shared) {
+    const PhysicsProxy* proxy = &physics->proxies[shared->a];
+    const PhysicsProxy* meshProxy = &physics->proxies[shared->b];
+
+    MeshContacts contacts;
+    contacts.buffer = buffer;
+    contacts.previous = &physics->previous;
+    contacts.mesh = meshProxy->collider->mesh;
+    glm_mat4_copy(meshProxy->transform->model, contacts.model);
+    contacts.box = &proxy->collider->box;
+    contacts.manifold = *shared;
+    contacts.failed = false;
+
+    mat4 inverse;
+    glm_mat4_inv(contacts.model, inverse);
+
+    AABB world = proxy->collider->aabb;
+    glm_vec3_subs(world.min, COLLISION_MARGIN, world.min);
+    glm_vec3_adds(world.max, COLLISION_MARGIN, world.max);
+
+    AABB local;
+    glm_vec3_fill(local.min, FLT_MAX);
+    glm_vec3_fill(local.max, -FLT_MAX);
+    for (int c = 0; c < 8; c++) {
+        vec3 corner = {
+            (c & 1) ? world.max[0] : world.min[0],
+            (c & 2) ? world.max[1] : world.min[1],
+            (c & 4) ? world.max[2] : world.min[2]
+        };
+        glm_mat4_mulv3(inverse, corner, 1.0f, corner);
+        glm_vec3_minv(local.min, corner, local.min);
+        glm_vec3_maxv(local.max, corner, local.max);
+    }
+
+    bvh_query(&contacts.mesh->bvh, &local, collide_mesh_triangle, &contacts);
+    return !contacts.failed;
+}
+
+static void narrowphase_pairs(int start, int end, void* data) {
+    Physics* physics = (Physics*)data;
+    ManifoldBuffer* buffer = &physics->threadManifolds[jobs_thread_index()];
+
+    for (int p = start; p < end; p++) {
+        const PhysicsPair* pair = &physics->pairs[p];
+
+        // Order by entity so the key, and the normal's direction, survive chunk moves
+        uint32_t a = pair->a, b = pair->b;
+        if (physics->proxies[a].entity.index > physics->proxies[b].entity.index) {
+            a = pair->b;
+            b = pair->a;
+        }
+
+        // Against a triangle mesh the box always comes first, so normals point into the mesh
+        if (triangle_mesh(&physics->proxies[a]) && !triangle_mesh(&physics->proxies[b])) {
+            uint32_t swap = a;
+            a = b;
+            b = swap;
+        }
+
+        const PhysicsProxy* proxyA = &physics->proxies[a];
+        const PhysicsProxy* proxyB = &physics->proxies[b];
+
+        Manifold manifold;
+        manifold.key = ((uint64_t)proxyA->entity.index << 32) | proxyB->entity.index;
+        manifold.feature = 0;
+        manifold.order = (uint32_t)p;
+        manifold.a = a;
+        manifold.b = b;
+        manifold.friction = sqrtf(proxyA->body->friction * proxyB->body->friction);
+        manifold.restitution = fmaxf(proxyA->body->restitution, proxyB->body->restitution);
+        manifold.pointCount = 0;
+
+        if (triangle_mesh(proxyB) && !triangle_mesh(proxyA)) {
+            if (!narrowphase_mesh(physics, buffer, &manifold)) return;
+            continue;
+        }
+
+        if (!collide_obb_obb(&proxyA->collider->box, &proxyB->collider->box, &manifold)) continue;
+
+        solver_match(&physics->previous, &manifold);
+
+        if (!push_manifold(buffer, &manifold)) return;
+    }
+}
+
+typedef struct {
+    Physics* physics;
+    float    deltaTime;
+} NarrowphaseTask;
+
+static void narrowphase_ground(int start, int end, void* data) {
+    NarrowphaseTask* task = (NarrowphaseTask*)data;
+    Physics* physics = task->physics;
+    ManifoldBuffer* buffer = &physics->threadManifolds[jobs_thread_index()];
+
+    for (int i = start; i < end; i++) {
+        const PhysicsProxy* proxy = &physics->proxies[i];
+        if (!body_is_simulated(proxy->body)) continue;
+
+        // Reach as far as the body will fall this step, so fast bodies are caught before they sink in
+        float fall = -proxy->body->velocity[1] * task->deltaTime;
+        float margin = COLLISION_MARGIN + fmaxf(fall, 0.0f);
+
+        if (proxy->collider->aabb.min[1] > COLLISION_GROUND_HEIGHT + margin) continue;
+
+        Manifold manifold;
+        if (!collide_obb_ground(&proxy->collider->box, margin, &manifold)) continue;
+
+        manifold.key = ((uint64_t)proxy->entity.index << 32) | PHYSICS_GROUND;
+        manifold.feature = 0;
+        manifold.order = physics->pairCount + (uint32_t)i;
+        manifold.a = (uint32_t)i;
+        manifold.b = PHYSICS_GROUND;
+        manifold.friction = proxy->body->friction;
+        manifold.restitution = proxy->body->restitution;
+        solver_match(&physics->previous, &manifold);
+
+        if (!push_manifold(buffer, &manifold)) return;
+    }
+}
+
+static int compare_manifolds(const void* lhs, const void* rhs) {
+    const Manifold* a = (const Manifold*)lhs;
+    const Manifold* b = (const Manifold*)rhs;
+    if (a->order != b->order) return (a->order > b->order) - (a->order < b->order);
+    return (a->feature > b->feature) - (a->feature < b->feature);
+}
+
+// Builds manifolds for pair batches and ground contacts concurrently into per-thread
+// buffers, then merges them back into pair order so the result is independent of the
+// thread count
+void physics_narrowphase(Physics* physics, float deltaTime) {
+    int threadCount = jobs_thread_count();
+    for (int t = 0; t < threadCount; t++) {
+        physics->threadManifolds[t].count = 0;
+    }
+
+    jobs_parallel_for((int)physics->pairCount, NARROWPHASE_BATCH, narrowphase_pairs, physics);
+    NarrowphaseTask task = {physics, deltaTime};
+    jobs_parallel_for((int)physics->proxyCount, NARROWPHASE_BATCH, narrowphase_ground, &task);
+
+    uint32_t total = 0;
+    for (int t = 0; t < threadCount; t++) {
+        total += physics->threadManifolds[t].count;
+    }
+
+    physics->manifolds.count = 0;
+    if (!physics_reserve((void**)&physics->manifolds.items, &physics->manifolds.capacity, total, sizeof(Manifold))) {
+        return;
+    }
+
+    for (int t = 0; t < threadCount; t++) {
+        ManifoldBuffer* buffer = &physics->threadManifolds[t];
+        memcpy(physics->manifolds.items + physics->manifolds.count, buffer->items, buffer->count * sizeof(Manifold));
+        physics->manifolds.count += buffer->count;
+    }
+
+    qsort(physics->manifolds.items, physics->manifolds.count, sizeof(Manifold), compare_manifolds);
+
+    // An awake body touching a sleeping one wakes its whole island before anything is solved
+    for (uint32_t m = 0; m < physics->manifolds.count; m++) {
+        const Manifold* manifold = &physics->manifolds.items[m];
+        if (manifold->b == PHYSICS_GROUND) continue;
+        physics_wake(physics, physics->proxies[manifold->a].body);
+        physics_wake(physics, physics->proxies[manifold->b].body);
+    }
+    wake_islands(physics);
+}
+
+typedef struct {
+    Physics* physics;
+    float    deltaTime;
+} FinalizeTask;
+
+static bool is_fast(const PhysicsProxy* proxy, float deltaTime) {
+    const AABB* box = &proxy->collider->aabb;
+    for (int axis = 0; axis < 3; axis++) {
+        float travel = fabsf(proxy->body->velocity[axis]) * deltaTime;
+        float halfExtent = fmaxf(0.5f * (box->max[axis] - box->min[axis]), COLLISION_MARGIN);
+        if (travel > PHYSICS_CCD_THRESHOLD * halfExtent) return true;
+    }
+    return false;
+}
+
+// First place in the sweep order from which a proxy can reach x
+static uint32_t sweep_start(const Physics* physics, float x) {
+    uint32_t low = 0;
+    uint32_t high = physics->proxyCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (physics->sweepReach[middle] < x) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Finds the earliest impact of one fast proxy against everything its swept box overlaps,
+// walking only the window of the broadphase's sweep order that spans the swept box in x
+static float sweep_proxy(Physics* physics, uint32_t index, float deltaTime) {
+    const PhysicsProxy* proxy = &physics->proxies[index];
+    const AABB* box = &proxy->collider->aabb;
+
+    vec3 velocity, motion;
+    glm_vec3_copy(proxy->body->velocity, velocity);
+    glm_vec3_scale(velocity, deltaTime, motion);
+
+    AABB swept;
+    for (int axis = 0; axis < 3; axis++) {
+        swept.min[axis] = box->min[axis] + fminf(motion[axis], 0.0f);
+        swept.max[axis] = box->max[axis] + fmaxf(motion[axis], 0.0f);
+    }
+
+    float earliest = 1.0f;
+    float distance = glm_vec3_norm(motion);
+
+    for (uint32_t i = sweep_start(physics, swept.min[0]); i < physics->proxyCount; i++) {
+        uint32_t other = physics->sweepOrder[i];
+        const PhysicsProxy* target = &physics->proxies[other];
+        const AABB* targetBox = &target->collider->aabb;
+        if (targetBox->min[0] > swept.max[0]) break;
+        if (targetBox->max[0] < swept.min[0] || other == index) continue;
+        // Pairs the broadphase would never make can't stop the body either
+        if (!should_collide(proxy, target)) continue;
+
+        // Sweep against the other body's motion too; both sides clamp to the same impact
+        vec3 relative;
+        glm_vec3_sub(velocity, target->body->velocity, relative);
+        glm_vec3_scale(relative, deltaTime, relative);
+
+        float time;
+        bool hit = triangle_mesh(target)
+            ? sweep_obb_mesh(&proxy->collider->box, relative, target->collider->mesh, target->transform->model, &time)
+            : sweep_aabb_aabb(box, relative, targetBox, &time);
+        if (hit && time < earliest) {
+            earliest = time;
+        }
+    }
+
+    // Stop short of the surface so the next step's narrowphase sees a speculative contact
+    if (earliest < 1.0f && distance > 0.0f) {
+        earliest = fmaxf(earliest - 0.5f * COLLISION_MARGIN / distance, 0.0f);
+    }
+    return earliest;
+}
+
+static void sweep_proxies(int start, int end, void* data) {
+    FinalizeTask* task = (FinalizeTask*)data;
+    Physics* physics = task->physics;
+
+    for (int i = start; i < end; i++) {
+        const PhysicsProxy* proxy = &physics->proxies[i];
+        float time = 1.0f;
+        if (body_is_simulated(proxy->body) && is_fast(proxy, task->deltaTime)) {
+            time = sweep_proxy(physics, (uint32_t)i, task->deltaTime);
+        }
+        physics->impactTimes[i] = time;
+    }
+}
+
+// Continuous collision for bodies moving far enough to skip past a contact in one step.
+// Only reads start-of-step boxes, so it runs in parallel ahead of position integration.
+void physics_sweep(Physics* physics, float deltaTime) {
+    FinalizeTask task = {physics, deltaTime};
+    jobs_parallel_for((int)physics->proxyCount, FINALIZE_BATCH, sweep_proxies, &task);
+}
+
+static void integrate_positions(int start, int end, void* data) {
+    FinalizeTask* task = (FinalizeTask*)data;
+
+    for (int i = start; i < end; i++) {
+        PhysicsProxy* proxy = &task->physics->proxies[i];
+        Transform* transform = proxy->transform;
+        Collider* collider = proxy->collider;
+        Body* body = proxy->body;
+        if (!body_is_awake(body)) continue;
+
+        vec3 displacement;
+        glm_vec3_scale(body->velocity, task->deltaTime * task->physics->impactTimes[i], displacement);
+
+        // Ground contacts should have stopped the body already; this only catches stragglers.
+        // Kinematic bodies go wherever they're sent.
+        float below = COLLISION_GROUND_HEIGHT - (collider->aabb.min[1] + displacement[1]);
+        if (below > 0.0f && body_is_dynamic(body)) {
+            displacement[1] += below;
+            if (body->velocity[1] < 0.0f) body->velocity[1] = 0;
+        }
+
+        // Bodies don't rotate, so the collider just moves along with them
+        glm_vec3_add(transform->position, displacement, transform->position);
+        glm_vec3_add(collider->box.center, displacement, collider->box.center);
+        glm_vec3_add(collider->aabb.min, displacement, collider->aabb.min);
+        glm_vec3_add(collider->aabb.max, displacement, collider->aabb.max);
+
+        float limit = PHYSICS_SLEEP_VELOCITY * PHYSICS_SLEEP_VELOCITY;
+        body->restTime = glm_vec3_norm2(body->velocity) < limit ? body->restTime + task->deltaTime : 0.0f;
+    }
+}
+
+void physics_integrate_positions(Physics* physics, float deltaTime) {
+    FinalizeTask task = {physics, deltaTime};
+    jobs_parallel_for((int)physics->proxyCount, FINALIZE_BATCH, integrate_positions, &task);
+}
+
+static void update_transforms(int start, int end, void* data) {
+    Physics* physics = (Physics*)data;
+
+    for (int i = start; i < end; i++) {
+        PhysicsProxy* proxy = &physics->proxies[i];
+        if (body_is_awake(proxy->body)) transform_update(proxy->transform);
+    }
+}
+
+void physics_update_transforms(Physics* physics) {
+    jobs_parallel_for((int)physics->proxyCount, FINALIZE_BATCH, update_transforms, physics);
+}
+
+static uint32_t island_find(uint32_t* parents, uint32_t i) {
+    while (parents[i] != i) {
+        parents[i] = parents[parents[i]];
+        i = parents[i];
+    }
+    return i;
+}
+
+// Unions awake bodies through this step's manifolds and puts to sleep every island whose
+// bodies have all been resting for PHYSICS_SLEEP_DELAY. Static and kinematic bodies and the
+// ground don't join islands, so a stack on the floor doesn't tie together everything else
+// resting on it.
+void physics_islands(Physics* physics) {
+    uint32_t* parents = physics->islandParents;
+    float* rest = physics->islandRest;
+
+    for (uint32_t i = 0; i < physics->proxyCount; i++) {
+        parents[i] = i;
+        rest[i] = FLT_MAX;
+    }
+
+    for (uint32_t m = 0; m < physics->manifolds.count; m++) {
+        const Manifold* manifold = &physics->manifolds.items[m];
+        if (manifold->b == PHYSICS_GROUND ||
+            !body_is_dynamic(physics->proxies[manifold->a].body) ||
+            !body_is_dynamic(physics->proxies[manifold->b].body)) {
+            continue;
+        }
+
+        uint32_t a = island_find(parents, manifold->a);
+        uint32_t b = island_find(parents, manifold->b);
+        if (a == b) continue;
+
+        // Keep the lower index as root so island ids come out in a stable order
+        if (a < b) parents[b] = a; else parents[a] = b;
+    }
+
+    for (uint32_t i = 0; i < physics->proxyCount; i++) {
+        const Body* body = physics->proxies[i].body;
+        if (!body_is_simulated(body)) continue;
+
+        uint32_t root = island_find(parents, i);
+        rest[root] = fminf(rest[root], body->restTime);
+    }
+
+    // Roots have the lowest index in their island, so each island gets its id before its
+    // other members are visited
+    for (uint32_t i = 0; i < physics->proxyCount; i++) {
+        Body* body = physics->proxies[i].body;
+        if (!body_is_simulated(body)) continue;
+
+        uint32_t root = island_find(parents, i);
+        if (rest[root] < PHYSICS_SLEEP_DELAY) continue;
 
-    glm_vec3_sub(pos1, midpoint, direction);
-    glm_vec3_normalize(direction);
-    glm_vec3_scale(direction, scale1[0] + scale2[0], direction);
-    glm_vec3_add(midpoint, direction, pos1);
+        if (root == i) {
+            if (++physics->nextIsland == 0) physics->nextIsland = 1;
+            physics->islandIds[root] = physics->nextIsland;
+        }
 
-    glm_vec3_negate(direction);
-    glm_vec3_add(midpoint, direction, pos2);
+        body->sleepIsland = physics->islandIds[root];
+        glm_vec3_zero(body->velocity);
+    }
+}
+
+static const char* stageNames[PHYSICS_STAGE_COUNT] = {
+    [PHYSICS_STAGE_GATHER]      = "gather",
+    [PHYSICS_STAGE_INTEGRATE]   = "integration",
+    [PHYSICS_STAGE_BROADPHASE]  = "broadphase",
+    [PHYSICS_STAGE_NARROWPHASE] = "narrowphase",
+    [PHYSICS_STAGE_SOLVE]       = "solve",
+    [PHYSICS_STAGE_SWEEP]       = "ccd",
+    [PHYSICS_STAGE_TRANSFORMS]  = "transform_update",
+    [PHYSICS_STAGE_ISLANDS]     = "islands",
+    [PHYSICS_STAGE_QUERIES]     = "query_build",
+};
+
+const char* physics_stage_name(PhysicsStage stage) {
+    return stageNames[stage];
+}
+
+// Charges the time since start to a stage and returns the time now, where the next stage starts
+static double stage_end(Physics* physics, PhysicsStage stage, double start) {
+    double now = platform_time();
+    physics->stageTimes[stage] += now - start;
+    PROFILE_RECORD(stageNames[stage], start, now);
+    return now;
+}
+
+void physics_step(Physics* physics, World* world, float deltaTime) {
+    PROFILE_BEGIN("physics_step");
+    memset(physics->stageTimes, 0, sizeof(physics->stageTimes));
+    double time = platform_time();
+
+    physics_gather(physics, world);
+    time = stage_end(physics, PHYSICS_STAGE_GATHER, time);
+    if (physics->proxyCount == 0) {
+        physics_build_queries(physics);
+        stage_end(physics, PHYSICS_STAGE_QUERIES, time);
+        PROFILE_END();
+        return;
+    }
 
-    // Reset velocities (simple bounce effect)
-    glm_vec3_negate(vel1);
-    glm_vec3_negate(vel2);
-    glm_vec3_scale(vel1, 0.5f, vel1); // Dampen the bounce
-    glm_vec3_scale(vel2, 0.5f, vel2);
-}
\ No newline at end of file
+    // Wake requests made between steps, e.g. teleports
+    wake_islands(physics);
+    time = stage_end(physics, PHYSICS_STAGE_ISLANDS, time);
+
+    physics_integrate_velocities(physics, deltaTime);
+    time = stage_end(physics, PHYSICS_STAGE_INTEGRATE, time);
+    physics_broadphase(physics);
+    time = stage_end(physics, PHYSICS_STAGE_BROADPHASE, time);
+    physics_narrowphase(physics, deltaTime);
+    time = stage_end(physics, PHYSICS_STAGE_NARROWPHASE, time);
+    physics_solve(physics, deltaTime);
+    time = stage_end(physics, PHYSICS_STAGE_SOLVE, time);
+    physics_sweep(physics, deltaTime);
+    time = stage_end(physics, PHYSICS_STAGE_SWEEP, time);
+    physics_integrate_positions(physics, deltaTime);
+    time = stage_end(physics, PHYSICS_STAGE_INTEGRATE, time);
+    physics_update_transforms(physics);
+    time = stage_end(physics, PHYSICS_STAGE_TRANSFORMS, time);
+    physics_islands(physics);
+    time = stage_end(physics, PHYSICS_STAGE_ISLANDS, time);
+    physics_build_queries(physics);
+    stage_end(physics, PHYSICS_STAGE_QUERIES, time);
+    PROFILE_END();
+}
@@ -2,10 +2,188 @@
 #define PHYSICS_H
 
 #include "common.h"
+#include "ecs.h"
+#include "jobs.h"
+#include "bvh.h"
 
-void update_aabb(vec3 position, vec3 scale, AABB* aabb);
+#define PHYSICS_MASK (COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BODY) | COMPONENT_BIT(COMPONENT_COLLIDER))
+#define PHYSICS_MAX_COLORS 64 // manifolds beyond this many colours are solved serially
+#define PHYSICS_SLEEP_VELOCITY 0.05f
+#define PHYSICS_SLEEP_DELAY 0.5f   // seconds an entire island must rest before it sleeps
+#define PHYSICS_CCD_THRESHOLD 0.5f // bodies moving further than this fraction of their half extent per step are swept
+#define PHYSICS_GROUND UINT32_MAX  // stands in for a proxy index when a manifold is against the ground
+#define MANIFOLD_MAX_POINTS 4
+
+#define PHYSICS_LAYER_NONE 0u
+#define PHYSICS_LAYER_DEFAULT 1u
+#define PHYSICS_LAYER_ALL UINT32_MAX
+
+typedef struct {
+    Entity     entity;
+    Transform* transform;
+    Body*      body;
+    Collider*  collider;
+} PhysicsProxy;
+
+// Broadphase candidate, a < b
+typedef struct {
+    uint32_t a, b;
+} PhysicsPair;
+
+typedef struct {
+    vec3     position;
+    float    depth;
+    uint32_t id;                // identifies the generating feature, to match points across steps
+    float    normalImpulse;     // accumulated, carried over for warm starting
+    float    tangentImpulse[2];
+    float    normalMass;
+    float    tangentMass[2];
+    float    velocityBias;
+    float    relativeVelocity;  // normal velocity before solving, for restitution
+} ContactPoint;
+
+// Persistent contact between two bodies, matched across steps by key
+typedef struct {
+    uint64_t     key;           // entity indices of a and b
+    uint32_t     feature;       // triangle against a mesh, otherwise 0; with key identifies the manifold
+    uint32_t     order;         // pair index (or pairCount + proxy for the ground), for a stable order
+    uint32_t     a, b;          // proxy indices, b may be PHYSICS_GROUND
+    vec3         normal;        // from a towards b
+    vec3         tangents[2];
+    float        friction;
+    float        restitution;
+    int          pointCount;
+    ContactPoint points[MANIFOLD_MAX_POINTS];
+} Manifold;
+
+typedef struct {
+    Manifold* items;
+    uint32_t  count;
+    uint32_t  capacity;
+} ManifoldBuffer;
+
+typedef struct {
+    Transform* transforms;
+    Body*      bodies;
+    Collider*  colliders;
+    const Entity* entities;
+    uint32_t   count;
+    uint32_t   firstProxy;
+} PhysicsChunk;
+
+// Copy of a collider as of the last step, so scene queries don't touch component storage
+typedef struct {
+    Entity      entity;
+    uint32_t    category;
+    OBB         box;
+    const Mesh* mesh;
+    mat4        inverseModel;   // world to mesh space, only set with a mesh
+} QueryProxy;
+
+typedef enum {
+    PHYSICS_STAGE_GATHER,
+    PHYSICS_STAGE_INTEGRATE,        // velocities and positions
+    PHYSICS_STAGE_BROADPHASE,
+    PHYSICS_STAGE_NARROWPHASE,
+    PHYSICS_STAGE_SOLVE,
+    PHYSICS_STAGE_SWEEP,
+    PHYSICS_STAGE_TRANSFORMS,
+    PHYSICS_STAGE_ISLANDS,          // including waking islands at the start of the step
+    PHYSICS_STAGE_QUERIES,
+    PHYSICS_STAGE_COUNT
+} PhysicsStage;
+
+// Per-step scratch for the physics pipeline, kept between frames to avoid reallocating
+typedef struct {
+    PhysicsChunk*  chunks;
+    uint32_t       chunkCount;
+    uint32_t       chunkCapacity;
+
+    PhysicsProxy*  proxies;
+    uint32_t       proxyCount;
+    uint32_t       proxyCapacity;
+
+    uint32_t*      sweepOrder;      // proxy indices sorted along the sweep axis
+    float*         sweepReach;      // largest max x of the proxies up to each place in sweepOrder
+    float*         impactTimes;     // fraction of this step's motion each proxy may travel
+    uint64_t*      bodyColors;      // colours already used by each proxy's manifolds
+
+    PhysicsPair*   pairs;
+    uint32_t       pairCount;
+    uint32_t       pairCapacity;
+
+    ManifoldBuffer threadManifolds[MAX_JOB_THREADS];
+    ManifoldBuffer manifolds;       // merged, in pair order
+    ManifoldBuffer previous;        // last step's manifolds sorted by key, for warm starting
+    uint8_t*       manifoldColors;
+    uint32_t       manifoldColorCapacity;
+    uint32_t*      colored;         // manifold indices grouped by colour
+    uint32_t       coloredCapacity;
+    uint32_t       colorStarts[PHYSICS_MAX_COLORS + 2];
+    int            iterations;
+
+    uint32_t*      islandParents;   // union-find over the contact graph, rebuilt every step
+    float*         islandRest;      // shortest rest time in each island, indexed by root
+    uint32_t*      islandIds;       // sleep island assigned to each root this step
+    uint32_t*      wakeIslands;     // sleeping islands to wake at the next opportunity
+    uint32_t       wakeCount;
+    uint32_t       wakeCapacity;
+    uint32_t       nextIsland;
+
+    QueryProxy*    queryProxies;    // scene query snapshot, rebuilt at the end of every step
+    AABB*          queryBounds;
+    uint32_t       queryCount;
+    uint32_t       queryCapacity;
+    Bvh            queryTree;       // over queryProxies
+
+    double         stageTimes[PHYSICS_STAGE_COUNT]; // seconds spent in each stage of the last step
+} Physics;
+
+static inline bool body_is_sleeping(const Body* body) {
+    return body->sleepIsland != 0;
+}
+
+static inline bool body_is_static(const Body* body) {
+    return body->type == BODY_STATIC;
+}
+
+static inline bool body_is_dynamic(const Body* body) {
+    return body->type == BODY_DYNAMIC;
+}
+
+// Moving this step: kinematic bodies, and dynamic bodies that aren't asleep
+static inline bool body_is_awake(const Body* body) {
+    return !body_is_static(body) && !body_is_sleeping(body);
+}
+
+// Dynamic and awake, so gravity and contacts move it
+static inline bool body_is_simulated(const Body* body) {
+    return body_is_dynamic(body) && !body_is_sleeping(body);
+}
+
+void physics_init(Physics* physics);
+void physics_free(Physics* physics);
+void physics_step(Physics* physics, World* world, float deltaTime);
+const char* physics_stage_name(PhysicsStage stage);
+
+void physics_gather(Physics* physics, World* world);
+void physics_integrate_velocities(Physics* physics, float deltaTime);
+void physics_broadphase(Physics* physics);
+void physics_narrowphase(Physics* physics, float deltaTime);
+void physics_solve(Physics* physics, float deltaTime);
+void physics_sweep(Physics* physics, float deltaTime);
+void physics_integrate_positions(Physics* physics, float deltaTime);
+void physics_update_transforms(Physics* physics);
+void physics_islands(Physics* physics);
+void physics_build_queries(Physics* physics);
+void physics_wake(Physics* physics, Body* body);
+
+bool physics_reserve(void** items, uint32_t* capacity, uint32_t needed, size_t itemSize);
+
+// mass is ignored unless the body is dynamic
+void body_init(Body* body, BodyType type, float mass);
+void collider_update(Collider* collider, mat4 model);
 bool check_collision_aabb(const AABB* a, const AABB* b);
 void apply_gravity(vec3 velocity, float dt);
-void resolve_collision(vec3 pos1, vec3 vel1, vec3 pos2, vec3 vel2, vec3 scale1, vec3 scale2);
 
-#endif
\ No newline at end of file
+#endif
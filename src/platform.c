@@ -0,0 +1,198 @@
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+
+struct Thread  { HANDLE handle; ThreadFunc func; void* arg; };
+struct Mutex   { CRITICAL_SECTION cs; };
+struct CondVar { CONDITION_VARIABLE cv; };
+
+static DWORD WINAPI thread_entry(LPVOID param) {
+    Thread* thread = (Thread*)param;
+    thread->func(thread->arg);
+    return 0;
+}
+
+int platform_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+double platform_time(void) {
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+size_t platform_memory_usage(void) {
+    // The K32 entry point lives in kernel32, so this doesn't need psapi.lib
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.WorkingSetSize;
+}
+
+Thread* thread_create(ThreadFunc func, void* arg) {
+    Thread* thread = (Thread*)malloc(sizeof(Thread));
+    if (!thread) return NULL;
+
+    thread->func = func;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, thread_entry, thread, 0, NULL);
+    if (!thread->handle) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void thread_join(Thread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+void thread_yield(void) {
+    SwitchToThread();
+}
+
+Mutex* mutex_create(void) {
+    Mutex* mutex = (Mutex*)malloc(sizeof(Mutex));
+    if (mutex) InitializeCriticalSection(&mutex->cs);
+    return mutex;
+}
+
+void mutex_destroy(Mutex* mutex) {
+    DeleteCriticalSection(&mutex->cs);
+    free(mutex);
+}
+
+void mutex_lock(Mutex* mutex) {
+    EnterCriticalSection(&mutex->cs);
+}
+
+void mutex_unlock(Mutex* mutex) {
+    LeaveCriticalSection(&mutex->cs);
+}
+
+CondVar* condvar_create(void) {
+    CondVar* condvar = (CondVar*)malloc(sizeof(CondVar));
+    if (condvar) InitializeConditionVariable(&condvar->cv);
+    return condvar;
+}
+
+void condvar_destroy(CondVar* condvar) {
+    free(condvar);
+}
+
+void condvar_wait(CondVar* condvar, Mutex* mutex) {
+    SleepConditionVariableCS(&condvar->cv, &mutex->cs, INFINITE);
+}
+
+void condvar_broadcast(CondVar* condvar) {
+    WakeAllConditionVariable(&condvar->cv);
+}
+
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+struct Thread  { pthread_t handle; ThreadFunc func; void* arg; };
+struct Mutex   { pthread_mutex_t mutex; };
+struct CondVar { pthread_cond_t cond; };
+
+static void* thread_entry(void* param) {
+    Thread* thread = (Thread*)param;
+    thread->func(thread->arg);
+    return NULL;
+}
+
+int platform_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+double platform_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+size_t platform_memory_usage(void) {
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+
+    unsigned long size = 0, resident = 0;
+    int read = fscanf(file, "%lu %lu", &size, &resident);
+    fclose(file);
+    return read == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0;
+}
+
+Thread* thread_create(ThreadFunc func, void* arg) {
+    Thread* thread = (Thread*)malloc(sizeof(Thread));
+    if (!thread) return NULL;
+
+    thread->func = func;
+    thread->arg = arg;
+    if (pthread_create(&thread->handle, NULL, thread_entry, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void thread_join(Thread* thread) {
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+void thread_yield(void) {
+    sched_yield();
+}
+
+Mutex* mutex_create(void) {
+    Mutex* mutex = (Mutex*)malloc(sizeof(Mutex));
+    if (mutex) pthread_mutex_init(&mutex->mutex, NULL);
+    return mutex;
+}
+
+void mutex_destroy(Mutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+void mutex_lock(Mutex* mutex) {
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+void mutex_unlock(Mutex* mutex) {
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+CondVar* condvar_create(void) {
+    CondVar* condvar = (CondVar*)malloc(sizeof(CondVar));
+    if (condvar) pthread_cond_init(&condvar->cond, NULL);
+    return condvar;
+}
+
+void condvar_destroy(CondVar* condvar) {
+    pthread_cond_destroy(&condvar->cond);
+    free(condvar);
+}
+
+void condvar_wait(CondVar* condvar, Mutex* mutex) {
+    pthread_cond_wait(&condvar->cond, &mutex->mutex);
+}
+
+void condvar_broadcast(CondVar* condvar) {
+    pthread_cond_broadcast(&condvar->cond);
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// Opaque so that windows.h / pthread.h stay out of every translation unit
+typedef struct Thread Thread;
+typedef struct Mutex Mutex;
+typedef struct CondVar CondVar;
+
+typedef void (*ThreadFunc)(void* arg);
+
+int      platform_cpu_count(void);
+// Seconds from an arbitrary fixed point, monotonic; works without a window
+double   platform_time(void);
+// Resident memory of the whole process in bytes, 0 where the OS won't say
+size_t   platform_memory_usage(void);
+
+Thread*  thread_create(ThreadFunc func, void* arg);
+void     thread_join(Thread* thread);
+void     thread_yield(void);
+
+Mutex*   mutex_create(void);
+void     mutex_destroy(Mutex* mutex);
+void     mutex_lock(Mutex* mutex);
+void     mutex_unlock(Mutex* mutex);
+
+CondVar* condvar_create(void);
+void     condvar_destroy(CondVar* condvar);
+void     condvar_wait(CondVar* condvar, Mutex* mutex);
+void     condvar_broadcast(CondVar* condvar);
+
+#endif
@@ -0,0 +1,126 @@
+#include "pool.h"
+#include "memstats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POOL_INITIAL_CAPACITY 64
+#define POOL_NO_SLOT 0xFFFFFFFFu
+
+void pool_init(Pool* pool, size_t itemSize) {
+    memset(pool, 0, sizeof(*pool));
+    pool->itemSize = itemSize;
+    pool->freeSlot = POOL_NO_SLOT;
+}
+
+void pool_free(Pool* pool) {
+    mem_free(pool->items);
+    mem_free(pool->itemSlots);
+    mem_free(pool->slots);
+    pool_init(pool, pool->itemSize);
+}
+
+static bool pool_grow_items(Pool* pool) {
+    uint32_t capacity = pool->capacity ? pool->capacity * 2 : POOL_INITIAL_CAPACITY;
+
+    unsigned char* items = (unsigned char*)mem_realloc(MEMORY_ECS, pool->items, capacity * pool->itemSize);
+    if (!items) return false;
+    pool->items = items;
+
+    uint32_t* itemSlots = (uint32_t*)mem_realloc(MEMORY_ECS, pool->itemSlots, capacity * sizeof(uint32_t));
+    if (!itemSlots) return false;
+    pool->itemSlots = itemSlots;
+
+    pool->capacity = capacity;
+    return true;
+}
+
+static uint32_t pool_acquire_slot(Pool* pool) {
+    if (pool->freeSlot != POOL_NO_SLOT) {
+        uint32_t slot = pool->freeSlot;
+        pool->freeSlot = pool->slots[slot].dense;
+        return slot;
+    }
+
+    if (pool->slotCount == pool->slotCapacity) {
+        uint32_t capacity = pool->slotCapacity ? pool->slotCapacity * 2 : POOL_INITIAL_CAPACITY;
+        PoolSlot* slots = (PoolSlot*)mem_realloc(MEMORY_ECS, pool->slots, capacity * sizeof(PoolSlot));
+        if (!slots) return POOL_NO_SLOT;
+        pool->slots = slots;
+        pool->slotCapacity = capacity;
+    }
+
+    uint32_t slot = pool->slotCount++;
+    pool->slots[slot].generation = 1;
+    return slot;
+}
+
+Handle pool_add(Pool* pool, const void* item) {
+    if (pool->count == pool->capacity && !pool_grow_items(pool)) {
+        fprintf(stderr, "ERROR: Failed to grow pool to %u items\n", pool->count + 1);
+        return HANDLE_NULL;
+    }
+
+    uint32_t slot = pool_acquire_slot(pool);
+    if (slot == POOL_NO_SLOT) {
+        fprintf(stderr, "ERROR: Failed to allocate pool slot\n");
+        return HANDLE_NULL;
+    }
+
+    uint32_t dense = pool->count++;
+    if (item) {
+        memcpy(pool->items + dense * pool->itemSize, item, pool->itemSize);
+    } else {
+        memset(pool->items + dense * pool->itemSize, 0, pool->itemSize);
+    }
+    pool->itemSlots[dense] = slot;
+    pool->slots[slot].dense = dense;
+
+    return (Handle){slot, pool->slots[slot].generation};
+}
+
+bool pool_is_valid(const Pool* pool, Handle handle) {
+    return handle.index < pool->slotCount &&
+           handle.generation != 0 &&
+           pool->slots[handle.index].generation == handle.generation;
+}
+
+bool pool_remove(Pool* pool, Handle handle) {
+    if (!pool_is_valid(pool, handle)) return false;
+
+    PoolSlot* slot = &pool->slots[handle.index];
+    uint32_t dense = slot->dense;
+    uint32_t last = --pool->count;
+
+    // Swap the last item into the hole to keep the array packed
+    if (dense != last) {
+        memcpy(pool->items + dense * pool->itemSize, pool->items + last * pool->itemSize, pool->itemSize);
+        uint32_t movedSlot = pool->itemSlots[last];
+        pool->itemSlots[dense] = movedSlot;
+        pool->slots[movedSlot].dense = dense;
+    }
+
+    // Bump the generation so outstanding handles go stale, skipping 0 on wrap
+    slot->generation++;
+    if (slot->generation == 0) slot->generation = 1;
+    slot->dense = pool->freeSlot;
+    pool->freeSlot = handle.index;
+
+    return true;
+}
+
+void* pool_get(Pool* pool, Handle handle) {
+    if (!pool_is_valid(pool, handle)) return NULL;
+    return pool->items + pool->slots[handle.index].dense * pool->itemSize;
+}
+
+void* pool_at(Pool* pool, uint32_t denseIndex) {
+    if (denseIndex >= pool->count) return NULL;
+    return pool->items + denseIndex * pool->itemSize;
+}
+
+Handle pool_handle_at(const Pool* pool, uint32_t denseIndex) {
+    if (denseIndex >= pool->count) return HANDLE_NULL;
+    uint32_t slot = pool->itemSlots[denseIndex];
+    return (Handle){slot, pool->slots[slot].generation};
+}
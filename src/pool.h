@@ -0,0 +1,50 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Generational handle. A zeroed handle is never valid, since slot generations start at 1.
+typedef struct {
+    uint32_t index;
+    uint32_t generation;
+} Handle;
+
+#define HANDLE_NULL ((Handle){0, 0})
+
+typedef struct {
+    uint32_t dense;         // index into items while alive, next free slot while free
+    uint32_t generation;
+} PoolSlot;
+
+// Densely packed array of fixed size items addressed through generational handles.
+// Adding and removing are O(1); removal swaps the last item into the hole, so dense
+// indices are only stable until the next removal.
+typedef struct {
+    unsigned char* items;
+    uint32_t*      itemSlots;   // dense index -> slot index
+    size_t         itemSize;
+    uint32_t       count;
+    uint32_t       capacity;
+
+    PoolSlot*      slots;
+    uint32_t       slotCount;
+    uint32_t       slotCapacity;
+    uint32_t       freeSlot;
+} Pool;
+
+void   pool_init(Pool* pool, size_t itemSize);
+void   pool_free(Pool* pool);
+Handle pool_add(Pool* pool, const void* item);
+bool   pool_remove(Pool* pool, Handle handle);
+bool   pool_is_valid(const Pool* pool, Handle handle);
+void*  pool_get(Pool* pool, Handle handle);
+void*  pool_at(Pool* pool, uint32_t denseIndex);
+Handle pool_handle_at(const Pool* pool, uint32_t denseIndex);
+
+static inline bool handle_equals(Handle a, Handle b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+#endif
@@ -1,10 +1,11 @@
 #include "primitives.h"
+#include "memstats.h"
 #include <stdlib.h>
 
 float* generate_cube(int* vertexCount) {
     *vertexCount = 36; // 6 faces (2 triangles for each, 3 vertices for each)
 
-    float* vertices = (float*)malloc(sizeof(float) * (*vertexCount) * 5);
+    float* vertices = (float*)mem_alloc(MEMORY_MESH, sizeof(float) * (*vertexCount) * 5);
 
     float cubeVertices[] = {
         // positions          // texture coords
@@ -65,7 +66,7 @@ float* generate_cube(int* vertexCount) {
 float* generate_plane(int* vertexCount) {
     *vertexCount = 6; // 2 triangles, 3 vertices each
 
-    float* vertices = (float*)malloc(sizeof(float) * (*vertexCount) * 5); // 5 values per vertex (x, y, z, u, v)
+    float* vertices = (float*)mem_alloc(MEMORY_MESH, sizeof(float) * (*vertexCount) * 5); // 5 values per vertex (x, y, z, u, v)
 
     float planeVertices[] = {
         // positions          // texture coords
@@ -3,6 +3,7 @@
 
 #include <string.h>
 
+// Both return x, y, z, u, v vertices tagged MEMORY_MESH, released with mem_free
 float* generate_cube(int* vertexCount);
 float* generate_plane(int* vertexCount);
 
@@ -0,0 +1,169 @@
+#include "profiler.h"
+#include "jobs.h"
+#include "platform.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    const char* name;
+    double      start;
+    double      duration;
+} ProfileEvent;
+
+// Written only by its own thread, so recording never takes a lock. The exporter reads
+// up to head, which is published after the event it counts.
+typedef struct {
+    ProfileEvent* events;
+    atomic_uint   head;                         // events ever recorded
+    const char*   names[PROFILER_MAX_DEPTH];    // open scopes
+    double        starts[PROFILER_MAX_DEPTH];
+    int           depth;
+} ProfileRing;
+
+static struct {
+    ProfileRing rings[MAX_JOB_THREADS + PROFILER_EXTRA_THREADS];
+    const char* names[MAX_JOB_THREADS + PROFILER_EXTRA_THREADS];    // NULL for job threads
+    int         ringCount;
+    atomic_bool enabled;
+    double      epoch;                          // trace timestamps count from here
+} profiler;
+
+static THREAD_LOCAL int boundRing = -1;
+
+static bool ring_init(ProfileRing* ring) {
+    ring->events = (ProfileEvent*)malloc(PROFILER_RING_EVENTS * sizeof(ProfileEvent));
+    if (!ring->events) {
+        fprintf(stderr, "ERROR: Failed to allocate profiler ring\n");
+        return false;
+    }
+    atomic_init(&ring->head, 0);
+    ring->depth = 0;
+    return true;
+}
+
+void profiler_init(void) {
+    int threads = jobs_thread_count();
+    if (threads < 1) threads = 1;
+
+    profiler.ringCount = 0;
+    for (int i = 0; i < threads; i++) {
+        if (!ring_init(&profiler.rings[i])) break;
+        profiler.names[i] = NULL;
+        profiler.ringCount++;
+    }
+
+    atomic_init(&profiler.enabled, false);
+    profiler.epoch = platform_time();
+}
+
+void profiler_shutdown(void) {
+    atomic_store(&profiler.enabled, false);
+    for (int i = 0; i < profiler.ringCount; i++) {
+        free(profiler.rings[i].events);
+        profiler.rings[i].events = NULL;
+    }
+    profiler.ringCount = 0;
+}
+
+void profiler_set_enabled(bool enabled) {
+    atomic_store(&profiler.enabled, enabled && profiler.ringCount > 0);
+}
+
+int profiler_add_thread(const char* name) {
+    int index = profiler.ringCount;
+    if (index == 0 || index >= MAX_JOB_THREADS + PROFILER_EXTRA_THREADS) return -1;
+    if (!ring_init(&profiler.rings[index])) return -1;
+
+    profiler.names[index] = name;
+    profiler.ringCount++;
+    return index;
+}
+
+void profiler_bind_thread(int ring) {
+    // Past every ring, so a thread that didn't get one is ignored rather than sharing
+    boundRing = ring >= 0 ? ring : MAX_JOB_THREADS + PROFILER_EXTRA_THREADS;
+}
+
+// Unbound threads outside the job system (and everything before jobs_init) share the main thread's ring
+static ProfileRing* current_ring(void) {
+    int index = boundRing >= 0 ? boundRing : jobs_thread_index();
+    if (index < 0) index = 0;
+    return index < profiler.ringCount ? &profiler.rings[index] : NULL;
+}
+
+static void push_event(ProfileRing* ring, const char* name, double start, double end) {
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ProfileEvent* event = &ring->events[head % PROFILER_RING_EVENTS];
+    event->name = name;
+    event->start = start;
+    event->duration = end - start;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// Depth is tracked even while disabled, so toggling recording mid-scope can't unbalance it
+void profiler_begin(const char* name) {
+    ProfileRing* ring = current_ring();
+    if (!ring) return;
+
+    if (ring->depth < PROFILER_MAX_DEPTH) {
+        bool enabled = atomic_load_explicit(&profiler.enabled, memory_order_relaxed);
+        ring->names[ring->depth] = enabled ? name : NULL;
+        ring->starts[ring->depth] = enabled ? platform_time() : 0.0;
+    }
+    ring->depth++;
+}
+
+void profiler_end(void) {
+    ProfileRing* ring = current_ring();
+    if (!ring || ring->depth == 0) return;
+
+    ring->depth--;
+    if (ring->depth < PROFILER_MAX_DEPTH && ring->names[ring->depth]) {
+        push_event(ring, ring->names[ring->depth], ring->starts[ring->depth], platform_time());
+    }
+}
+
+void profiler_record(const char* name, double start, double end) {
+    if (!atomic_load_explicit(&profiler.enabled, memory_order_relaxed)) return;
+
+    ProfileRing* ring = current_ring();
+    if (ring) push_event(ring, name, start, end);
+}
+
+bool profiler_write_trace(const char* path) {
+    profiler_set_enabled(false);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "ERROR: Failed to open trace file '%s'\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"crab\"}}");
+
+    for (int t = 0; t < profiler.ringCount; t++) {
+        ProfileRing* ring = &profiler.rings[t];
+        char threadName[32];
+        if (profiler.names[t]) snprintf(threadName, sizeof(threadName), "%s", profiler.names[t]);
+        else if (t == 0) snprintf(threadName, sizeof(threadName), "main");
+        else snprintf(threadName, sizeof(threadName), "worker %d", t);
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                      "\"args\": {\"name\": \"%s\"}}", t, threadName);
+
+        unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        unsigned int count = head < PROFILER_RING_EVENTS ? head : PROFILER_RING_EVENTS;
+
+        for (unsigned int i = head - count; i != head; i++) {
+            const ProfileEvent* event = &ring->events[i % PROFILER_RING_EVENTS];
+            // Microseconds, as the format expects
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    event->name, t, 1e6 * (event->start - profiler.epoch), 1e6 * event->duration);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return true;
+}
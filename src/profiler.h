@@ -0,0 +1,40 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+#define PROFILER_RING_EVENTS 16384  // per thread; once full the oldest scopes are overwritten
+#define PROFILER_MAX_DEPTH 32       // nesting deeper than this is counted but not recorded
+#define PROFILER_EXTRA_THREADS 4    // long-lived threads outside the job system, like the render thread
+
+// Scopes must nest on each thread and take names that outlive the capture, like string
+// literals. Without CRAB_PROFILE defined they compile to nothing.
+#ifdef CRAB_PROFILE
+#define PROFILE_BEGIN(name)              profiler_begin(name)
+#define PROFILE_END()                    profiler_end()
+#define PROFILE_RECORD(name, start, end) profiler_record(name, start, end)
+#else
+#define PROFILE_BEGIN(name)              ((void)0)
+#define PROFILE_END()                    ((void)0)
+#define PROFILE_RECORD(name, start, end) ((void)0)
+#endif
+
+// Records nothing until enabled. Call after jobs_init, so every worker gets a ring.
+void profiler_init(void);
+void profiler_shutdown(void);
+void profiler_set_enabled(bool enabled);
+// Gives a thread outside the job system its own ring: add it from the main thread, then bind
+// the returned ring on the new thread. Returns -1 when out of rings; the thread then records nothing.
+int  profiler_add_thread(const char* name);
+void profiler_bind_thread(int ring);
+
+void profiler_begin(const char* name);
+void profiler_end(void);
+// A scope already timed elsewhere, with platform_time() stamps
+void profiler_record(const char* name, double start, double end);
+
+// Writes the recorded scopes as Chrome Trace Event JSON, for chrome://tracing or Perfetto.
+// Stops recording first; the workers must be idle.
+bool profiler_write_trace(const char* path);
+
+#endif
@@ -0,0 +1,193 @@
+#include "raycast.h"
+#include <float.h>
+#include <math.h>
+
+#define QUERY_BATCH 256 // proxies
+
+typedef struct {
+    const Physics* physics;
+    const Ray*     ray;
+    RaycastHit*    hits;
+    uint32_t       hitCount;
+    uint32_t       maxHits;
+    bool           any;
+    vec3           normal;      // of the closest hit so far
+} RaycastTask;
+
+static void gather_queries(int start, int end, void* data) {
+    Physics* physics = (Physics*)data;
+
+    for (int i = start; i < end; i++) {
+        const PhysicsProxy* proxy = &physics->proxies[i];
+        QueryProxy* query = &physics->queryProxies[i];
+        query->entity = proxy->entity;
+        query->category = proxy->collider->category;
+        query->box = proxy->collider->box;
+        query->mesh = proxy->collider->mesh;
+        if (query->mesh) glm_mat4_inv(proxy->transform->model, query->inverseModel);
+        physics->queryBounds[i] = proxy->collider->aabb;
+    }
+}
+
+// Snapshots every collider and rebuilds the query tree over their bounds
+void physics_build_queries(Physics* physics) {
+    uint32_t count = physics->proxyCount;
+    physics->queryCount = 0;
+
+    uint32_t boundsCapacity = physics->queryCapacity;
+    if (!physics_reserve((void**)&physics->queryProxies, &physics->queryCapacity, count, sizeof(QueryProxy)) ||
+        !physics_reserve((void**)&physics->queryBounds, &boundsCapacity, physics->queryCapacity, sizeof(AABB))) {
+        return;
+    }
+
+    jobs_parallel_for((int)count, QUERY_BATCH, gather_queries, physics);
+    if (bvh_build(&physics->queryTree, physics->queryBounds, count)) {
+        physics->queryCount = count;
+    }
+}
+
+// Slab test in the box's frame; a ray starting inside hits at 0
+bool raycast_obb(const OBB* box, const vec3 origin, const vec3 direction, float maxDistance, float* distance, vec3 normal) {
+    vec3 offset;
+    glm_vec3_sub((float*)box->center, (float*)origin, offset);
+
+    float near = 0.0f;
+    float far = maxDistance;
+    int nearAxis = -1;
+    float nearSign = 0.0f;
+
+    for (int i = 0; i < 3; i++) {
+        float e = glm_vec3_dot((float*)box->axes[i], offset);
+        float f = glm_vec3_dot((float*)box->axes[i], (float*)direction);
+
+        if (fabsf(f) < 1e-8f) {
+            if (fabsf(e) > box->halfExtents[i]) return false;
+            continue;
+        }
+
+        float t0 = (e - box->halfExtents[i]) / f;
+        float t1 = (e + box->halfExtents[i]) / f;
+        if (t0 > t1) {
+            float swap = t0;
+            t0 = t1;
+            t1 = swap;
+        }
+
+        if (t0 > near) {
+            near = t0;
+            nearAxis = i;
+            nearSign = f > 0.0f ? -1.0f : 1.0f;
+        }
+        if (t1 < far) far = t1;
+        if (near > far) return false;
+    }
+
+    *distance = near;
+    if (nearAxis >= 0) {
+        glm_vec3_scale((float*)box->axes[nearAxis], nearSign, normal);
+    } else {
+        glm_vec3_negate_to((float*)direction, normal);
+    }
+    return true;
+}
+
+// Distance to one proxy, or -1 on a miss
+static float raycast_proxy(const QueryProxy* proxy, const Ray* ray, float maxDistance, vec3 normal) {
+    float distance;
+    if (!raycast_obb(&proxy->box, ray->origin, ray->direction, maxDistance, &distance, normal)) return -1.0f;
+    if (!ray->triangles || !proxy->mesh) return distance;
+
+    // The inverse model is affine, so distance along the mesh-space ray stays in world units
+    vec3 origin, direction, localNormal;
+    glm_mat4_mulv3((vec4*)proxy->inverseModel, (float*)ray->origin, 1.0f, origin);
+    glm_mat4_mulv3((vec4*)proxy->inverseModel, (float*)ray->direction, 0.0f, direction);
+    if (!mesh_raycast(proxy->mesh, origin, direction, maxDistance, &distance, localNormal)) return -1.0f;
+
+    // Normals transform by the inverse transpose
+    mat3 inverse, transpose;
+    glm_mat4_pick3((vec4*)proxy->inverseModel, inverse);
+    glm_mat3_transpose_to(inverse, transpose);
+    glm_mat3_mulv(transpose, localNormal, normal);
+    glm_vec3_normalize(normal);
+    if (glm_vec3_dot(normal, (float*)ray->direction) > 0.0f) glm_vec3_negate(normal);
+    return distance;
+}
+
+static float raycast_closest(uint32_t primitive, const vec3 origin, const vec3 direction, float maxDistance, void* data) {
+    RaycastTask* task = (RaycastTask*)data;
+    (void)origin;    // the proxy's own transform gives the mesh-space ray
+    (void)direction;
+    const QueryProxy* proxy = &task->physics->queryProxies[primitive];
+    if (!(proxy->category & task->ray->mask)) return -1.0f;
+
+    vec3 normal;
+    float distance = raycast_proxy(proxy, task->ray, maxDistance, normal);
+    if (distance < 0.0f || distance >= maxDistance) return -1.0f;
+
+    glm_vec3_copy(normal, task->normal);
+    return task->any ? 0.0f : distance;
+}
+
+static void fill_hit(const Ray* ray, const QueryProxy* proxy, float distance, const vec3 normal, RaycastHit* hit) {
+    hit->entity = proxy->entity;
+    hit->distance = distance;
+    glm_vec3_copy((float*)ray->origin, hit->point);
+    glm_vec3_muladds((float*)ray->direction, distance, hit->point);
+    glm_vec3_copy((float*)normal, hit->normal);
+}
+
+bool physics_raycast(const Physics* physics, const Ray* ray, RaycastHit* hit) {
+    RaycastTask task = {physics, ray, NULL, 0, 0, false, {0.0f, 0.0f, 0.0f}};
+
+    float distance;
+    uint32_t index = bvh_raycast(&physics->queryTree, ray->origin, ray->direction, ray->maxDistance,
+                                 raycast_closest, &task, &distance);
+    if (index == UINT32_MAX) return false;
+
+    if (hit) fill_hit(ray, &physics->queryProxies[index], distance, task.normal, hit);
+    return true;
+}
+
+bool physics_raycast_any(const Physics* physics, const Ray* ray) {
+    RaycastTask task = {physics, ray, NULL, 0, 0, true, {0.0f, 0.0f, 0.0f}};
+
+    float distance;
+    return bvh_raycast(&physics->queryTree, ray->origin, ray->direction, ray->maxDistance,
+                       raycast_closest, &task, &distance) != UINT32_MAX;
+}
+
+// Records every hit, keeping the nearest maxHits sorted, and never shortens the ray
+static float raycast_collect(uint32_t primitive, const vec3 origin, const vec3 direction, float maxDistance, void* data) {
+    RaycastTask* task = (RaycastTask*)data;
+    (void)origin;
+    (void)direction;
+    const QueryProxy* proxy = &task->physics->queryProxies[primitive];
+    if (!(proxy->category & task->ray->mask)) return -1.0f;
+
+    vec3 normal;
+    float distance = raycast_proxy(proxy, task->ray, maxDistance, normal);
+    if (distance < 0.0f) return -1.0f;
+
+    uint32_t slot = task->hitCount;
+    if (slot == task->maxHits) {
+        if (slot == 0 || distance >= task->hits[slot - 1].distance) return -1.0f;
+        slot--;
+    } else {
+        task->hitCount++;
+    }
+
+    while (slot > 0 && task->hits[slot - 1].distance > distance) {
+        task->hits[slot] = task->hits[slot - 1];
+        slot--;
+    }
+    fill_hit(task->ray, proxy, distance, normal, &task->hits[slot]);
+    return -1.0f;
+}
+
+uint32_t physics_raycast_all(const Physics* physics, const Ray* ray, RaycastHit* hits, uint32_t maxHits) {
+    RaycastTask task = {physics, ray, hits, 0, maxHits, false, {0.0f, 0.0f, 0.0f}};
+
+    float distance;
+    bvh_raycast(&physics->queryTree, ray->origin, ray->direction, ray->maxDistance, raycast_collect, &task, &distance);
+    return task.hitCount;
+}
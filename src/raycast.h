@@ -0,0 +1,30 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include "physics.h"
+
+typedef struct {
+    vec3     origin;
+    vec3     direction;     // unit length
+    float    maxDistance;
+    uint32_t mask;          // colliders need a category bit in common with this
+    bool     triangles;     // test mesh triangles rather than stopping at their boxes
+} Ray;
+
+typedef struct {
+    Entity entity;
+    float  distance;
+    vec3   point;
+    vec3   normal;          // faces back along the ray
+} RaycastHit;
+
+// Queries run against the snapshot taken at the end of the last physics step. They only
+// read it, so any number may run concurrently, e.g. from a jobs_parallel_for.
+bool     physics_raycast(const Physics* physics, const Ray* ray, RaycastHit* hit);
+bool     physics_raycast_any(const Physics* physics, const Ray* ray);
+// Nearest maxHits hits in order of distance, returning how many were written
+uint32_t physics_raycast_all(const Physics* physics, const Ray* ray, RaycastHit* hits, uint32_t maxHits);
+
+bool raycast_obb(const OBB* box, const vec3 origin, const vec3 direction, float maxDistance, float* distance, vec3 normal);
+
+#endif
@@ -0,0 +1,26 @@
+#include "renderer.h"
+#include "profiler.h"
+
+// Apart from the render thread so that windowless builds, which load with no renderer running,
+// still link it
+Renderer* rendererRunning = NULL;
+THREAD_LOCAL bool rendererOwnsContext = false;
+
+void renderer_call(RenderTask task, void* user) {
+    Renderer* renderer = rendererRunning;
+    if (!renderer || rendererOwnsContext) {
+        task(user);
+        return;
+    }
+
+    PROFILE_BEGIN("wait render call");
+    mutex_lock(renderer->mutex);
+    renderer->task = task;
+    renderer->taskUser = user;
+    condvar_broadcast(renderer->condvar);
+    while (renderer->task) {
+        condvar_wait(renderer->condvar, renderer->mutex);
+    }
+    mutex_unlock(renderer->mutex);
+    PROFILE_END();
+}
@@ -0,0 +1,131 @@
+#include "renderer.h"
+#include "profiler.h"
+
+static void render_thread(void* arg) {
+    Renderer* renderer = (Renderer*)arg;
+    profiler_bind_thread(renderer->profilerRing);
+    glfwMakeContextCurrent(renderer->window);
+    rendererOwnsContext = true;
+
+    mutex_lock(renderer->mutex);
+    for (;;) {
+        while (renderer->pending < 0 && !renderer->task && !renderer->quit) {
+            condvar_wait(renderer->condvar, renderer->mutex);
+        }
+
+        // Frames go first, so work handed over never changes what a frame built before it draws
+        if (renderer->pending < 0 && renderer->task) {
+            RenderTask task = renderer->task;
+            mutex_unlock(renderer->mutex);
+            task(renderer->taskUser);
+            mutex_lock(renderer->mutex);
+            renderer->task = NULL;
+            condvar_broadcast(renderer->condvar);
+            continue;
+        }
+        // Quitting only once nothing is left, so the last submitted frame still shows
+        if (renderer->pending < 0) break;
+
+        int index = renderer->pending;
+        renderer->pending = -1;
+        condvar_broadcast(renderer->condvar);
+        mutex_unlock(renderer->mutex);
+
+        PROFILE_BEGIN("render frame");
+        renderer->render(&renderer->frames[index], renderer->user);
+        PROFILE_BEGIN("swap");
+        glfwSwapBuffers(renderer->window);
+        PROFILE_END();
+        PROFILE_END();
+
+        mutex_lock(renderer->mutex);
+        renderer->busy[index] = false;
+        condvar_broadcast(renderer->condvar);
+    }
+    mutex_unlock(renderer->mutex);
+
+    rendererOwnsContext = false;
+    glfwMakeContextCurrent(NULL);
+}
+
+bool renderer_start(Renderer* renderer, GLFWwindow* window, RenderFunc render, void* user) {
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->window = window;
+    renderer->render = render;
+    renderer->user = user;
+    renderer->pending = -1;
+
+    renderer->mutex = mutex_create();
+    renderer->condvar = condvar_create();
+    if (!renderer->mutex || !renderer->condvar) {
+        fprintf(stderr, "ERROR: Failed to create render thread sync\n");
+        if (renderer->mutex) mutex_destroy(renderer->mutex);
+        if (renderer->condvar) condvar_destroy(renderer->condvar);
+        return false;
+    }
+
+    // A context can only be current on one thread at a time
+    renderer->profilerRing = profiler_add_thread("render");
+    glfwMakeContextCurrent(NULL);
+
+    rendererRunning = renderer;
+    renderer->thread = thread_create(render_thread, renderer);
+    if (!renderer->thread) {
+        fprintf(stderr, "ERROR: Failed to start render thread\n");
+        rendererRunning = NULL;
+        glfwMakeContextCurrent(window);
+        mutex_destroy(renderer->mutex);
+        condvar_destroy(renderer->condvar);
+        return false;
+    }
+    return true;
+}
+
+RenderFrame* renderer_begin_frame(Renderer* renderer) {
+    int index = renderer->next;
+
+    PROFILE_BEGIN("wait render");
+    mutex_lock(renderer->mutex);
+    while (renderer->busy[index]) {
+        condvar_wait(renderer->condvar, renderer->mutex);
+    }
+    mutex_unlock(renderer->mutex);
+    PROFILE_END();
+
+    RenderFrame* frame = &renderer->frames[index];
+    render_frame_reset(frame);
+    return frame;
+}
+
+void renderer_submit(Renderer* renderer) {
+    int index = renderer->next;
+
+    mutex_lock(renderer->mutex);
+    // The render thread is still to take the previous frame; replacing it would leave it busy forever
+    while (renderer->pending >= 0) {
+        condvar_wait(renderer->condvar, renderer->mutex);
+    }
+    renderer->busy[index] = true;
+    renderer->pending = index;
+    condvar_broadcast(renderer->condvar);
+    mutex_unlock(renderer->mutex);
+
+    renderer->next = (index + 1) % RENDERER_FRAMES;
+}
+
+void renderer_stop(Renderer* renderer) {
+    mutex_lock(renderer->mutex);
+    renderer->quit = true;
+    condvar_broadcast(renderer->condvar);
+    mutex_unlock(renderer->mutex);
+
+    thread_join(renderer->thread);
+    rendererRunning = NULL;
+    glfwMakeContextCurrent(renderer->window);
+
+    mutex_destroy(renderer->mutex);
+    condvar_destroy(renderer->condvar);
+    for (int i = 0; i < RENDERER_FRAMES; i++) {
+        render_frame_free(&renderer->frames[i]);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "common.h"
+#include "platform.h"
+#include "renderframe.h"
+
+#define RENDERER_FRAMES 2   // the main thread fills one while the render thread submits the other
+
+// Called on the render thread with the GL context current; the renderer swaps afterwards
+typedef void (*RenderFunc)(RenderFrame* frame, void* user);
+// GL work handed to whichever thread holds the context, see renderer_call
+typedef void (*RenderTask)(void* user);
+
+// Owns the GL context on a thread of its own, so simulating frame N + 1 overlaps submitting
+// frame N. The main thread fills a frame between begin_frame and submit and hands it over.
+typedef struct {
+    GLFWwindow* window;
+    RenderFunc  render;
+    void*       user;
+    Thread*     thread;
+    Mutex*      mutex;
+    CondVar*    condvar;            // signalled on every handover, both ways
+    RenderFrame frames[RENDERER_FRAMES];
+    bool        busy[RENDERER_FRAMES];  // submitted and not yet drawn
+    int         pending;            // submitted frame the render thread hasn't taken, -1 for none
+    int         next;               // frame the main thread fills next
+    bool        quit;
+    RenderTask  task;               // waiting for the render thread, NULL for none
+    void*       taskUser;
+    int         profilerRing;
+} Renderer;
+
+// Takes the window's context away from the calling thread
+bool         renderer_start(Renderer* renderer, GLFWwindow* window, RenderFunc render, void* user);
+// Waits until the frame submitted two frames ago has been drawn, then returns it emptied
+RenderFrame* renderer_begin_frame(Renderer* renderer);
+void         renderer_submit(Renderer* renderer);
+// Draws whatever was submitted, stops the thread and makes the context current here again
+void         renderer_stop(Renderer* renderer);
+// Set by the render thread while it runs and holds the context; there's only one window
+extern Renderer* rendererRunning;
+extern THREAD_LOCAL bool rendererOwnsContext;
+
+// Runs GL work where the context is: right here before renderer_start and after renderer_stop,
+// and otherwise on the render thread once the frames submitted so far are drawn, returning
+// when it's done. Loading, uploading and freeing GPU resources all go through this, so they
+// work at any time from the main thread; each call waits out the frame in flight, so uploads
+// are best done together.
+void         renderer_call(RenderTask task, void* user);
+
+#endif
@@ -0,0 +1,39 @@
+#include "renderframe.h"
+#include "memstats.h"
+
+void render_frame_reset(RenderFrame* frame) {
+    frame->itemCount = 0;
+}
+
+bool render_frame_push(RenderFrame* frame, const Renderable* renderable, mat4 model) {
+    if (frame->itemCount == frame->itemCapacity) {
+        uint32_t capacity = frame->itemCapacity ? frame->itemCapacity * 2 : 256;
+        DrawItem* items = (DrawItem*)mem_realloc(MEMORY_RENDER, frame->items, capacity * sizeof(DrawItem));
+        if (!items) {
+            fprintf(stderr, "ERROR: Failed to grow render frame to %u draws\n", capacity);
+            return false;
+        }
+        frame->items = items;
+        frame->itemCapacity = capacity;
+    }
+
+    DrawItem* item = &frame->items[frame->itemCount++];
+    glm_mat4_copy(model, item->model);
+    item->renderable = *renderable;
+    return true;
+}
+
+void render_frame_capture_ui(RenderFrame* frame, const UI* ui) {
+    frame->ui = *ui;
+    for (int i = 0; i < ui->sliderCount; i++) {
+        frame->sliderValues[i] = *ui->sliders[i].value;
+        frame->ui.sliders[i].value = &frame->sliderValues[i];
+    }
+}
+
+void render_frame_free(RenderFrame* frame) {
+    mem_free(frame->items);
+    frame->items = NULL;
+    frame->itemCount = 0;
+    frame->itemCapacity = 0;
+}
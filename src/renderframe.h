@@ -0,0 +1,46 @@
+#ifndef RENDERFRAME_H
+#define RENDERFRAME_H
+
+#include "common.h"
+#include "components.h"
+#include "overlay.h"
+#include "physics.h"
+#include "ui.h"
+
+typedef struct {
+    mat4       model;
+    Renderable renderable;
+} DrawItem;
+
+// Everything needed to draw one frame, copied out of the simulation so it can move on to the
+// next frame while this one is submitted. The UI goes across as its state rather than as
+// geometry: NanoVG uploads glyphs while it lays out text, so it has to run next to GL.
+typedef struct {
+    mat4      view;
+    mat4      projection;
+    vec3      viewPos;
+    vec3      lightPos;
+    vec3      lightColor;
+    float     time;
+    int       framebufferWidth;     // the window's framebuffer when the frame was built, for the viewport
+    int       framebufferHeight;
+
+    DrawItem* items;            // frustum-culled, in submission order
+    uint32_t  itemCount;
+    uint32_t  itemCapacity;
+
+    UI        ui;               // sliders point into sliderValues
+    float     sliderValues[MAX_SLIDERS];
+    Overlay   overlay;
+    double    physicsStages[PHYSICS_STAGE_COUNT];
+    size_t    memoryBytes;
+    char      debugText[256];
+} RenderFrame;
+
+// Empties the draw list, keeping its storage
+void render_frame_reset(RenderFrame* frame);
+bool render_frame_push(RenderFrame* frame, const Renderable* renderable, mat4 model);
+void render_frame_capture_ui(RenderFrame* frame, const UI* ui);
+void render_frame_free(RenderFrame* frame);
+
+#endif
@@ -0,0 +1,114 @@
+#include "renderstats.h"
+#include "memstats.h"
+
+RenderStats renderStatsFrame;
+static RenderStats renderStatsLast;
+
+// GL names are small and dense, so sizes are looked up by name directly
+typedef struct {
+    size_t* sizes;
+    GLuint  capacity;
+} GpuSizes;
+
+static GpuSizes bufferSizes;
+static GpuSizes textureSizes;       // base level
+static GpuSizes textureTotals;      // base level plus mipmaps, what is charged
+
+void render_stats_end_frame(void) {
+    renderStatsLast = renderStatsFrame;
+    memset(&renderStatsFrame, 0, sizeof(renderStatsFrame));
+}
+
+const RenderStats* render_stats_last(void) {
+    return &renderStatsLast;
+}
+
+static size_t* gpu_size(GpuSizes* sizes, GLuint name) {
+    if (name >= sizes->capacity) {
+        GLuint capacity = sizes->capacity ? sizes->capacity : 64;
+        while (capacity <= name) capacity *= 2;
+
+        size_t* grown = (size_t*)mem_realloc(MEMORY_GENERAL, sizes->sizes, capacity * sizeof(size_t));
+        if (!grown) return NULL;
+        memset(grown + sizes->capacity, 0, (capacity - sizes->capacity) * sizeof(size_t));
+        sizes->sizes = grown;
+        sizes->capacity = capacity;
+    }
+    return &sizes->sizes[name];
+}
+
+// Replaces what a GL object is charged with
+static void gpu_charge(GpuSizes* sizes, MemoryTag tag, GLuint name, size_t bytes) {
+    size_t* size = name ? gpu_size(sizes, name) : NULL;
+    if (!size) return;
+
+    mem_track(tag, (ptrdiff_t)bytes - (ptrdiff_t)*size);
+    *size = bytes;
+}
+
+static GLuint bound_buffer(GLenum target) {
+    GLenum binding;
+    switch (target) {
+        case GL_ARRAY_BUFFER:          binding = GL_ARRAY_BUFFER_BINDING; break;
+        case GL_ELEMENT_ARRAY_BUFFER:  binding = GL_ELEMENT_ARRAY_BUFFER_BINDING; break;
+        case GL_UNIFORM_BUFFER:        binding = GL_UNIFORM_BUFFER_BINDING; break;
+        case GL_SHADER_STORAGE_BUFFER: binding = GL_SHADER_STORAGE_BUFFER_BINDING; break;
+        case GL_DRAW_INDIRECT_BUFFER:  binding = GL_DRAW_INDIRECT_BUFFER_BINDING; break;
+        case GL_COPY_READ_BUFFER:      binding = GL_COPY_READ_BUFFER_BINDING; break;
+        case GL_COPY_WRITE_BUFFER:     binding = GL_COPY_WRITE_BUFFER_BINDING; break;
+        default: return 0;
+    }
+
+    GLint name = 0;
+    glGetIntegerv(binding, &name);
+    return (GLuint)name;
+}
+
+void render_stats_buffer_data(GLenum target, GLsizeiptr size) {
+    renderStatsFrame.uploadBytes += (uint64_t)size;
+    gpu_charge(&bufferSizes, MEMORY_GPU_BUFFER, bound_buffer(target), (size_t)size);
+}
+
+void render_stats_tex_image(GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height) {
+    render_stats_texture(format, width, height);
+    if (target != GL_TEXTURE_2D || level != 0) return;
+
+    GLint name = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &name);
+    size_t* base = name ? gpu_size(&textureSizes, (GLuint)name) : NULL;
+    if (!base) return;
+
+    *base = render_stats_texture_bytes(format, width, height);
+    gpu_charge(&textureTotals, MEMORY_GPU_TEXTURE, (GLuint)name, *base);
+}
+
+void render_stats_generate_mipmap(GLenum target) {
+    if (target != GL_TEXTURE_2D) return;
+
+    GLint name = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &name);
+    size_t* base = name ? gpu_size(&textureSizes, (GLuint)name) : NULL;
+    if (!base) return;
+
+    // A full chain adds a third of the base level
+    gpu_charge(&textureTotals, MEMORY_GPU_TEXTURE, (GLuint)name, *base + *base / 3);
+}
+
+void render_stats_delete_buffers(GLsizei count, const GLuint* buffers) {
+    for (GLsizei i = 0; i < count; i++) {
+        if (buffers[i] < bufferSizes.capacity) {
+            gpu_charge(&bufferSizes, MEMORY_GPU_BUFFER, buffers[i], 0);
+        }
+    }
+}
+
+void render_stats_delete_textures(GLsizei count, const GLuint* textures) {
+    for (GLsizei i = 0; i < count; i++) {
+        if (textures[i] < textureTotals.capacity) {
+            gpu_charge(&textureTotals, MEMORY_GPU_TEXTURE, textures[i], 0);
+        }
+        if (textures[i] < textureSizes.capacity) {
+            textureSizes.sizes[textures[i]] = 0;
+        }
+    }
+}
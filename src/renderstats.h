@@ -0,0 +1,158 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include "common.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint32_t drawCalls;
+    uint32_t triangles;
+    uint32_t stateChanges;      // program, texture, buffer and vertex array binds, fixed-function state
+    uint32_t uniformUploads;
+    uint64_t uploadBytes;       // buffer and texture data sent to the GPU
+} RenderStats;
+
+// Totals for the frame being recorded. Only the render thread, which owns the GL context once
+// renderer_start has run, calls GL and counts here; other threads hand it GL work through
+// renderer_call.
+extern RenderStats renderStatsFrame;
+
+// Publishes this frame's totals and starts counting the next
+void render_stats_end_frame(void);
+// Totals of the last complete frame, all zero without CRAB_RENDER_STATS
+const RenderStats* render_stats_last(void);
+
+static inline void render_stats_draw(GLenum mode, GLsizei count) {
+    renderStatsFrame.drawCalls++;
+    if (mode == GL_TRIANGLES) {
+        renderStatsFrame.triangles += count / 3;
+    } else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2) {
+        renderStatsFrame.triangles += count - 2;
+    }
+}
+
+// 8-bit formats only, which is all the engine and NanoVG upload
+static inline size_t render_stats_texture_bytes(GLenum format, GLsizei width, GLsizei height) {
+    int channels = format == GL_RGBA ? 4 : format == GL_RGB ? 3 : format == GL_RG ? 2 : 1;
+    return (size_t)width * height * channels;
+}
+
+static inline void render_stats_texture(GLenum format, GLsizei width, GLsizei height) {
+    renderStatsFrame.uploadBytes += render_stats_texture_bytes(format, width, height);
+}
+
+static inline void render_stats_indirect(uint32_t triangles) {
+#ifdef CRAB_RENDER_STATS
+    renderStatsFrame.triangles += triangles;
+#else
+    (void)triangles;
+#endif
+}
+
+// Estimated GPU memory, charged to MEMORY_GPU_BUFFER and MEMORY_GPU_TEXTURE. Sizes are kept
+// per GL name so respecifying or deleting an object gives back what it held.
+void render_stats_buffer_data(GLenum target, GLsizeiptr size);
+void render_stats_tex_image(GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height);
+void render_stats_generate_mipmap(GLenum target);
+void render_stats_delete_buffers(GLsizei count, const GLuint* buffers);
+void render_stats_delete_textures(GLsizei count, const GLuint* textures);
+
+// Including this after glad routes the GL calls made below it through the counters. It goes
+// into every file that renders, including main.c ahead of NanoVG's GL backend.
+#ifdef CRAB_RENDER_STATS
+
+#define RENDER_STATS_STATE(call)   (renderStatsFrame.stateChanges++, call)
+#define RENDER_STATS_UNIFORM(call) (renderStatsFrame.uniformUploads++, call)
+
+#undef glDrawArrays
+#define glDrawArrays(mode, first, count) \
+    (render_stats_draw(mode, count), glad_glDrawArrays(mode, first, count))
+#undef glDrawElements
+#define glDrawElements(mode, count, type, indices) \
+    (render_stats_draw(mode, count), glad_glDrawElements(mode, count, type, indices))
+
+#undef glDrawElementsBaseVertex
+#define glDrawElementsBaseVertex(mode, count, type, indices, baseVertex) \
+    (render_stats_draw(mode, count), glad_glDrawElementsBaseVertex(mode, count, type, indices, baseVertex))
+// The commands are in GPU memory, so the caller adds their triangles with render_stats_indirect
+#undef glMultiDrawElementsIndirect
+#define glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride) \
+    (renderStatsFrame.drawCalls++, glad_glMultiDrawElementsIndirect(mode, type, indirect, drawCount, stride))
+
+#undef glBufferData
+#define glBufferData(target, size, data, usage) \
+    (render_stats_buffer_data(target, size), glad_glBufferData(target, size, data, usage))
+#undef glBufferSubData
+#define glBufferSubData(target, offset, size, data) \
+    (renderStatsFrame.uploadBytes += (uint64_t)(size), glad_glBufferSubData(target, offset, size, data))
+#undef glTexImage2D
+#define glTexImage2D(target, level, internal, width, height, border, format, type, data) \
+    (render_stats_tex_image(target, level, format, width, height), \
+     glad_glTexImage2D(target, level, internal, width, height, border, format, type, data))
+#undef glTexSubImage2D
+#define glTexSubImage2D(target, level, x, y, width, height, format, type, data) \
+    (render_stats_texture(format, width, height), \
+     glad_glTexSubImage2D(target, level, x, y, width, height, format, type, data))
+#undef glGenerateMipmap
+#define glGenerateMipmap(target) (render_stats_generate_mipmap(target), glad_glGenerateMipmap(target))
+#undef glDeleteBuffers
+#define glDeleteBuffers(count, buffers) \
+    (render_stats_delete_buffers(count, buffers), glad_glDeleteBuffers(count, buffers))
+#undef glDeleteTextures
+#define glDeleteTextures(count, textures) \
+    (render_stats_delete_textures(count, textures), glad_glDeleteTextures(count, textures))
+
+#undef glUseProgram
+#define glUseProgram(...) RENDER_STATS_STATE(glad_glUseProgram(__VA_ARGS__))
+#undef glBindTexture
+#define glBindTexture(...) RENDER_STATS_STATE(glad_glBindTexture(__VA_ARGS__))
+#undef glActiveTexture
+#define glActiveTexture(...) RENDER_STATS_STATE(glad_glActiveTexture(__VA_ARGS__))
+#undef glBindVertexArray
+#define glBindVertexArray(...) RENDER_STATS_STATE(glad_glBindVertexArray(__VA_ARGS__))
+#undef glBindBuffer
+#define glBindBuffer(...) RENDER_STATS_STATE(glad_glBindBuffer(__VA_ARGS__))
+#undef glBindBufferRange
+#define glBindBufferRange(...) RENDER_STATS_STATE(glad_glBindBufferRange(__VA_ARGS__))
+#undef glEnable
+#define glEnable(...) RENDER_STATS_STATE(glad_glEnable(__VA_ARGS__))
+#undef glDisable
+#define glDisable(...) RENDER_STATS_STATE(glad_glDisable(__VA_ARGS__))
+#undef glBlendFunc
+#define glBlendFunc(...) RENDER_STATS_STATE(glad_glBlendFunc(__VA_ARGS__))
+#undef glBlendFuncSeparate
+#define glBlendFuncSeparate(...) RENDER_STATS_STATE(glad_glBlendFuncSeparate(__VA_ARGS__))
+#undef glColorMask
+#define glColorMask(...) RENDER_STATS_STATE(glad_glColorMask(__VA_ARGS__))
+#undef glCullFace
+#define glCullFace(...) RENDER_STATS_STATE(glad_glCullFace(__VA_ARGS__))
+#undef glFrontFace
+#define glFrontFace(...) RENDER_STATS_STATE(glad_glFrontFace(__VA_ARGS__))
+#undef glStencilFunc
+#define glStencilFunc(...) RENDER_STATS_STATE(glad_glStencilFunc(__VA_ARGS__))
+#undef glStencilMask
+#define glStencilMask(...) RENDER_STATS_STATE(glad_glStencilMask(__VA_ARGS__))
+#undef glStencilOp
+#define glStencilOp(...) RENDER_STATS_STATE(glad_glStencilOp(__VA_ARGS__))
+#undef glStencilOpSeparate
+#define glStencilOpSeparate(...) RENDER_STATS_STATE(glad_glStencilOpSeparate(__VA_ARGS__))
+
+#undef glUniform1f
+#define glUniform1f(...) RENDER_STATS_UNIFORM(glad_glUniform1f(__VA_ARGS__))
+#undef glUniform1i
+#define glUniform1i(...) RENDER_STATS_UNIFORM(glad_glUniform1i(__VA_ARGS__))
+#undef glUniform2fv
+#define glUniform2fv(...) RENDER_STATS_UNIFORM(glad_glUniform2fv(__VA_ARGS__))
+#undef glUniform3f
+#define glUniform3f(...) RENDER_STATS_UNIFORM(glad_glUniform3f(__VA_ARGS__))
+#undef glUniform3fv
+#define glUniform3fv(...) RENDER_STATS_UNIFORM(glad_glUniform3fv(__VA_ARGS__))
+#undef glUniform4fv
+#define glUniform4fv(...) RENDER_STATS_UNIFORM(glad_glUniform4fv(__VA_ARGS__))
+#undef glUniformMatrix4fv
+#define glUniformMatrix4fv(...) RENDER_STATS_UNIFORM(glad_glUniformMatrix4fv(__VA_ARGS__))
+
+#endif // CRAB_RENDER_STATS
+
+#endif
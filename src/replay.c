@@ -0,0 +1,116 @@
+#include "replay.h"
+#include <string.h>
+
+#define REPLAY_MAGIC "CRBI"
+#define REPLAY_VERSION 1u
+#define REPLAY_HEADER_SIZE 12   // magic, version, fixed step
+#define REPLAY_RECORD_SIZE 18   // delta time, keys, buttons, cursor x and y, scroll
+
+// Every multi-byte field is stored little-endian, whatever the host's order
+static uint8_t* put_u32(uint8_t* bytes, uint32_t value) {
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+    return bytes + 4;
+}
+
+static uint8_t* put_float(uint8_t* bytes, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return put_u32(bytes, bits);
+}
+
+static const uint8_t* get_u32(const uint8_t* bytes, uint32_t* value) {
+    *value = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    return bytes + 4;
+}
+
+static const uint8_t* get_float(const uint8_t* bytes, float* value) {
+    uint32_t bits;
+    bytes = get_u32(bytes, &bits);
+    memcpy(value, &bits, sizeof(*value));
+    return bytes;
+}
+
+bool replay_create(Replay* replay, const char* path, float fixedStep) {
+    memset(replay, 0, sizeof(*replay));
+    replay->file = fopen(path, "wb");
+    if (!replay->file) {
+        fprintf(stderr, "ERROR: Failed to create replay %s\n", path);
+        return false;
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    memcpy(header, REPLAY_MAGIC, 4);
+    put_float(put_u32(header + 4, REPLAY_VERSION), fixedStep);
+    replay->fixedStep = fixedStep;
+
+    if (fwrite(header, sizeof(header), 1, replay->file) != 1) {
+        fprintf(stderr, "ERROR: Failed to write replay header to %s\n", path);
+        replay_close(replay);
+        return false;
+    }
+    return true;
+}
+
+bool replay_open(Replay* replay, const char* path) {
+    memset(replay, 0, sizeof(*replay));
+    replay->file = fopen(path, "rb");
+    if (!replay->file) {
+        fprintf(stderr, "ERROR: Failed to open replay %s\n", path);
+        return false;
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    uint32_t version = 0;
+    float fixedStep = 0.0f;
+    bool read = fread(header, sizeof(header), 1, replay->file) == 1;
+    if (read) get_float(get_u32(header + 4, &version), &fixedStep);
+    if (!read || memcmp(header, REPLAY_MAGIC, 4) != 0 || version != REPLAY_VERSION || !(fixedStep > 0.0f)) {
+        fprintf(stderr, "ERROR: %s is not a replay this build can play\n", path);
+        replay_close(replay);
+        return false;
+    }
+
+    replay->fixedStep = fixedStep;
+    return true;
+}
+
+bool replay_write(Replay* replay, const InputFrame* frame) {
+    uint8_t record[REPLAY_RECORD_SIZE];
+    uint8_t* bytes = put_float(record, frame->deltaTime);
+    *bytes++ = frame->keys;
+    *bytes++ = frame->buttons;
+    bytes = put_float(bytes, frame->cursorX);
+    bytes = put_float(bytes, frame->cursorY);
+    put_float(bytes, frame->scroll);
+
+    if (fwrite(record, sizeof(record), 1, replay->file) != 1) {
+        fprintf(stderr, "ERROR: Failed to write replay frame %u\n", replay->frameCount);
+        return false;
+    }
+
+    replay->frameCount++;
+    return true;
+}
+
+bool replay_read(Replay* replay, InputFrame* frame) {
+    uint8_t record[REPLAY_RECORD_SIZE];
+    if (fread(record, sizeof(record), 1, replay->file) != 1) return false;
+
+    const uint8_t* bytes = get_float(record, &frame->deltaTime);
+    frame->keys = *bytes++;
+    frame->buttons = *bytes++;
+    bytes = get_float(bytes, &frame->cursorX);
+    bytes = get_float(bytes, &frame->cursorY);
+    get_float(bytes, &frame->scroll);
+
+    replay->frameCount++;
+    return true;
+}
+
+void replay_close(Replay* replay) {
+    if (replay->file) fclose(replay->file);
+    replay->file = NULL;
+}
@@ -0,0 +1,42 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define INPUT_KEY_FORWARD   (1u << 0)
+#define INPUT_KEY_BACKWARD  (1u << 1)
+#define INPUT_KEY_LEFT      (1u << 2)
+#define INPUT_KEY_RIGHT     (1u << 3)
+#define INPUT_KEY_QUIT      (1u << 4)
+
+#define INPUT_BUTTON_LEFT   (1u << 0)
+#define INPUT_BUTTON_MIDDLE (1u << 1)
+
+// Everything a frame reads from the player, so a session can be recorded and played back
+typedef struct {
+    float    deltaTime;
+    uint8_t  keys;      // INPUT_KEY_*
+    uint8_t  buttons;   // INPUT_BUTTON_*
+    float    cursorX, cursorY;
+    float    scroll;
+} InputFrame;
+
+// Binary log of input frames: a header with the fixed step the session ran at, then one
+// packed record per frame. Fields are serialized little-endian byte by byte, header
+// included, so a log plays back on any host
+typedef struct {
+    FILE*    file;
+    float    fixedStep;
+    uint32_t frameCount;
+} Replay;
+
+bool replay_create(Replay* replay, const char* path, float fixedStep);
+bool replay_open(Replay* replay, const char* path);
+bool replay_write(Replay* replay, const InputFrame* frame);
+// Returns false at the end of the log
+bool replay_read(Replay* replay, InputFrame* frame);
+void replay_close(Replay* replay);
+
+#endif
@@ -1,4 +1,6 @@
 #include "shader.h"
+#include "memstats.h"
+#include "renderstats.h"
 
 char *read_file(const char *path)
 {
@@ -13,7 +15,7 @@ char *read_file(const char *path)
 	size_t fileSize = ftell(file);
 	rewind(file);
 
-	char *buffer = (char *)malloc(fileSize + 1);
+	char *buffer = (char *)mem_alloc(MEMORY_SHADER, fileSize + 1);
 	if (buffer == NULL)
 	{
 		fprintf(stderr, "Not enough memory to read \"%s\".\n", path);
@@ -82,8 +84,8 @@ void s_load(Shader *shader, const char *vert_path, const char *frag_path)
 
 	printf("INFO: Successfully loaded shader file: %s, %s\n", vert_path, frag_path);
 
-	free(vert_code);
-	free(frag_code);
+	mem_free(vert_code);
+	mem_free(frag_code);
 }
 
 void s_destroy(Shader *shader)
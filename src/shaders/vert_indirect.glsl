@@ -0,0 +1,37 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in uint aDrawId;  // per instance, so each command's baseInstance selects it
+
+struct DrawData {
+    mat4 model;
+    vec4 colorScale;    // rgb color, texture scale in w
+    ivec4 flags;        // x: has texture
+};
+
+layout (std430, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+
+out vec2 TexCoord;
+out vec3 Normal;
+out vec3 FragPos;
+out vec3 Color;
+flat out float TextureScale;
+flat out int HasTexture;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    DrawData draw = draws[aDrawId];
+    gl_Position = projection * view * draw.model * vec4(aPos, 1.0);
+    TexCoord = aTexCoord;
+    Normal = mat3(transpose(inverse(draw.model))) * aNormal;
+    FragPos = vec3(draw.model * vec4(aPos, 1.0));
+    Color = draw.colorScale.rgb;
+    TextureScale = draw.colorScale.w;
+    HasTexture = draw.flags.x;
+}
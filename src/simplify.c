@@ -0,0 +1,374 @@
+#include "simplify.h"
+#include "memstats.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPLIFY_MAX_PASSES 64
+#define SIMPLIFY_MIN_COSINE 0.25    // collapses may turn a triangle by up to about 75 degrees
+#define NO_VERTEX UINT32_MAX
+
+// Symmetric 4x4 matrix summing squared distances to planes: a², ab, ac, ad, b², bc, bd, c², cd, d²
+typedef struct {
+    double m[10];
+} Quadric;
+
+// One position moving onto a neighbouring one
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    double   cost;
+} Collapse;
+
+static void quadric_add_plane(Quadric* q, const double n[3], double d, double weight) {
+    q->m[0] += weight * n[0] * n[0];
+    q->m[1] += weight * n[0] * n[1];
+    q->m[2] += weight * n[0] * n[2];
+    q->m[3] += weight * n[0] * d;
+    q->m[4] += weight * n[1] * n[1];
+    q->m[5] += weight * n[1] * n[2];
+    q->m[6] += weight * n[1] * d;
+    q->m[7] += weight * n[2] * n[2];
+    q->m[8] += weight * n[2] * d;
+    q->m[9] += weight * d * d;
+}
+
+static void quadric_add(Quadric* q, const Quadric* other) {
+    for (int i = 0; i < 10; i++) q->m[i] += other->m[i];
+}
+
+static double quadric_error(const Quadric* q, const float* p) {
+    const double* m = q->m;
+    double x = p[0], y = p[1], z = p[2];
+    double error = m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+                 + m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+                 + m[7] * z * z + 2.0 * m[8] * z
+                 + m[9];
+    return fabs(error);
+}
+
+static uint32_t hash_u32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Open addressing tables stay under half full
+static uint32_t table_size(uint32_t count) {
+    uint32_t size = 16;
+    while (size < count * 2) size *= 2;
+    return size;
+}
+
+// remap[v] is the first vertex at v's position; wedges[v] rings through every vertex at it
+static bool weld_positions(const float* vertices, uint32_t vertexCount, uint32_t stride, uint32_t* remap, uint32_t* wedges) {
+    uint32_t size = table_size(vertexCount);
+    uint32_t* table = (uint32_t*)mem_alloc(MEMORY_MESH, size * sizeof(uint32_t));
+    if (!table) return false;
+    memset(table, 0xff, size * sizeof(uint32_t));
+
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        const float* position = &vertices[(size_t)v * stride];
+        uint32_t bits[3];
+        memcpy(bits, position, sizeof(bits));
+
+        uint32_t slot = hash_u32(bits[0] ^ hash_u32(bits[1] ^ hash_u32(bits[2]))) & (size - 1);
+        while (table[slot] != NO_VERTEX && memcmp(&vertices[(size_t)table[slot] * stride], position, 3 * sizeof(float)) != 0) {
+            slot = (slot + 1) & (size - 1);
+        }
+
+        if (table[slot] == NO_VERTEX) {
+            table[slot] = v;
+            remap[v] = v;
+            wedges[v] = v;
+        } else {
+            uint32_t first = table[slot];
+            remap[v] = first;
+            wedges[v] = wedges[first];
+            wedges[first] = v;
+        }
+    }
+
+    mem_free(table);
+    return true;
+}
+
+static bool edge_insert(uint64_t* edges, uint32_t size, uint64_t key) {
+    uint32_t slot = hash_u32((uint32_t)key ^ hash_u32((uint32_t)(key >> 32))) & (size - 1);
+    while (edges[slot] != UINT64_MAX) {
+        if (edges[slot] == key) return false;
+        slot = (slot + 1) & (size - 1);
+    }
+    edges[slot] = key;
+    return true;
+}
+
+static bool edge_exists(const uint64_t* edges, uint32_t size, uint64_t key) {
+    uint32_t slot = hash_u32((uint32_t)key ^ hash_u32((uint32_t)(key >> 32))) & (size - 1);
+    while (edges[slot] != UINT64_MAX) {
+        if (edges[slot] == key) return true;
+        slot = (slot + 1) & (size - 1);
+    }
+    return false;
+}
+
+// An edge only one triangle uses, in one direction, is on an open boundary; moving either end
+// would pull the outline in, so both stay put
+static bool lock_boundaries(const uint32_t* indices, uint32_t indexCount, const uint32_t* remap, bool* locked) {
+    uint32_t size = table_size(indexCount);
+    uint64_t* edges = (uint64_t*)mem_alloc(MEMORY_MESH, size * sizeof(uint64_t));
+    if (!edges) return false;
+    memset(edges, 0xff, size * sizeof(uint64_t));
+
+    for (uint32_t i = 0; i < indexCount; i++) {
+        uint32_t a = remap[indices[i]];
+        uint32_t b = remap[indices[i - i % 3 + (i + 1) % 3]];
+        if (a != b) edge_insert(edges, size, (uint64_t)a << 32 | b);
+    }
+    for (uint32_t i = 0; i < indexCount; i++) {
+        uint32_t a = remap[indices[i]];
+        uint32_t b = remap[indices[i - i % 3 + (i + 1) % 3]];
+        if (a != b && !edge_exists(edges, size, (uint64_t)b << 32 | a)) {
+            locked[a] = true;
+            locked[b] = true;
+        }
+    }
+
+    mem_free(edges);
+    return true;
+}
+
+static void triangle_normal(const float* a, const float* b, const float* c, double normal[3]) {
+    double u[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double v[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    normal[0] = u[1] * v[2] - u[2] * v[1];
+    normal[1] = u[2] * v[0] - u[0] * v[2];
+    normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// Whether moving from onto to would turn any triangle around from too far or squash it flat
+static bool collapse_flips(const float* vertices, uint32_t stride, const uint32_t* remap, const uint32_t* triangles,
+                           const uint32_t* adjacency, uint32_t first, uint32_t last, uint32_t from, uint32_t to) {
+    for (uint32_t k = first; k < last; k++) {
+        const uint32_t* corners = &triangles[adjacency[k] * 3];
+        const float* before[3];
+        const float* after[3];
+        bool collapses = false;
+        for (int c = 0; c < 3; c++) {
+            uint32_t position = remap[corners[c]];
+            if (position == to) collapses = true;
+            before[c] = &vertices[(size_t)position * stride];
+            after[c] = position == from ? &vertices[(size_t)to * stride] : before[c];
+        }
+        // Triangles on the collapsing edge disappear
+        if (collapses) continue;
+
+        double n0[3], n1[3];
+        triangle_normal(before[0], before[1], before[2], n0);
+        triangle_normal(after[0], after[1], after[2], n1);
+        double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+        double lengths = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+        if (dot <= SIMPLIFY_MIN_COSINE * lengths) return true;
+    }
+    return false;
+}
+
+// The vertex at the target position whose normal and texture coordinates best match vertex's,
+// so seams keep their sides
+static uint32_t nearest_wedge(const float* vertices, uint32_t stride, const uint32_t* wedges, uint32_t vertex, uint32_t target) {
+    if (stride < 8) return target;
+
+    const float* attributes = &vertices[(size_t)vertex * stride + 3];
+    uint32_t best = target;
+    float bestDistance = INFINITY;
+    uint32_t wedge = target;
+    do {
+        const float* candidate = &vertices[(size_t)wedge * stride + 3];
+        float distance = 0.0f;
+        for (int k = 0; k < 5; k++) {
+            distance += (attributes[k] - candidate[k]) * (attributes[k] - candidate[k]);
+        }
+        if (distance < bestDistance) {
+            best = wedge;
+            bestDistance = distance;
+        }
+        wedge = wedges[wedge];
+    } while (wedge != target);
+    return best;
+}
+
+static int compare_collapses(const void* a, const void* b) {
+    double x = ((const Collapse*)a)->cost;
+    double y = ((const Collapse*)b)->cost;
+    return (x > y) - (x < y);
+}
+
+// Working arrays, one entry per vertex unless noted
+typedef struct {
+    uint32_t* remap;
+    uint32_t* wedges;
+    uint32_t* collapseTo;       // NO_VERTEX, or the position this one moves onto this pass
+    uint32_t* vertexRemap;
+    uint32_t* adjacencyOffsets; // vertexCount + 1, into adjacency
+    uint32_t* adjacency;        // triangles around each position, one entry per index
+    bool*     locked;
+    bool*     touched;
+    Quadric*  quadrics;
+    Collapse* collapses;        // one per index
+} Simplifier;
+
+static void simplifier_free(Simplifier* simplifier) {
+    mem_free(simplifier->remap);
+    mem_free(simplifier->wedges);
+    mem_free(simplifier->collapseTo);
+    mem_free(simplifier->vertexRemap);
+    mem_free(simplifier->adjacencyOffsets);
+    mem_free(simplifier->adjacency);
+    mem_free(simplifier->locked);
+    mem_free(simplifier->touched);
+    mem_free(simplifier->quadrics);
+    mem_free(simplifier->collapses);
+}
+
+static bool simplifier_init(Simplifier* simplifier, uint32_t vertexCount, uint32_t indexCount) {
+    simplifier->remap = (uint32_t*)mem_alloc(MEMORY_MESH, vertexCount * sizeof(uint32_t));
+    simplifier->wedges = (uint32_t*)mem_alloc(MEMORY_MESH, vertexCount * sizeof(uint32_t));
+    simplifier->collapseTo = (uint32_t*)mem_alloc(MEMORY_MESH, vertexCount * sizeof(uint32_t));
+    simplifier->vertexRemap = (uint32_t*)mem_alloc(MEMORY_MESH, vertexCount * sizeof(uint32_t));
+    simplifier->adjacencyOffsets = (uint32_t*)mem_alloc(MEMORY_MESH, (vertexCount + 1) * sizeof(uint32_t));
+    simplifier->adjacency = (uint32_t*)mem_alloc(MEMORY_MESH, indexCount * sizeof(uint32_t));
+    simplifier->locked = (bool*)mem_calloc(MEMORY_MESH, vertexCount, sizeof(bool));
+    simplifier->touched = (bool*)mem_alloc(MEMORY_MESH, vertexCount * sizeof(bool));
+    simplifier->quadrics = (Quadric*)mem_calloc(MEMORY_MESH, vertexCount, sizeof(Quadric));
+    simplifier->collapses = (Collapse*)mem_alloc(MEMORY_MESH, indexCount * sizeof(Collapse));
+    return simplifier->remap && simplifier->wedges && simplifier->collapseTo && simplifier->vertexRemap &&
+           simplifier->adjacencyOffsets && simplifier->adjacency && simplifier->locked && simplifier->touched &&
+           simplifier->quadrics && simplifier->collapses;
+}
+
+// Each position starts with the planes of the triangles around it, weighted by area
+static void accumulate_quadrics(Simplifier* s, const float* vertices, uint32_t stride, const uint32_t* indices, uint32_t indexCount) {
+    for (uint32_t t = 0; t < indexCount; t += 3) {
+        const float* a = &vertices[(size_t)indices[t] * stride];
+        double normal[3];
+        triangle_normal(a, &vertices[(size_t)indices[t + 1] * stride], &vertices[(size_t)indices[t + 2] * stride], normal);
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length == 0.0) continue;
+
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+        double d = -(normal[0] * a[0] + normal[1] * a[1] + normal[2] * a[2]);
+        for (int c = 0; c < 3; c++) {
+            quadric_add_plane(&s->quadrics[s->remap[indices[t + c]]], normal, d, length * 0.5);
+        }
+    }
+}
+
+// Collapses the cheapest edges that don't share triangles, returning the new index count, or
+// count when nothing could collapse
+static uint32_t simplify_pass(Simplifier* s, const float* vertices, uint32_t vertexCount, uint32_t stride,
+                              uint32_t* out, uint32_t count, uint32_t targetIndexCount) {
+    memset(s->adjacencyOffsets, 0, (vertexCount + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) s->adjacencyOffsets[s->remap[out[i]] + 1]++;
+    for (uint32_t v = 0; v < vertexCount; v++) s->adjacencyOffsets[v + 1] += s->adjacencyOffsets[v];
+    memcpy(s->vertexRemap, s->adjacencyOffsets, vertexCount * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) s->adjacency[s->vertexRemap[s->remap[out[i]]]++] = i / 3;
+
+    uint32_t collapseCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t a = s->remap[out[i]];
+        uint32_t b = s->remap[out[i - i % 3 + (i + 1) % 3]];
+        if (a == b || (s->locked[a] && s->locked[b])) continue;
+
+        Quadric q = s->quadrics[a];
+        quadric_add(&q, &s->quadrics[b]);
+        double aToB = s->locked[a] ? INFINITY : quadric_error(&q, &vertices[(size_t)b * stride]);
+        double bToA = s->locked[b] ? INFINITY : quadric_error(&q, &vertices[(size_t)a * stride]);
+
+        Collapse* collapse = &s->collapses[collapseCount++];
+        collapse->from = aToB <= bToA ? a : b;
+        collapse->to = aToB <= bToA ? b : a;
+        collapse->cost = aToB <= bToA ? aToB : bToA;
+    }
+    qsort(s->collapses, collapseCount, sizeof(Collapse), compare_collapses);
+
+    memset(s->touched, 0, vertexCount * sizeof(bool));
+    memset(s->collapseTo, 0xff, vertexCount * sizeof(uint32_t));
+    uint32_t needed = (count - targetIndexCount + 2) / 3;
+    uint32_t removed = 0;
+    uint32_t accepted = 0;
+    for (uint32_t c = 0; c < collapseCount && removed < needed; c++) {
+        uint32_t from = s->collapses[c].from;
+        uint32_t to = s->collapses[c].to;
+        uint32_t first = s->adjacencyOffsets[from];
+        uint32_t last = s->adjacencyOffsets[from + 1];
+        if (s->touched[from] || s->touched[to]) continue;
+        if (collapse_flips(vertices, stride, s->remap, out, s->adjacency, first, last, from, to)) continue;
+
+        s->collapseTo[from] = to;
+        quadric_add(&s->quadrics[to], &s->quadrics[from]);
+        accepted++;
+
+        // Nothing around this collapse moves again this pass, so the adjacency stays valid
+        for (uint32_t k = first; k < last; k++) {
+            const uint32_t* corners = &out[s->adjacency[k] * 3];
+            bool onEdge = false;
+            for (int i = 0; i < 3; i++) {
+                s->touched[s->remap[corners[i]]] = true;
+                if (s->remap[corners[i]] == to) onEdge = true;
+            }
+            if (onEdge) removed++;
+        }
+    }
+    if (accepted == 0) return count;
+
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        uint32_t target = s->collapseTo[s->remap[v]];
+        s->vertexRemap[v] = target == NO_VERTEX ? v : nearest_wedge(vertices, stride, s->wedges, v, target);
+    }
+
+    uint32_t written = 0;
+    for (uint32_t t = 0; t < count; t += 3) {
+        uint32_t a = s->vertexRemap[out[t]];
+        uint32_t b = s->vertexRemap[out[t + 1]];
+        uint32_t c = s->vertexRemap[out[t + 2]];
+        if (s->remap[a] == s->remap[b] || s->remap[b] == s->remap[c] || s->remap[c] == s->remap[a]) continue;
+
+        out[written++] = a;
+        out[written++] = b;
+        out[written++] = c;
+    }
+    return written;
+}
+
+uint32_t simplify_mesh(const float* vertices, uint32_t vertexCount, uint32_t stride,
+                       const uint32_t* indices, uint32_t indexCount, uint32_t targetIndexCount, uint32_t* out) {
+    memmove(out, indices, indexCount * sizeof(uint32_t));
+    if (indexCount <= targetIndexCount || vertexCount == 0) return indexCount;
+
+    Simplifier simplifier;
+    if (!simplifier_init(&simplifier, vertexCount, indexCount) ||
+        !weld_positions(vertices, vertexCount, stride, simplifier.remap, simplifier.wedges) ||
+        !lock_boundaries(out, indexCount, simplifier.remap, simplifier.locked)) {
+        fprintf(stderr, "ERROR: Failed to allocate simplification of %u vertices\n", vertexCount);
+        simplifier_free(&simplifier);
+        return indexCount;
+    }
+    accumulate_quadrics(&simplifier, vertices, stride, out, indexCount);
+
+    uint32_t count = indexCount;
+    for (int pass = 0; pass < SIMPLIFY_MAX_PASSES && count > targetIndexCount; pass++) {
+        uint32_t simplified = simplify_pass(&simplifier, vertices, vertexCount, stride, out, count, targetIndexCount);
+        if (simplified == count) break;
+        count = simplified;
+    }
+
+    simplifier_free(&simplifier);
+    return count;
+}
@@ -0,0 +1,16 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <stdint.h>
+
+// Reduces a triangle list by quadric error edge collapses (Garland & Heckbert). Vertices
+// sharing a position are welded while simplifying, and every collapse moves a vertex onto an
+// existing neighbour, so the result indexes the original vertices and needs no new vertex
+// data. Open boundaries stay put and collapses that would flip a triangle are skipped, so
+// fewer indices than asked for may be removed. vertices are stride floats apiece with the
+// position first and, when stride is at least 8, the normal and texture coordinates after.
+// out may be indices. Returns the number of indices written to out.
+uint32_t simplify_mesh(const float* vertices, uint32_t vertexCount, uint32_t stride,
+                       const uint32_t* indices, uint32_t indexCount, uint32_t targetIndexCount, uint32_t* out);
+
+#endif
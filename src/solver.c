@@ -0,0 +1,265 @@
+#include "solver.h"
+#include <math.h>
+
+#define SOLVER_BATCH 64 // manifolds
+
+static int compare_keys(const void* lhs, const void* rhs) {
+    const Manifold* a = (const Manifold*)lhs;
+    const Manifold* b = (const Manifold*)rhs;
+    if (a->key != b->key) return (a->key > b->key) - (a->key < b->key);
+    return (a->feature > b->feature) - (a->feature < b->feature);
+}
+
+void solver_match(const ManifoldBuffer* previous, Manifold* manifold) {
+    const Manifold* old = (const Manifold*)bsearch(manifold, previous->items, previous->count, sizeof(Manifold), compare_keys);
+
+    for (int i = 0; i < manifold->pointCount; i++) {
+        ContactPoint* point = &manifold->points[i];
+        point->normalImpulse = 0.0f;
+        point->tangentImpulse[0] = 0.0f;
+        point->tangentImpulse[1] = 0.0f;
+        if (!old) continue;
+
+        for (int j = 0; j < old->pointCount; j++) {
+            if (old->points[j].id == point->id) {
+                point->normalImpulse = old->points[j].normalImpulse;
+                point->tangentImpulse[0] = old->points[j].tangentImpulse[0];
+                point->tangentImpulse[1] = old->points[j].tangentImpulse[1];
+                break;
+            }
+        }
+    }
+}
+
+static Body* manifold_body(Physics* physics, uint32_t proxy) {
+    return proxy == PHYSICS_GROUND ? NULL : physics->proxies[proxy].body;
+}
+
+static float inverse_mass(const Body* body) {
+    return body ? body->invMass : 0.0f;
+}
+
+// Velocity of b relative to a; the ground never moves
+static void relative_velocity(const Body* a, const Body* b, vec3 out) {
+    glm_vec3_zero(out);
+    if (b) glm_vec3_add(out, (float*)b->velocity, out);
+    if (a) glm_vec3_sub(out, (float*)a->velocity, out);
+}
+
+// Applies impulse along direction, positive pushing b away from a
+static void apply_impulse(Body* a, Body* b, const vec3 direction, float impulse) {
+    if (a && a->invMass > 0.0f) glm_vec3_muladds((float*)direction, -impulse * a->invMass, a->velocity);
+    if (b && b->invMass > 0.0f) glm_vec3_muladds((float*)direction, impulse * b->invMass, b->velocity);
+}
+
+static void tangent_basis(const vec3 normal, vec3 t0, vec3 t1) {
+    if (fabsf(normal[0]) >= 0.57735f) {
+        glm_vec3_copy((vec3){normal[1], -normal[0], 0.0f}, t0);
+    } else {
+        glm_vec3_copy((vec3){0.0f, normal[2], -normal[1]}, t0);
+    }
+    glm_vec3_normalize(t0);
+    glm_vec3_cross((float*)normal, t0, t1);
+}
+
+// Greedy graph colouring: no two manifolds of the same colour touch the same dynamic body,
+// so each colour can be solved in parallel. Other bodies and the ground are never written
+// and don't constrain the colouring. Colours are assigned in manifold order, which keeps the
+// partition (and so the result) deterministic.
+static void color_manifolds(Physics* physics) {
+    uint32_t manifoldCount = physics->manifolds.count;
+    memset(physics->colorStarts, 0, sizeof(physics->colorStarts));
+
+    if (!physics_reserve((void**)&physics->colored, &physics->coloredCapacity, manifoldCount, sizeof(uint32_t)) ||
+        !physics_reserve((void**)&physics->manifoldColors, &physics->manifoldColorCapacity, manifoldCount, sizeof(uint8_t))) {
+        return;
+    }
+
+    memset(physics->bodyColors, 0, physics->proxyCount * sizeof(uint64_t));
+
+    for (uint32_t m = 0; m < manifoldCount; m++) {
+        const Manifold* manifold = &physics->manifolds.items[m];
+        Body* a = manifold_body(physics, manifold->a);
+        Body* b = manifold_body(physics, manifold->b);
+        bool writesA = a && body_is_dynamic(a);
+        bool writesB = b && body_is_dynamic(b);
+
+        uint64_t used = 0;
+        if (writesA) used |= physics->bodyColors[manifold->a];
+        if (writesB) used |= physics->bodyColors[manifold->b];
+
+        int color = PHYSICS_MAX_COLORS;
+        for (int bit = 0; bit < PHYSICS_MAX_COLORS; bit++) {
+            if (!(used & ((uint64_t)1 << bit))) {
+                color = bit;
+                break;
+            }
+        }
+
+        if (color < PHYSICS_MAX_COLORS) {
+            if (writesA) physics->bodyColors[manifold->a] |= (uint64_t)1 << color;
+            if (writesB) physics->bodyColors[manifold->b] |= (uint64_t)1 << color;
+        }
+
+        physics->manifoldColors[m] = (uint8_t)color;
+        physics->colorStarts[color + 1]++;
+    }
+
+    for (int color = 0; color <= PHYSICS_MAX_COLORS; color++) {
+        physics->colorStarts[color + 1] += physics->colorStarts[color];
+    }
+
+    uint32_t cursor[PHYSICS_MAX_COLORS + 1];
+    memcpy(cursor, physics->colorStarts, sizeof(cursor));
+    for (uint32_t m = 0; m < manifoldCount; m++) {
+        physics->colored[cursor[physics->manifoldColors[m]]++] = m;
+    }
+}
+
+typedef struct {
+    Physics*        physics;
+    const uint32_t* manifolds;
+    float           deltaTime;
+} SolveTask;
+
+// Precomputes effective masses and velocity targets, then reapplies last step's impulses
+static void prepare_manifolds(int start, int end, void* data) {
+    SolveTask* task = (SolveTask*)data;
+    Physics* physics = task->physics;
+
+    for (int i = start; i < end; i++) {
+        Manifold* manifold = &physics->manifolds.items[task->manifolds[i]];
+        Body* a = manifold_body(physics, manifold->a);
+        Body* b = manifold_body(physics, manifold->b);
+
+        float invMass = inverse_mass(a) + inverse_mass(b);
+        float mass = invMass > 0.0f ? 1.0f / invMass : 0.0f;
+        tangent_basis(manifold->normal, manifold->tangents[0], manifold->tangents[1]);
+
+        vec3 velocity;
+        relative_velocity(a, b, velocity);
+        float closing = -glm_vec3_dot(velocity, manifold->normal);
+
+        for (int p = 0; p < manifold->pointCount; p++) {
+            ContactPoint* point = &manifold->points[p];
+            point->normalMass = mass;
+            point->tangentMass[0] = mass;
+            point->tangentMass[1] = mass;
+
+            // Push out of penetration, or for a speculative contact only allow closing the gap
+            float bias = 0.0f;
+            if (point->depth > SOLVER_SLOP) {
+                bias = SOLVER_BAUMGARTE / task->deltaTime * (point->depth - SOLVER_SLOP);
+            } else if (point->depth < 0.0f) {
+                bias = point->depth / task->deltaTime;
+            }
+            point->velocityBias = bias;
+            point->relativeVelocity = -closing;
+
+            apply_impulse(a, b, manifold->normal, point->normalImpulse);
+            apply_impulse(a, b, manifold->tangents[0], point->tangentImpulse[0]);
+            apply_impulse(a, b, manifold->tangents[1], point->tangentImpulse[1]);
+        }
+    }
+}
+
+static void solve_manifolds(int start, int end, void* data) {
+    SolveTask* task = (SolveTask*)data;
+    Physics* physics = task->physics;
+
+    for (int i = start; i < end; i++) {
+        Manifold* manifold = &physics->manifolds.items[task->manifolds[i]];
+        Body* a = manifold_body(physics, manifold->a);
+        Body* b = manifold_body(physics, manifold->b);
+
+        for (int p = 0; p < manifold->pointCount; p++) {
+            ContactPoint* point = &manifold->points[p];
+            vec3 velocity;
+
+            // Friction first, bounded by the normal impulse from the last iteration
+            float limit = manifold->friction * point->normalImpulse;
+            for (int t = 0; t < 2; t++) {
+                relative_velocity(a, b, velocity);
+                float lambda = -point->tangentMass[t] * glm_vec3_dot(velocity, manifold->tangents[t]);
+                float previous = point->tangentImpulse[t];
+                point->tangentImpulse[t] = glm_clamp(previous + lambda, -limit, limit);
+                apply_impulse(a, b, manifold->tangents[t], point->tangentImpulse[t] - previous);
+            }
+
+            // The accumulated normal impulse may only push
+            relative_velocity(a, b, velocity);
+            float separating = glm_vec3_dot(velocity, manifold->normal);
+            float lambda = point->normalMass * (point->velocityBias - separating);
+            float previous = point->normalImpulse;
+            point->normalImpulse = fmaxf(previous + lambda, 0.0f);
+            apply_impulse(a, b, manifold->normal, point->normalImpulse - previous);
+        }
+    }
+}
+
+// Bounces points that were closing fast, once the contacts have been made to hold. Doing
+// it here rather than through the bias keeps the bounce out of the Baumgarte correction.
+static void restitute_manifolds(int start, int end, void* data) {
+    SolveTask* task = (SolveTask*)data;
+    Physics* physics = task->physics;
+
+    for (int i = start; i < end; i++) {
+        Manifold* manifold = &physics->manifolds.items[task->manifolds[i]];
+        if (manifold->restitution == 0.0f) continue;
+
+        Body* a = manifold_body(physics, manifold->a);
+        Body* b = manifold_body(physics, manifold->b);
+
+        for (int p = 0; p < manifold->pointCount; p++) {
+            ContactPoint* point = &manifold->points[p];
+            if (point->relativeVelocity > -SOLVER_RESTITUTION_THRESHOLD || point->normalImpulse == 0.0f) continue;
+
+            vec3 velocity;
+            relative_velocity(a, b, velocity);
+            float separating = glm_vec3_dot(velocity, manifold->normal);
+            float lambda = -point->normalMass * (separating + manifold->restitution * point->relativeVelocity);
+
+            // Not accumulated, so next step's warm start doesn't replay the bounce
+            apply_impulse(a, b, manifold->normal, fmaxf(lambda, -point->normalImpulse));
+        }
+    }
+}
+
+static void solve_colors(Physics* physics, ParallelForFunc func, float deltaTime) {
+    for (int color = 0; color < PHYSICS_MAX_COLORS; color++) {
+        uint32_t start = physics->colorStarts[color];
+        uint32_t end = physics->colorStarts[color + 1];
+        if (start == end) continue;
+
+        SolveTask task = {physics, physics->colored + start, deltaTime};
+        jobs_parallel_for((int)(end - start), SOLVER_BATCH, func, &task);
+    }
+
+    // Manifolds that ran out of colours share bodies with every colour, so run them in order
+    uint32_t start = physics->colorStarts[PHYSICS_MAX_COLORS];
+    uint32_t end = physics->colorStarts[PHYSICS_MAX_COLORS + 1];
+    SolveTask task = {physics, physics->colored + start, deltaTime};
+    func(0, (int)(end - start), &task);
+}
+
+// Sequential impulses over the coloured manifolds, warm started from the last step. Velocities
+// only: positions are integrated afterwards from the solved velocities.
+void physics_solve(Physics* physics, float deltaTime) {
+    color_manifolds(physics);
+
+    solve_colors(physics, prepare_manifolds, deltaTime);
+    for (int i = 0; i < physics->iterations; i++) {
+        solve_colors(physics, solve_manifolds, deltaTime);
+    }
+    solve_colors(physics, restitute_manifolds, deltaTime);
+
+    // Keep the accumulated impulses for the next step's warm start
+    ManifoldBuffer* previous = &physics->previous;
+    previous->count = 0;
+    if (!physics_reserve((void**)&previous->items, &previous->capacity, physics->manifolds.count, sizeof(Manifold))) {
+        return;
+    }
+    memcpy(previous->items, physics->manifolds.items, physics->manifolds.count * sizeof(Manifold));
+    previous->count = physics->manifolds.count;
+    qsort(previous->items, previous->count, sizeof(Manifold), compare_keys);
+}
@@ -0,0 +1,13 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "physics.h"
+
+#define SOLVER_BAUMGARTE 0.2f             // fraction of the penetration corrected per step
+#define SOLVER_SLOP 0.01f                 // penetration left alone to keep contacts from jittering
+#define SOLVER_RESTITUTION_THRESHOLD 1.0f // closing speeds below this don't bounce
+
+// Copies accumulated impulses from last step's manifold with the same key and feature, point by point
+void solver_match(const ManifoldBuffer* previous, Manifold* manifold);
+
+#endif
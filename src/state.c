@@ -1,57 +1,197 @@
 #include "state.h"
+#include "lod.h"
 #include "physics.h"
 #include <string.h>
 
+#define RENDER_MASK (COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_RENDERABLE) | COMPONENT_BIT(COMPONENT_COLLIDER))
+
 void state_init(State* state) {
+    state->deterministic = false;
+    state->fixedStep = STATE_FIXED_STEP;
+    state->accumulator = 0.0f;
     camera_init(&state->camera);
-    state->objectCount = 0;
+    overlay_init(&state->overlay);
+    ecs_init(&state->world);
+    physics_init(&state->physics);
+    memset(&state->batches, 0, sizeof(state->batches));
+    occlusion_init(&state->occlusion);
+}
+
+Entity state_add_object(State* state, const Object* object) {
+    return object_spawn(&state->world, object);
+}
+
+bool state_remove_object(State* state, Entity entity) {
+    Renderable* renderable = (Renderable*)ecs_get(&state->world, entity, COMPONENT_RENDERABLE);
+    if (renderable && renderable->batched) {
+        static_batches_remove(&state->batches, renderable);
+    } else if (renderable) {
+        renderable_cleanup(renderable);
+    }
+    return ecs_destroy(&state->world, entity);
+}
+
+void state_finalize(State* state) {
+    static_batches_build(&state->batches, &state->world);
+}
+
+bool state_get_object(State* state, Entity entity, Object* object) {
+    return object_from_entity(&state->world, entity, object);
 }
 
-void state_add_object(State* state, Object* object) {
-    if (state->objectCount < MAX_OBJECTS) {
-        state->objects[state->objectCount] = *object;
-        state->objectCount++;
+// Teleports an entity, waking it and anything it was sleeping with
+bool state_set_object_position(State* state, Entity entity, vec3 position) {
+    Transform* transform = (Transform*)ecs_get(&state->world, entity, COMPONENT_TRANSFORM);
+    if (!transform) return false;
+
+    vec3 offset;
+    glm_vec3_sub(position, transform->position, offset);
+    glm_vec3_copy(position, transform->position);
+    transform_update(transform);
+
+    Collider* collider = (Collider*)ecs_get(&state->world, entity, COMPONENT_COLLIDER);
+    if (collider) {
+        collider_update(collider, transform->model);
+    }
+
+    // A batched object's triangles were merged where it stood, so the batch shifts them
+    Renderable* renderable = (Renderable*)ecs_get(&state->world, entity, COMPONENT_RENDERABLE);
+    if (renderable && renderable->batched && collider) {
+        static_batches_move(&state->batches, renderable, offset, &collider->aabb);
+    }
+
+    Body* body = (Body*)ecs_get(&state->world, entity, COMPONENT_BODY);
+    if (body) {
+        physics_wake(&state->physics, body);
     }
+    return true;
+}
+
+// Closest object under a window position, as of the last physics step
+bool state_pick(State* state, float x, float y, float width, float height, RaycastHit* hit) {
+    Ray ray;
+    camera_screen_ray(&state->camera, x, y, width, height, ray.origin, ray.direction);
+    ray.maxDistance = CAMERA_FAR;
+    ray.mask = PHYSICS_LAYER_ALL;
+    ray.triangles = true;
+    return physics_raycast(&state->physics, &ray, hit);
+}
+
+void state_set_deterministic(State* state, float fixedStep) {
+    state->deterministic = true;
+    state->fixedStep = fixedStep;
+    state->accumulator = 0.0f;
 }
 
 void state_update(State* state, float deltaTime) {
     camera_update_vectors(&state->camera);
 
-    for (int i = 0; i < state->objectCount; i++) {
-        Object* obj = &state->objects[i];
-        
-        // Apply gravity
-        apply_gravity(obj->velocity, deltaTime);
+    if (!state->deterministic) {
+        physics_step(&state->physics, &state->world, deltaTime);
+        return;
+    }
 
-        // Update position based on velocity
-        vec3 displacement;
-        glm_vec3_scale(obj->velocity, deltaTime, displacement);
-        glm_vec3_add(obj->position, displacement, obj->position);
+    state->accumulator += deltaTime;
+    int steps = 0;
+    while (state->accumulator >= state->fixedStep && steps < STATE_MAX_STEPS) {
+        physics_step(&state->physics, &state->world, state->fixedStep);
+        state->accumulator -= state->fixedStep;
+        steps++;
+    }
 
-        // Update object's model matrix
-        object_update(obj);
+    if (steps == STATE_MAX_STEPS) state->accumulator = 0.0f;
+}
 
-        // Update AABB
-        update_aabb(obj->position, obj->scale, &obj->aabb);
+// FNV-1a over the raw bits, in query order, which is stable for a given sequence of spawns
+uint64_t state_checksum(State* state) {
+    uint64_t hash = 14695981039346656037ull;
 
-        // Check for collisions with other objects
-        for (int j = i + 1; j < state->objectCount; j++) {
-            Object* other = &state->objects[j];
-            if (check_collision_aabb(&obj->aabb, &other->aabb)) {
-                resolve_collision(obj->position, obj->velocity, other->position, other->velocity, obj->scale, other->scale);
+    EcsQuery query = ecs_query(&state->world, COMPONENT_BIT(COMPONENT_TRANSFORM) | COMPONENT_BIT(COMPONENT_BODY));
+    while (ecs_query_next(&query)) {
+        Transform* transforms = (Transform*)ecs_query_column(&query, COMPONENT_TRANSFORM);
+        Body* bodies = (Body*)ecs_query_column(&query, COMPONENT_BODY);
+
+        for (uint32_t i = 0; i < query.count; i++) {
+            const unsigned char* bytes[2] = {(const unsigned char*)transforms[i].position, (const unsigned char*)bodies[i].velocity};
+            for (int b = 0; b < 2; b++) {
+                for (size_t k = 0; k < sizeof(vec3); k++) {
+                    hash = (hash ^ bytes[b][k]) * 1099511628211ull;
+                }
             }
         }
+    }
+    return hash;
+}
+
+// Rasterizes the occluders in view, as their collision mesh or else their box
+static void draw_occluders(State* state, const RenderFrame* frame, vec4 frustum[6]) {
+    mat4 viewProjection;
+    glm_mat4_mul((vec4*)frame->projection, (vec4*)frame->view, viewProjection);
+    occlusion_begin(&state->occlusion, viewProjection);
+    if (!state->occlusion.enabled) return;
+
+    EcsQuery query = ecs_query(&state->world, RENDER_MASK);
+    while (ecs_query_next(&query)) {
+        Transform* transforms = (Transform*)ecs_query_column(&query, COMPONENT_TRANSFORM);
+        Renderable* renderables = (Renderable*)ecs_query_column(&query, COMPONENT_RENDERABLE);
+        Collider* colliders = (Collider*)ecs_query_column(&query, COMPONENT_COLLIDER);
 
-        // Ground collision (assuming ground is at y=0)
-        if (obj->position[1] < obj->scale[1]) {
-            obj->position[1] = obj->scale[1];
-            obj->velocity[1] = 0;
+        for (uint32_t i = 0; i < query.count; i++) {
+            if (!renderables[i].occluder || !camera_aabb_visible(frustum, &colliders[i].aabb)) continue;
+            if (colliders[i].mesh) {
+                occlusion_add_mesh(&state->occlusion, colliders[i].mesh, transforms[i].model);
+            } else {
+                occlusion_add_box(&state->occlusion, &colliders[i].box);
+            }
         }
     }
+    occlusion_finish(&state->occlusion);
+}
+
+void state_build_frame(State* state, RenderFrame* frame, float aspect) {
+    camera_get_view_matrix(&state->camera, frame->view);
+    camera_get_projection_matrix(&state->camera, aspect, frame->projection);
+    glm_vec3_copy(state->camera.position, frame->viewPos);
+
+    vec4 frustum[6];
+    camera_get_frustum(&state->camera, aspect, frustum);
+    draw_occluders(state, frame, frustum);
+
+    EcsQuery query = ecs_query(&state->world, RENDER_MASK);
+    while (ecs_query_next(&query)) {
+        Transform* transforms = (Transform*)ecs_query_column(&query, COMPONENT_TRANSFORM);
+        Renderable* renderables = (Renderable*)ecs_query_column(&query, COMPONENT_RENDERABLE);
+        Collider* colliders = (Collider*)ecs_query_column(&query, COMPONENT_COLLIDER);
+
+        for (uint32_t i = 0; i < query.count; i++) {
+            if (renderables[i].batched) continue;
+            // The collider's box encloses the whole mesh, so it stands in for it against the view
+            if (!camera_aabb_visible(frustum, &colliders[i].aabb)) continue;
+            if (!renderables[i].occluder && !occlusion_aabb_visible(&state->occlusion, &colliders[i].aabb)) continue;
+            renderables[i].lod = lod_select(&renderables[i], &colliders[i].aabb, state->camera.position, state->camera.fov);
+            Renderable level = lod_level(&renderables[i], renderables[i].lod);
+            render_frame_push(frame, &level, transforms[i].model);
+        }
+    }
+    static_batches_cull(&state->batches, frustum, &state->occlusion, frame);
+
+    render_frame_capture_ui(frame, &state->ui);
+    frame->overlay = state->overlay;
+    memcpy(frame->physicsStages, state->physics.stageTimes, sizeof(frame->physicsStages));
 }
 
 void state_cleanup(State* state) {
-    for (int i = 0; i < state->objectCount; i++) {
-        object_cleanup(&state->objects[i]);
+    EcsQuery query = ecs_query(&state->world, COMPONENT_BIT(COMPONENT_RENDERABLE));
+    while (ecs_query_next(&query)) {
+        Renderable* renderables = (Renderable*)ecs_query_column(&query, COMPONENT_RENDERABLE);
+        for (uint32_t i = 0; i < query.count; i++) {
+            renderable_cleanup(&renderables[i]);
+        }
     }
-}
\ No newline at end of file
+    static_batches_free(&state->batches);
+    occlusion_free(&state->occlusion);
+    physics_free(&state->physics);
+    ecs_free(&state->world);
+    mesh_cache_free();
+    texture_cache_free();
+}
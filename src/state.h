@@ -1,23 +1,52 @@
 #ifndef STATE_H
 #define STATE_H
 
+#include "batch.h"
 #include "camera.h"
+#include "ecs.h"
 #include "object.h"
+#include "occlusion.h"
+#include "physics.h"
+#include "raycast.h"
 #include "ui.h"
+#include "overlay.h"
+#include "renderframe.h"
 
-#define MAX_OBJECTS 1000
+#define STATE_FIXED_STEP (1.0f / 60.0f)
+#define STATE_MAX_STEPS 8 // per update, so a long frame doesn't snowball
 
 typedef struct {
     Camera      camera;
     GLFWwindow* window;
     UI          ui;
-    Object      objects[MAX_OBJECTS];
-    int         objectCount;
+    Overlay     overlay;    // performance panel, toggled with F3
+    World       world;      // all scene entities, grouped into archetype chunks
+    Physics     physics;
+    StaticBatches batches;  // static objects merged by material when the scene is finalised
+    Occlusion   occlusion;  // what the occluders hide, redrawn each frame
+
+    // In deterministic mode physics only advances in whole fixed steps, so the same
+    // sequence of frame times and inputs always reproduces the same simulation
+    bool        deterministic;
+    float       fixedStep;
+    float       accumulator;
 } State;
 
-void state_init(State* state);
-void state_add_object(State* state, Object* object);
-void state_update(State* state, float deltaTime);
-void state_cleanup(State* state);
+void   state_init(State* state);
+// Safe at any time: spawning only takes a reference to the object's uploaded geometry
+Entity state_add_object(State* state, const Object* object);
+bool   state_remove_object(State* state, Entity entity);
+// Call once the scene is built: batches static objects that share a material
+void   state_finalize(State* state);
+bool   state_get_object(State* state, Entity entity, Object* object);
+bool   state_set_object_position(State* state, Entity entity, vec3 position);
+bool   state_pick(State* state, float x, float y, float width, float height, RaycastHit* hit);
+void   state_set_deterministic(State* state, float fixedStep);
+void   state_update(State* state, float deltaTime);
+// Hash of every body's position and velocity, to check two runs simulated the same thing
+uint64_t state_checksum(State* state);
+// Culls the scene into frame's draw list and copies out the camera, UI and overlay state
+void   state_build_frame(State* state, RenderFrame* frame, float aspect);
+void   state_cleanup(State* state);
 
-#endif
\ No newline at end of file
+#endif
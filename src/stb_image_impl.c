@@ -1,3 +1,8 @@
 
+#include "memstats.h"
+
+#define STBI_MALLOC(size) mem_alloc(MEMORY_TEXTURE, size)
+#define STBI_REALLOC(ptr, size) mem_realloc(MEMORY_TEXTURE, ptr, size)
+#define STBI_FREE(ptr) mem_free(ptr)
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
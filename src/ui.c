@@ -8,17 +8,6 @@
 #define MENU_CORNER_RADIUS 10.0f
 #define MENU_ITEM_HEIGHT 30.0f
 
-char* fToString(float* v) {
-    char* buffer = (char*)malloc(32 * sizeof(char));
-    if (buffer == NULL) {
-        return NULL;
-    }
-
-    snprintf(buffer, 32, "%.2f", *v);
-
-    return buffer;
-}
-
 void ui_init(UI* ui, NVGcontext* vg) {
     ui->buttonCount = 0;
     ui->vg = vg;
@@ -130,7 +119,9 @@ void ui_draw_slider(UI* ui, Slider* slider) {
     nvgTextAlign(ui->vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
     nvgFillColor(ui->vg, nvgRGB(255, 255, 255));
     nvgFontSize(ui->vg, 16.0f);
-    nvgText(ui->vg, slider->x + (slider->width / 2), slider->y + slider->height + 2, fToString(slider->value), NULL);
+    char valueText[32];
+    snprintf(valueText, sizeof(valueText), "%.2f", *slider->value);
+    nvgText(ui->vg, slider->x + (slider->width / 2), slider->y + slider->height + 2, valueText, NULL);
 }
 
 